@@ -1311,3 +1311,42 @@ CCWFGM_Scenario *CCWFGM_Scenario::deserialize(const google::protobuf::Message& p
 		throw ISerializeProto::DeserializeError(throw_msg);
 	return this;
 }
+
+
+HRESULT CCWFGM_Scenario::Simulation_Checkpoint(const SerializeProtoOptions& options, WISE::FireEngineProto::CwfgmScenarioState *state) const {
+	if (!state)							return E_POINTER;
+	CRWThreadSemaphoreEngage _semaphore_engage(const_cast<CRWThreadSemaphore&>(m_lock), SEM_FALSE);
+
+	if (!m_impl->m_scenario)
+		return ERROR_SCENARIO_BAD_STATE;
+	return m_impl->m_scenario->Checkpoint(options.fileVersion(), nullptr, state);
+}
+
+
+HRESULT CCWFGM_Scenario::Simulation_Fork(const HSS_Time::WTime &time, CCWFGM_Scenario *scenario, std::shared_ptr<validation::validation_object> valid, const std::string& name) const {
+	if (!scenario)						return E_POINTER;
+	if (scenario == this)				return E_INVALIDARG;
+
+	WISE::FireEngineProto::CwfgmScenarioState state;
+	{
+		CRWThreadSemaphoreEngage _semaphore_engage(const_cast<CRWThreadSemaphore&>(m_lock), SEM_FALSE);
+
+		if (!m_impl->m_scenario)
+			return ERROR_SCENARIO_BAD_STATE;
+		WTime t(time, m_timeManager);
+		HRESULT hr = m_impl->m_scenario->Checkpoint(2, &t, &state);		// never written out, so always the current file format
+		if (FAILED(hr))
+			return hr;
+	}
+	return scenario->Simulation_Resume(state, valid, name);
+}
+
+
+HRESULT CCWFGM_Scenario::Simulation_Resume(const WISE::FireEngineProto::CwfgmScenarioState &state, std::shared_ptr<validation::validation_object> valid, const std::string& name) {
+	CRWThreadSemaphoreEngage _semaphore_engage(m_lock, SEM_FALSE);
+
+	if (!m_impl->m_scenario)
+		return ERROR_SCENARIO_BAD_STATE;
+	m_impl->m_scenario->InitThreadPool((m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_SINGLETHREADING)) ? false : true);
+	return m_impl->m_scenario->Resume(state, valid, name);
+}
@@ -70,6 +70,10 @@ CCWFGM_Scenario::CCWFGM_Scenario() : m_timeManager(nullptr),
 	m_layerThread = nullptr;
 
 	m_threadingNumProcessors = CWorkerThreadPool::NumberProcessors();
+	m_spillSteps = 0;
+	m_closestCacheSize = 4096;
+	m_queueUp = m_queueUpGrid = m_queueUpVector = 64;
+	m_queueUpCalibrate = false;
 
 	m_dx = m_dy = m_dwd = m_dvd = 0.0;
 	m_owd = m_ovd = -1.0;
@@ -114,6 +118,12 @@ CCWFGM_Scenario::CCWFGM_Scenario(const CCWFGM_Scenario &toCopy) : m_timeManager(
 	m_defaultElevation = toCopy.m_defaultElevation;
 	m_layerThread = toCopy.m_layerThread;
 	m_threadingNumProcessors = toCopy.m_threadingNumProcessors;
+	m_spillSteps = toCopy.m_spillSteps;
+	m_closestCacheSize = toCopy.m_closestCacheSize;
+	m_queueUp = toCopy.m_queueUp;
+	m_queueUpGrid = toCopy.m_queueUpGrid;
+	m_queueUpVector = toCopy.m_queueUpVector;
+	m_queueUpCalibrate = toCopy.m_queueUpCalibrate;
 	m_dx = toCopy.m_dx;
 	m_dy = toCopy.m_dy;
 	m_dwd = toCopy.m_dwd;
@@ -262,6 +272,34 @@ HRESULT CCWFGM_Scenario::GetAttribute(std::uint16_t option,  PolymorphicAttribut
 		case CWFGM_SCENARIO_OPTION_MULTITHREADING:			*value = m_threadingNumProcessors;
 															return S_OK;
 
+		case CWFGM_SCENARIO_OPTION_SPILL_STEPS:				*value = m_spillSteps;
+															return S_OK;
+
+		case CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_SIZE:		*value = m_closestCacheSize;
+															return S_OK;
+
+		case CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_HITS:
+		case CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_MISSES:
+		case CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_EVICTIONS: {
+															std::uint64_t hits = 0, misses = 0, evictions = 0;
+															if (m_impl->m_scenario)
+																m_impl->m_scenario->ClosestCacheCounters(hits, misses, evictions);
+															if (option == CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_HITS)			*value = hits;
+															else if (option == CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_MISSES)	*value = misses;
+															else															*value = evictions;
+															return S_OK;
+														}
+
+		case CWFGM_SCENARIO_OPTION_QUEUE_UP:				// the configured values, until calibration replaces them (the scenario halves QUEUE_UP without spatial interpolation)
+															*value = ((m_impl->m_scenario) && (m_queueUpCalibrate) && (!m_impl->m_scenario->m_statsTuner.Calibrating())) ? m_impl->m_scenario->m_statsTuner.Threshold() : m_queueUp;
+															return S_OK;
+		case CWFGM_SCENARIO_OPTION_QUEUE_UP_GRID:			*value = ((m_impl->m_scenario) && (m_queueUpCalibrate) && (!m_impl->m_scenario->m_gridTuner.Calibrating())) ? m_impl->m_scenario->m_gridTuner.Threshold() : m_queueUpGrid;
+															return S_OK;
+		case CWFGM_SCENARIO_OPTION_QUEUE_UP_VECTOR:			*value = ((m_impl->m_scenario) && (m_queueUpCalibrate) && (!m_impl->m_scenario->m_vectorTuner.Calibrating())) ? m_impl->m_scenario->m_vectorTuner.Threshold() : m_queueUpVector;
+															return S_OK;
+		case CWFGM_SCENARIO_OPTION_QUEUE_UP_CALIBRATE:		*value = m_queueUpCalibrate;
+															return S_OK;
+
 		case CWFGM_SCENARIO_OPTION_PERIMETER_RESOLUTION:	*value = m_perimeterResolution;			return S_OK;
 		case CWFGM_SCENARIO_OPTION_PERIMETER_SPACING:		*value = m_perimeterSpacing;			return S_OK;
 		case CWFGM_SCENARIO_OPTION_SPATIAL_THRESHOLD:		*value = m_spatialThreshold;			return S_OK;
@@ -373,6 +411,35 @@ HRESULT CCWFGM_Scenario::SetAttribute(std::uint16_t option, const PolymorphicAtt
 								m_bRequiresSave = true;
 								return S_OK;
 
+		case CWFGM_SCENARIO_OPTION_SPILL_STEPS:
+								if (FAILED(hr = VariantToUInt64_(value, &mask)))	return hr;
+								if (mask > 0xffffffff)									return E_INVALIDARG;
+								m_spillSteps = (std::uint32_t)mask;
+								return S_OK;
+
+		case CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_SIZE:
+								if (FAILED(hr = VariantToUInt64_(value, &mask)))	return hr;
+								if (mask < 1)											return E_INVALIDARG;
+								if (mask > 0x1000000)									return E_INVALIDARG;
+								m_closestCacheSize = (std::uint32_t)mask;
+								return S_OK;
+
+		case CWFGM_SCENARIO_OPTION_QUEUE_UP:
+		case CWFGM_SCENARIO_OPTION_QUEUE_UP_GRID:
+		case CWFGM_SCENARIO_OPTION_QUEUE_UP_VECTOR:
+								if (FAILED(hr = VariantToUInt64_(value, &mask)))	return hr;
+								if (mask < 1)											return E_INVALIDARG;
+								if (mask > 0x100000)									return E_INVALIDARG;
+								if (option == CWFGM_SCENARIO_OPTION_QUEUE_UP)				m_queueUp = (std::uint32_t)mask;
+								else if (option == CWFGM_SCENARIO_OPTION_QUEUE_UP_GRID)		m_queueUpGrid = (std::uint32_t)mask;
+								else														m_queueUpVector = (std::uint32_t)mask;
+								return S_OK;
+
+		case CWFGM_SCENARIO_OPTION_QUEUE_UP_CALIBRATE:
+								if (FAILED(hr = VariantToBoolean_(value, &bValue)))	return hr;
+								m_queueUpCalibrate = bValue;
+								return S_OK;
+
 		case CWFGM_SCENARIO_OPTION_PERIMETER_RESOLUTION:
 								if (FAILED(hr = VariantToDouble_(value, &dValue)))	return hr;
 								if (dValue < 0.2)		return E_INVALIDARG;
@@ -1578,6 +1645,30 @@ HRESULT CCWFGM_Scenario::IsXYBurned(const XY_Point &pt, const HSS_Time::WTime &t
 }
 
 
+HRESULT CCWFGM_Scenario::IsXYBurnedSet(const std::vector<XY_Point> &pts, const HSS_Time::WTime &time, std::vector<bool> *burned) const {
+	if (!burned)							return E_POINTER;
+	CRWThreadSemaphoreEngage _semaphore_engage(const_cast<CRWThreadSemaphore&>(m_lock), SEM_FALSE);
+
+	if (m_impl->m_scenario) {
+		try {
+			WTime t(time, m_timeManager);
+			std::vector<XY_PointTempl<fireengine_float_type>> _pts;
+			_pts.reserve(pts.size());
+			for (const auto &pt : pts) {
+				XY_Point _pt(pt);
+				m_impl->m_scenario->toInternal(_pt);
+				_pts.push_back(_pt);
+			}
+			return m_impl->m_scenario->PointsBurned(_pts, &t, *burned);
+		} catch (std::bad_alloc &) {
+			return E_OUTOFMEMORY;
+		}
+	}
+	burned->assign(pts.size(), false);
+	return ERROR_SCENARIO_BAD_STATE;
+}
+
+
 HRESULT CCWFGM_Scenario::GetBurnedBox(const HSS_Time::WTime &time, XY_Rectangle *box) const {
 	if (!box)							return E_POINTER;
 	CRWThreadSemaphoreEngage _semaphore_engage(const_cast<CRWThreadSemaphore&>(m_lock), SEM_FALSE);
@@ -1681,6 +1772,45 @@ HRESULT CCWFGM_Scenario::GetXYStatsSet(const XY_Point& min_pt, const XY_Point& m
 }
 
 
+HRESULT CCWFGM_Scenario::GetXYStatsRaster(const XY_Point &ll, double resolution, std::uint16_t cols, std::uint16_t rows, XYStatOptions *options, const std::vector<std::uint16_t> &stats, std::vector<NumericVariant> *values) {
+	if (!options)									return E_POINTER;
+	if (!values)									return E_POINTER;
+	if (!(options->time))							return ERROR_FIRE_INVALID_TIME;
+	if ((resolution <= 0.0) || (!cols) || (!rows) || (stats.empty()))
+		return E_INVALIDARG;
+	CRWThreadSemaphoreEngage _semaphore_engage(m_lock, SEM_FALSE);
+
+	bool clear = false;
+	HRESULT hr;
+	if ((!m_impl->m_scenario) && (options->interp_method == SCENARIO_XYSTAT_TECHNIQUE_CALCULATE)) {
+		_semaphore_engage.Unlock();
+		if (FAILED(hr = Simulation_Reset(nullptr, "")))
+			return hr;
+		_semaphore_engage.Lock(SEM_FALSE);
+		clear = true;
+	}
+
+	if (m_impl->m_scenario) {
+		try {
+			WTime mt(options->mintime, m_timeManager);
+			WTime t(options->time, m_timeManager);
+			std::vector<std::uint16_t> stats_array(stats);
+			values->resize((std::size_t)cols * rows * stats.size());
+			hr = m_impl->m_scenario->GetStatsRaster(ll, resolution, cols, rows, &mt, &t, (std::uint16_t)stats.size(), stats_array.data(), values->data(), options->interp_method, options->discretization);
+		} catch (std::bad_alloc &) {
+			hr = E_OUTOFMEMORY;
+		}
+	} else
+		hr = ERROR_SCENARIO_BAD_STATE;
+
+	if (clear) {
+		_semaphore_engage.Unlock();
+		Simulation_Clear();
+	}
+	return hr;
+}
+
+
 HRESULT CCWFGM_Scenario::GetNumberSteps(std::uint32_t *steps) const {
 	if (!steps)								return E_POINTER;
 	CRWThreadSemaphoreEngage _semaphore_engage(const_cast<CRWThreadSemaphore&>(m_lock), SEM_FALSE);
@@ -1807,6 +1937,22 @@ HRESULT CCWFGM_Scenario::GetStats(std::uint32_t fire, ICWFGM_Fuel *fuel, HSS_Tim
 }
 
 
+HRESULT CCWFGM_Scenario::GetPhaseSummary(HSS_Time::WTime *time, ScenarioStepPhaseMetrics *summary) const {
+	if (!time)									return E_POINTER;
+	if (!summary)								return E_POINTER;
+	if (!(time->GetTotalMicroSeconds()))		return ERROR_FIRE_INVALID_TIME;
+	CRWThreadSemaphoreEngage _semaphore_engage(const_cast<CRWThreadSemaphore&>(m_lock), SEM_FALSE);
+
+	if (m_impl->m_scenario) {
+		WTime t(*time, m_timeManager);
+		HRESULT hr = m_impl->m_scenario->GetPhaseSummary(&t, summary);
+		time->SetTime(t);
+		return hr;
+	}
+	return ERROR_SCENARIO_BAD_STATE;
+}
+
+
 HRESULT CCWFGM_Scenario::GetStatsPercentage(const std::uint32_t fire,  HSS_Time::WTime *time, const std::uint16_t stat, const double greater_equal, const double less_than, double *stats) const {
 	if (!time)									return E_POINTER;
 	if (!stats)									return E_POINTER;
@@ -1866,6 +2012,9 @@ HRESULT CCWFGM_Scenario::BuildCriticalPath(const ICWFGM_Asset* asset, const std:
 			else {
 				AssetGeometryNode<fireengine_float_type>* g = node->m_geometry.LH_Head();
 				HRESULT hr = ERROR_SCENARIO_ASSET_NOT_ARRIVED;
+				Scenario<fireengine_float_type>::spillHold paged(m_impl->m_scenario, WTime((std::uint64_t)0, m_timeManager));	// rather than page everything in and out again for each one
+				if (FAILED(paged.Result()))
+					return paged.Result();
 
 				while (g->LN_Succ()) {
 					if (g->m_arrived) {
@@ -0,0 +1,256 @@
+/**
+ * WISE_Scenario_Growth_Module: CWFGM_ScenarioEnsemble.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FireEngine_ext.h"
+#include "CWFGM_ScenarioEnsemble.h"
+#include "scenario.h"
+#include "ScenarioTimeStep.h"
+#include "results.h"
+#include "CWFGM_Scenario_Internal.h"
+
+#include <chrono>
+
+
+struct CCWFGM_ScenarioEnsemble::Iterator {
+	std::vector<Member>								*members;
+	std::uint32_t									next;			// next member to run
+	CThreadSemaphore								lock;
+};
+
+
+CCWFGM_ScenarioEnsemble::CCWFGM_ScenarioEnsemble() {
+	m_reset = false;
+	m_workers = 1;
+}
+
+
+CCWFGM_ScenarioEnsemble::~CCWFGM_ScenarioEnsemble() {
+	if (m_reset)
+		Simulation_Clear();
+}
+
+
+HRESULT CCWFGM_ScenarioEnsemble::AddMember(CCWFGM_Scenario *scenario) {
+	if (!scenario)								return E_POINTER;
+	CRWThreadSemaphoreEngage _semaphore_engage(m_lock, SEM_TRUE);
+	if (m_reset)
+		return ERROR_SCENARIO_BAD_STATE;
+
+	for (auto &m : m_members)
+		if (m.m_scenario.get() == scenario)
+			return ERROR_SCENARIO_FIRE_ALREADY_ADDED;
+
+	{
+		CRWThreadSemaphoreEngage _semaphore_engage_s(scenario->m_lock, SEM_FALSE);
+		if (scenario->m_impl->m_scenario)
+			return ERROR_SCENARIO_BAD_STATE;
+	}
+
+	try {
+		Member m;
+		m.m_scenario = scenario;
+		m.m_threads = 0;
+		m.m_result = { S_OK, 0, 0, false };
+		m_members.push_back(m);
+	} catch (std::exception &) {
+		return E_OUTOFMEMORY;
+	}
+	return S_OK;
+}
+
+
+HRESULT CCWFGM_ScenarioEnsemble::RemoveMember(CCWFGM_Scenario *scenario) {
+	if (!scenario)								return E_POINTER;
+	CRWThreadSemaphoreEngage _semaphore_engage(m_lock, SEM_TRUE);
+	if (m_reset)
+		return ERROR_SCENARIO_BAD_STATE;
+
+	for (auto it = m_members.begin(); it != m_members.end(); it++)
+		if (it->m_scenario.get() == scenario) {
+			m_members.erase(it);
+			return S_OK;
+		}
+	return ERROR_SCENARIO_FIRE_UNKNOWN;
+}
+
+
+HRESULT CCWFGM_ScenarioEnsemble::GetMemberCount(std::uint32_t *count) const {
+	if (!count)									return E_POINTER;
+	CRWThreadSemaphoreEngage _semaphore_engage(const_cast<CRWThreadSemaphore&>(m_lock), SEM_FALSE);
+
+	*count = (std::uint32_t)m_members.size();
+	return S_OK;
+}
+
+
+HRESULT CCWFGM_ScenarioEnsemble::MemberAtIndex(std::uint32_t index, boost::intrusive_ptr<CCWFGM_Scenario> *scenario) const {
+	if (!scenario)								return E_POINTER;
+	CRWThreadSemaphoreEngage _semaphore_engage(const_cast<CRWThreadSemaphore&>(m_lock), SEM_FALSE);
+
+	if (index >= m_members.size())
+		return ERROR_SCENARIO_FIRE_UNKNOWN;
+	*scenario = m_members[index].m_scenario;
+	return S_OK;
+}
+
+
+void CCWFGM_ScenarioEnsemble::budgetMember(Member &member, std::uint32_t numThreads) {
+	CRWThreadSemaphoreEngage _semaphore_engage(member.m_scenario->m_lock, SEM_TRUE);
+	if (numThreads) {
+		member.m_threads = member.m_scenario->m_threadingNumProcessors;
+		member.m_scenario->m_threadingNumProcessors = numThreads;
+	} else if (member.m_threads) {
+		member.m_scenario->m_threadingNumProcessors = member.m_threads;
+		member.m_threads = 0;
+	}
+}
+
+
+HRESULT CCWFGM_ScenarioEnsemble::Simulation_Reset(std::shared_ptr<validation::validation_object> valid, const std::string& name, std::uint32_t numThreads) {
+	CRWThreadSemaphoreEngage _semaphore_engage(m_lock, SEM_TRUE);
+	if (m_reset)
+		return ERROR_SCENARIO_BAD_STATE;
+	if (m_members.empty())
+		return ERROR_SCENARIO_NO_FIRES;
+
+	if (!numThreads)
+		numThreads = CWorkerThreadPool::NumberProcessors();
+	std::uint32_t i, cnt = (std::uint32_t)m_members.size();
+	m_workers = (numThreads < cnt) ? numThreads : cnt;
+	std::uint32_t memberThreads = numThreads / m_workers;	// leftover threads go to the members' own pools
+	if (!memberThreads)
+		memberThreads = 1;
+
+	HRESULT hr;
+	for (i = 0; i < cnt; i++) {
+		budgetMember(m_members[i], memberThreads);		// before the member builds its Scenario, so its caches and pool are sized for it
+		if (FAILED(hr = m_members[i].m_scenario->Simulation_Reset(valid, name + "[" + std::to_string(i) + "]"))) {
+			budgetMember(m_members[i], 0);
+			while (i--) {
+				m_members[i].m_scenario->Simulation_Clear();
+				budgetMember(m_members[i], 0);
+			}
+			return hr;
+		}
+		m_members[i].m_result = { S_OK, 0, 0, false };
+	}
+
+	try {
+		for (i = 0; i < cnt; i++) {
+			CCWFGM_Scenario *scenario = m_members[i].m_scenario.get();
+			CRWThreadSemaphoreEngage _semaphore_engage_s(scenario->m_lock, SEM_FALSE);
+			Scenario<fireengine_float_type> *s = scenario->m_impl->m_scenario;
+			if (!m_landscape)
+				m_landscape = s->BuildLandscape();	// the first member builds it as it normally would
+			else
+				m_members[i].m_result.sharedLandscape = s->ShareLandscape(m_landscape);
+		}
+	} catch (std::exception &) {
+		m_landscape.reset();						// members that didn't get the landscape will build their own on their first step
+	}
+
+	m_reset = true;
+	return S_OK;
+}
+
+
+void CCWFGM_ScenarioEnsemble::runMember(Member &member) {
+	{
+		CRWThreadSemaphoreEngage _semaphore_engage(member.m_scenario->m_lock, SEM_FALSE);
+		if (!member.m_scenario->m_impl->m_scenario) {
+			member.m_result.state = ERROR_SCENARIO_BAD_STATE;
+			return;
+		}
+	}
+
+	std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+	HRESULT hr;
+	do {
+		hr = member.m_scenario->Simulation_Step();
+		member.m_result.steps++;
+	} while (hr == S_OK);
+	member.m_result.state = hr;
+	member.m_result.realtime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - start).count();
+}
+
+
+std::uint32_t AFX_CDECL CCWFGM_ScenarioEnsemble::runMembers(APTR parameter) {
+	Iterator *ei = (Iterator *)parameter;
+
+	while (1) {
+		ei->lock.Lock();
+		std::uint32_t index = ei->next++;
+		ei->lock.Unlock();
+
+		if (index >= ei->members->size())
+			return 1;
+
+		Member &m = ei->members->at(index);
+		runMember(m);
+	}
+}
+
+
+HRESULT CCWFGM_ScenarioEnsemble::Simulation_Run() {
+	CRWThreadSemaphoreEngage _semaphore_engage(m_lock, SEM_TRUE);	// the workers write each member's m_result
+	if (!m_reset)
+		return ERROR_SCENARIO_BAD_STATE;
+
+	Iterator ei;
+	ei.members = &m_members;
+	ei.next = 0;
+
+	if (m_workers > 1) {
+		CWorkerThreadPool pool(nullptr, nullptr, m_workers, THREAD_PRIORITY_BELOW_NORMAL, false);
+		pool.SetJobFunction(runMembers, &ei);
+		pool.StartJob();
+		pool.BlockOnJob();
+	} else
+		runMembers(&ei);
+
+	for (auto &m : m_members)
+		if (FAILED(m.m_result.state))
+			return S_FALSE;
+	return S_OK;
+}
+
+
+HRESULT CCWFGM_ScenarioEnsemble::GetMemberResult(std::uint32_t index, ScenarioEnsembleResult *result) const {
+	if (!result)								return E_POINTER;
+	CRWThreadSemaphoreEngage _semaphore_engage(const_cast<CRWThreadSemaphore&>(m_lock), SEM_FALSE);
+
+	if (index >= m_members.size())
+		return ERROR_SCENARIO_FIRE_UNKNOWN;
+	*result = m_members[index].m_result;
+	return S_OK;
+}
+
+
+HRESULT CCWFGM_ScenarioEnsemble::Simulation_Clear() {
+	CRWThreadSemaphoreEngage _semaphore_engage(m_lock, SEM_TRUE);
+	if (!m_reset)
+		return ERROR_SCENARIO_BAD_STATE;
+
+	for (auto &m : m_members) {
+		m.m_scenario->Simulation_Clear();
+		budgetMember(m, 0);						// back to the member's own setting
+	}
+	m_landscape.reset();						// members hold their own references, so this only frees it once the last of them is cleared
+	m_reset = false;
+	return S_OK;
+}
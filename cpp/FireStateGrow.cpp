@@ -19,7 +19,7 @@
 #include "angles.h"
 #include <assert.h>
 #include <cmath>
-#include <omp.h>
+#include <random>
 #include "propsysreplacement.h"
 
 #include "scenario.h"
@@ -33,8 +33,7 @@
 #include "raytrace.h"
 #include "firepoint.h"
 #include "ScenarioTimeStep.h"
-
-#define QUEUE_UP	64
+#include "ScenarioTrace.h"
 
 template<class _type>
 void FirePoint<_type>::grow2D(const XYZPointType &p_pt, const XYZPointType &s_pt) {
@@ -179,7 +178,24 @@ void FirePoint<_type>::grow3D(const class ScenarioTimeStep<_type> *timeStep, con
 
 
 template<class _type>
-void FirePoint<_type>::Grow(const growVoxelParms<_type> *gvs, ICWFGM_Fuel *fuel) {
+static void growTerrainFetch(const ScenarioTimeStep<_type> *sts, ICWFGM_GridEngine *grid, const XY_PointTempl<_type> &pt, growTerrain<_type> &t) {
+	XY_Point gpt;
+	gpt.x = pt.x;
+	gpt.y = pt.y;
+	sts->m_scenario->fromInternal(gpt);
+	grid->GetElevationData(sts->m_scenario->m_scenario->m_layerThread, gpt, true, &t.z, &t.aspect, &t.azimuth, &t.elev_valid, &t.terrain_valid, nullptr);
+}
+
+
+template<class _type>
+static bool growTerrainNeeded(const FirePoint<_type> *fp) {		// true if this vertex or either neighbour is going to be grown
+	return (fp->m_status == FP_FLAG_NORMAL) || (fp->LN_PredWrap()->m_status == FP_FLAG_NORMAL) || (fp->LN_SuccWrap()->m_status == FP_FLAG_NORMAL);
+}
+
+
+template<class _type>
+bool FirePoint<_type>::GrowPrepare(const growVoxelParms<_type> *gvs, ICWFGM_Fuel *fuel, growPointState<_type> &state,
+	const growTerrain<_type> *c_t, const growTerrain<_type> *p_t, const growTerrain<_type> *s_t) {
 	double latitude = gvs->latitude;
 	double longitude = gvs->longitude;
 	WTimeSpan accel_dtime = gvs->accel_dtime;
@@ -200,23 +216,34 @@ void FirePoint<_type>::Grow(const growVoxelParms<_type> *gvs, ICWFGM_Fuel *fuel)
 
 	HRESULT hr;
 
-	CCWFGM_FuelOverrides overrides;
+	state.fp = this;
+	state.sts = sts;
+	state.fuel = fuel;
+	state.ellipse = false;
+	state.overrides = CCWFGM_FuelOverrides();
+	CCWFGM_FuelOverrides &overrides = state.overrides;
 	sts->m_scenario->GetCorrectedFuel(c_pt, sts->m_time, fuel, overrides);
 
-	XY_Point ppt, spt, cpt;
-	ppt.x = p_pt.x;
-	ppt.y = p_pt.y;
-	spt.x = s_pt.x;
-	spt.y = s_pt.y;
+	XY_Point cpt;
 	cpt.x = c_pt.x;
 	cpt.y = c_pt.y;
-	sts->m_scenario->fromInternal(ppt);
-	sts->m_scenario->fromInternal(spt);
 	sts->m_scenario->fromInternal(cpt);
-	double __z;
-	hr = gvs->grid->GetElevationData(sts->m_scenario->m_scenario->m_layerThread, ppt, true, &__z, &aspect, &azimuth, &elev_valid, &terrain_valid, nullptr); p_pt.z = __z;
-	hr = gvs->grid->GetElevationData(sts->m_scenario->m_scenario->m_layerThread, spt, true, &__z, &aspect, &azimuth, &elev_valid, &terrain_valid, nullptr); s_pt.z = __z;
-	hr = gvs->grid->GetElevationData(sts->m_scenario->m_scenario->m_layerThread, cpt, true, &__z, &aspect, &azimuth, &elev_valid, &terrain_valid, nullptr); c_pt.z = __z;
+	growTerrain<_type> c_f, p_f, s_f;
+	if (!c_t) {
+		growTerrainFetch(sts, gvs->grid, *pred, p_f);
+		growTerrainFetch(sts, gvs->grid, *succ, s_f);
+		growTerrainFetch(sts, gvs->grid, *this, c_f);
+		c_t = &c_f;
+		p_t = &p_f;
+		s_t = &s_f;
+	}
+	p_pt.z = p_t->z;
+	s_pt.z = s_t->z;
+	c_pt.z = c_t->z;
+	aspect = c_t->aspect;
+	azimuth = c_t->azimuth;
+	elev_valid = c_t->elev_valid;
+	terrain_valid = c_t->terrain_valid;
 
 	double fmc, ff;
 
@@ -269,26 +296,14 @@ void FirePoint<_type>::Grow(const growVoxelParms<_type> *gvs, ICWFGM_Fuel *fuel)
 	DFWIData dfwi;
 	bool wx_valid;
 
-	hr = gvs->grid->GetWeatherData(sts->m_scenario->m_scenario->m_layerThread,
-		    cpt, sts->m_time,
+	hr = sts->m_scenario->GetWeatherUTM(sts->m_time, cpt,
 			flags & ((1ull << CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_TEMPORAL) | (1ull << CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_SPATIAL)
 			    | (1ull << CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_PRECIP) | (1ull << CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_WIND) | (1ull << (CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_WIND_VECTOR))
 				| (1ull << CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_TEMP_RH)
 			    | (1ull << CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_CALCFWI) | (1ull << CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_HISTORY)),
-		    &wx, &ifwi, &dfwi, &wx_valid, nullptr);
-
-	/* ── Weather data trace with scenario ID ── */
-	{ void* _sid = (void*)sts->m_scenario;
-	  static void* _sid_log[3] = {};
-	  static int _wx_per_sc[3] = {};
-	  int _si = -1;
-	  for (int i=0;i<3;i++) { if(_sid_log[i]==_sid){_si=i;break;} if(!_sid_log[i]){_sid_log[i]=_sid;_si=i;break;} }
-	  if (_si >= 0 && _wx_per_sc[_si] < 3) { _wx_per_sc[_si]++;
-	    fprintf(stderr, "[WX sc=%p:#%d] t=%lld FFMC=%.4f dBUI=%.4f FWI=%.4f ISI=%.4f RH=%.4f WS=%.4f flags=0x%llx\n",
-	      _sid, _wx_per_sc[_si], (long long)sts->m_time.GetTotalSeconds(),
-	      ifwi.FFMC, dfwi.dBUI, ifwi.FWI, ifwi.ISI, wx.RH, wx.WindSpeed,
-	      (unsigned long long)flags);
-	    fflush(stderr); } }
+		    &wx, &ifwi, &dfwi, &wx_valid);
+
+	SCENARIO_TRACE_VERTEX(ScenarioTraceEvent::GROW_WEATHER, sts->m_scenario, this, (double)sts->m_time.GetTotalSeconds(), ifwi.FFMC, ifwi.FWI, ifwi.ISI);
 
     #ifdef DEBUG_TEST_SLOPE
 	wx.WindDirection = 0.0;
@@ -298,7 +313,7 @@ void FirePoint<_type>::Grow(const growVoxelParms<_type> *gvs, ICWFGM_Fuel *fuel)
 	if (FAILED(hr) || (!wx_valid)) {					// if we couldn't get weather data, for any reason...
 		m_ellipse_ros.x = m_ellipse_ros.y = 0.0;
 		m_status = FP_FLAG_NOFUEL;
-		return;
+		return false;
 	}
 
 	if (gvs->self_fire_timestep->m_scenario->m_scenario->m_sc.RH) {
@@ -319,7 +334,7 @@ void FirePoint<_type>::Grow(const growVoxelParms<_type> *gvs, ICWFGM_Fuel *fuel)
 		else {
 			m_ellipse_ros.x = m_ellipse_ros.y = 0.0;
 			m_status = FP_FLAG_NOWIND;
-			return;
+			return false;
 		}
 	}
 	if (gvs->m_dwd != 0.0)
@@ -400,155 +415,352 @@ void FirePoint<_type>::Grow(const growVoxelParms<_type> *gvs, ICWFGM_Fuel *fuel)
 		m_fbp_fros = fros;
 		m_fbp_raz = CARTESIAN_TO_COMPASS_RADIAN(raz);
 
-		if (flags & (1ull << CWFGM_SCENARIO_OPTION_USE_2DGROWTH)) {
-			grow2D(p_pt, s_pt);
-		} else { /* want 3-d growth */
-			grow3D(sts, c_pt, p_pt, s_pt, aspect, azimuth);
-		}
+		state.c_pt = c_pt;
+		state.p_pt = p_pt;
+		state.s_pt = s_pt;
+		state.aspect = aspect;
+		state.azimuth = azimuth;
+		state.ellipse = true;
+	} else {
+
+		m_ellipse_ros.x = m_ellipse_ros.y = 0.0;
+		m_fbp_ros_ratio = 1.0;
+	}
+
+	state.ffmc = ifwi.FFMC;
+	state.bui = dfwi.dBUI;
+	state.fmc = fmc;
+	state.roseq = roseq;
+	state.flags = flags;
+	state.can_burn = sts->m_scenario->CanBurn(sts->m_time, gvs->centroid, cpt, wx.RH, windSpeed, ifwi.FWI, ifwi.ISI);
+	return true;
+}
+
+
+template<class _type>
+void FirePoint<_type>::growEllipse(const growPointState<_type> &state) {
+	if (state.flags & (1ull << CWFGM_SCENARIO_OPTION_USE_2DGROWTH)) {
+		grow2D(state.p_pt, state.s_pt);
+	} else { /* want 3-d growth */
+		grow3D(state.sts, state.c_pt, state.p_pt, state.s_pt, state.aspect, state.azimuth);
+	}
+}
+
+
+template<class _type>
+void FirePoint<_type>::GrowFinish(growPointState<_type> &state) {
+	const ScenarioTimeStep<_type> *sts = state.sts;
+	ICWFGM_Fuel *fuel = state.fuel;
+	const std::uint64_t flags = state.flags;
 
+	if (state.ellipse) {
 		m_vector_ros = m_ellipse_ros.Length();
 
 		double cfb, cfc, sfc, tfc, fi, ta1, ta2;
 
-		fuel->CalculateFCValues(ifwi.FFMC, dfwi.dBUI, fmc, m_fbp_rsi, m_fbp_ros, (std::int16_t)(flags & 0xffff), &overrides, &cfb, &cfc, &ta1, &ta2, &sfc, &tfc, &fi);
+		fuel->CalculateFCValues(state.ffmc, state.bui, state.fmc, m_fbp_rsi, m_fbp_ros, (std::int16_t)(flags & 0xffff), &state.overrides, &cfb, &cfc, &ta1, &ta2, &sfc, &tfc, &fi);
 		m_fbp_cfb = cfb;
 		m_fbp_fi = fi;
 
-		fuel->CalculateFCValues(ifwi.FFMC, dfwi.dBUI, fmc, m_vector_ros, m_vector_ros, (std::int16_t)(flags & 0xffff), &overrides, &cfb, &cfc, &ta1, &ta2, &sfc, &tfc, &fi);
+		fuel->CalculateFCValues(state.ffmc, state.bui, state.fmc, m_vector_ros, m_vector_ros, (std::int16_t)(flags & 0xffff), &state.overrides, &cfb, &cfc, &ta1, &ta2, &sfc, &tfc, &fi);
 		m_vector_cfb = cfb;
 		m_vector_cfc = cfc;
 		m_vector_sfc = sfc;
 		m_vector_tfc = tfc;
 		m_vector_fi = fi;
-		m_flameLength = flameLength(fuel, cfb, fi, &overrides);
-
-	} else {
+		m_flameLength = flameLength(fuel, cfb, fi, &state.overrides);
+	}
 
+	if (!state.can_burn) {
 		m_ellipse_ros.x = m_ellipse_ros.y = 0.0;
 		m_fbp_ros_ratio = 1.0;
 	}
 
-	bool _cb = sts->m_scenario->CanBurn(sts->m_time, gvs->centroid, cpt, wx.RH, windSpeed, ifwi.FWI, ifwi.ISI);
-	if (!_cb) {
-		m_ellipse_ros.x = m_ellipse_ros.y = 0.0;
-		m_fbp_ros_ratio = 1.0;
+	SCENARIO_TRACE_VERTEX(ScenarioTraceEvent::GROW, sts->m_scenario, this, (double)sts->m_time.GetTotalSeconds(), state.can_burn ? 1.0 : 0.0, state.roseq, (double)m_ellipse_ros.Length());
+	// collect the values of interest for us to store for this point
+}
+
+
+template<class _type>
+void FirePoint<_type>::Grow(const growVoxelParms<_type> *gvs, ICWFGM_Fuel *fuel) {
+	growPointState<_type> state;
+	if (GrowPrepare(gvs, fuel, state)) {
+		if (state.ellipse)
+			growEllipse(state);
+		GrowFinish(state);
 	}
+}
 
-	/* ── Growth gate trace with scenario ID ── */
-	{
-		void* _sid = (void*)sts->m_scenario;
-		/* Per-scenario counters: [0..2] for up to 3 scenarios */
-		static void* _gs_id[3] = {};
-		static int _gs_burn[3]={}, _gs_nobr[3]={}, _gs_total[3]={};
-		static long long _gs_last_t[3] = {};
-		static double _gs_ros_sum[3] = {};
-		static double _gs_ros_max[3] = {};
-		int _si = -1;
-		for(int i=0;i<3;i++){if(_gs_id[i]==_sid){_si=i;break;}if(!_gs_id[i]){_gs_id[i]=_sid;_si=i;break;}}
-		if (_si >= 0) {
-			_gs_total[_si]++;
-			long long t = (long long)sts->m_time.GetTotalSeconds();
-			if (t != _gs_last_t[_si]) {
-				if (_gs_last_t[_si] != 0) {
-					double avg_ros = _gs_burn[_si] > 0 ? _gs_ros_sum[_si]/_gs_burn[_si] : 0;
-					fprintf(stderr, "[GROW-STEP sc=%p] t=%lld total=%d yes=%d no=%d avg_ros=%.4f max_ros=%.4f\n",
-						_sid, _gs_last_t[_si], _gs_total[_si]-1, _gs_burn[_si], _gs_nobr[_si], avg_ros, _gs_ros_max[_si]);
-				}
-				_gs_last_t[_si] = t;
-				_gs_burn[_si] = 0;
-				_gs_nobr[_si] = 0;
-				_gs_ros_sum[_si] = 0;
-				_gs_ros_max[_si] = 0;
+
+#define GROW_BATCH	64
+
+template<class _type>
+void FirePoint<_type>::GrowEllipses(growPointState<_type> *states, std::uint32_t cnt) {
+	alignas(64) double a[GROW_BATCH], b[GROW_BATCH], c[GROW_BATCH];
+	alignas(64) _type sn[GROW_BATCH], cs[GROW_BATCH], sn_a[GROW_BATCH], cs_a[GROW_BATCH], aspect[GROW_BATCH],
+		cx[GROW_BATCH], cy[GROW_BATCH], cz[GROW_BATCH], px[GROW_BATCH], py[GROW_BATCH], pz[GROW_BATCH], sx[GROW_BATCH], sy[GROW_BATCH], sz[GROW_BATCH],
+		ex[GROW_BATCH], ey[GROW_BATCH];
+	alignas(64) std::uint8_t zero[GROW_BATCH];
+	growPointState<_type> *batch[GROW_BATCH];
+
+    #ifdef _DEBUG
+	static std::atomic<bool> validated(false);
+	if ((cnt) && (!validated.exchange(true))) {						// once per run, before the first real batch
+		double max_error;
+		weak_assert(ValidateEllipses(states->sts, 4096, 1, &max_error) == S_OK);
+	}
+    #endif
+
+	while (cnt) {
+		std::uint32_t i, n = 0, use2D = 0;
+		bool topography = false;
+		for (; (cnt) && (n < GROW_BATCH); states++, cnt--) {		// gather the points that got as far as their ellipse, the sin/cos stay scalar
+			if (!states->ellipse)
+				continue;
+			FirePoint<_type> *fp = states->fp;
+			if (!n) {
+				use2D = (states->flags & (1ull << CWFGM_SCENARIO_OPTION_USE_2DGROWTH)) ? 1 : 0;
+				topography = (states->sts->m_scenario->m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_TOPOGRAPHY)) ? true : false;
+			} else if (use2D != ((states->flags & (1ull << CWFGM_SCENARIO_OPTION_USE_2DGROWTH)) ? 1u : 0u)) {
+				fp->growEllipse(*states);							// can't happen in one scenario, but don't mix them in a batch
+				continue;
+			}
+			batch[n] = states;
+			a[n] = (fp->m_fbp_ros + fp->m_fbp_bros) * 0.5;			// have to convert from ROS, etc. to Gwyn's required a, b, c
+			b[n] = fp->m_fbp_fros;
+			c[n] = (fp->m_fbp_ros - fp->m_fbp_bros) * 0.5;
+			::sincos(fp->m_fbp_raz, &sn[n], &cs[n]);
+			::sincos((_type)states->azimuth, &sn_a[n], &cs_a[n]);
+			aspect[n] = ((topography) && (states->aspect > 0.0)) ? (_type)states->aspect : 0.0;
+			cx[n] = states->c_pt.x;	cy[n] = states->c_pt.y;	cz[n] = states->c_pt.z;
+			px[n] = states->p_pt.x;	py[n] = states->p_pt.y;	pz[n] = states->p_pt.z;
+			sx[n] = states->s_pt.x;	sy[n] = states->s_pt.y;	sz[n] = states->s_pt.z;
+			n++;
+		}
+
+		if (use2D) {
+			#pragma omp simd
+			for (i = 0; i < n; i++) {								// FirePoint::grow2D()
+				const double a2 = a[i] * a[i], b2 = b[i] * b[i];
+				const _type _x = sx[i] - px[i], _y = sy[i] - py[i];
+				const _type xcsysn = _x * cs[i] - _y * sn[i];
+				const _type xsnycs = _x * sn[i] + _y * cs[i];
+				const _type denominator = sqrt(a2 * xcsysn * xcsysn + b2 * xsnycs * xsnycs);
+				const _type d = (denominator > 0.0) ? denominator : 1.0;
+				zero[i] = (denominator > 0.0) ? 0 : 1;
+				ex[i] = zero[i] ? 0.0 : ((b2 * cs[i] * xsnycs - a2 * sn[i] * xcsysn) / d + c[i] * sn[i]);
+				ey[i] = zero[i] ? 0.0 : ((-b2 * sn[i] * xsnycs - a2 * cs[i] * xcsysn) / d + c[i] * cs[i]);
 			}
-			if (_cb) {
-				_gs_burn[_si]++;
-				double _ros_mag = sqrt((double)(m_ellipse_ros.x*m_ellipse_ros.x + m_ellipse_ros.y*m_ellipse_ros.y));
-				_gs_ros_sum[_si] += _ros_mag;
-				if (_ros_mag > _gs_ros_max[_si]) _gs_ros_max[_si] = _ros_mag;
-				static int _gy_sc[3] = {};
-				if (_gy_sc[_si] < 5) { _gy_sc[_si]++;
-					fprintf(stderr, "[GROW-YES sc=%p] t=%lld roseq=%.8g eros=(%.8g,%.8g)\n",
-						_sid, t, roseq, (double)m_ellipse_ros.x, (double)m_ellipse_ros.y);
-					fflush(stderr);
-				}
 		} else {
-			_gs_nobr[_si]++;
+			#pragma omp simd
+			for (i = 0; i < n; i++) {								// FirePoint::grow3D(), with the cross products written out
+				const _type asp = aspect[i];
+				const _type nl = 1.0 / sqrt(1.0 + asp * asp);		// N, the upward normal to the slope, is (0, 0, 1) with no slope
+				const _type Nx = -asp * cs_a[i] * nl, Ny = -asp * sn_a[i] * nl, Nz = nl;
+
+				_type tx = sn[i], ty = cs[i], tz = (cs_a[i] * tx + sn_a[i] * ty) * asp;	// theta, RAZ is in COMPASS
+				const _type tl = 1.0 / sqrt(tx * tx + ty * ty + tz * tz);
+				tx *= tl;	ty *= tl;	tz *= tl;
+
+				const _type plen = sqrt((cx[i] - px[i]) * (cx[i] - px[i]) + (cy[i] - py[i]) * (cy[i] - py[i]) + (cz[i] - pz[i]) * (cz[i] - pz[i]));
+				const _type slen = sqrt((cx[i] - sx[i]) * (cx[i] - sx[i]) + (cy[i] - sy[i]) * (cy[i] - sy[i]) + (cz[i] - sz[i]) * (cz[i] - sz[i]));
+				_type rx = slen * (sx[i] - cx[i]) - plen * (px[i] - cx[i]);
+				_type ry = slen * (sy[i] - cy[i]) - plen * (py[i] - cy[i]);
+				_type rz = ((rx == 0.0) && (ry == 0.0)) ? 1.0 : (cs_a[i] * rx + sn_a[i] * ry) * asp;
+				const _type rl = 1.0 / sqrt(rx * rx + ry * ry + rz * rz);
+				rx *= rl;	ry *= rl;	rz *= rl;
+
+				const _type NTx = Ny * tz - Nz * ty, NTy = Nz * tx - Nx * tz, NTz = Nx * ty - Ny * tx;	// N x theta
+				const _type nx = ry * Nz - rz * Ny, ny = rz * Nx - rx * Nz, nz = rx * Ny - ry * Nx;		// r x N, G. Richards Eq. 28
+
+				const _type cosalpha = nx * tx + ny * ty + nz * tz;							// G. Richards Eq. 29
+				const _type sinalpha = NTx * nx + NTy * ny + NTz * nz;						// G. Richards Eq. 30
+				const _type divider = sqrt(a[i] * a[i] * cosalpha * cosalpha + b[i] * b[i] * sinalpha * sinalpha);
+				const _type d = (divider != 0.0) ? divider : 1.0;
+				zero[i] = (divider != 0.0) ? 0 : 1;
+				const _type Xalpha = (a[i] * a[i] * cosalpha) / d + c[i];					// G. Richards Eq. 8
+				const _type Yalpha = (b[i] * b[i] * sinalpha) / d;							// G. Richards Eq. 9
+				ex[i] = zero[i] ? 0.0 : (Xalpha * tx + Yalpha * NTx);						// G. Richards Eq. 19
+				ey[i] = zero[i] ? 0.0 : (Xalpha * ty + Yalpha * NTy);						// G. Richards Eq. 20
+			}
 		}
+
+		for (i = 0; i < n; i++) {
+			FirePoint<_type> *fp = batch[i]->fp;
+		    #ifdef _DEBUG
+			fp->growEllipse(*batch[i]);								// check the batch against the scalar path
+			const _type tol = 1e-6 * (1.0 + fp->m_ellipse_ros.Length());
+			weak_assert((fabs(fp->m_ellipse_ros.x - ex[i]) <= tol) && (fabs(fp->m_ellipse_ros.y - ey[i]) <= tol));
+		    #endif
+			fp->m_ellipse_ros.x = ex[i];
+			fp->m_ellipse_ros.y = ey[i];
+			if (zero[i])
+				fp->m_fbp_ros_ratio = 1.0;
 		}
 	}
-	// collect the values of interest for us to store for this point
 }
 
+
 template<class _type>
-std::uint32_t AFX_CDECL growVoxelInit(APTR parameter) {
-	growVoxelIterator<_type> *gvs = (growVoxelIterator<_type>*)parameter;
+HRESULT FirePoint<_type>::ValidateEllipses(const ScenarioTimeStep<_type> *sts, std::uint32_t count, std::uint32_t seed, double *max_error) {
+	if (!max_error)								return E_POINTER;
+	*max_error = 0.0;
+	if (!sts)									return E_POINTER;
+
+	struct edge {
+		double ros, bros, fros, raz, azimuth, aspect;
+		double cx, cy, cz, px, py, pz, sx, sy, sz;
+	};
+	static const edge edges[] = {
+		{ 10.0, 1.0, 3.0, 0.0, 0.0, 0.0,	0.0, 0.0, 0.0,	-1.0, 0.0, 0.0,	1.0, 0.0, 0.0 },						// straight front, no slope
+		{ 10.0, 1.0, 3.0, 0.5, 1.0, 0.3,	0.0, 0.0, 0.0,	1.0, 1.0, 0.0,	1.0, 1.0, 0.0 },						// neighbours on top of each other
+		{ 10.0, 1.0, 3.0, 0.5, 1.0, 0.3,	0.0, 0.0, 0.0,	0.0, 0.0, 0.0,	0.0, 0.0, 0.0 },						// all three on top of each other
+		{ 0.0, 0.0, 0.0, 1.0, 2.0, 0.5,		0.0, 0.0, 0.0,	-1.0, 1.0, 0.0,	1.0, 1.0, 0.0 },						// no spread at all
+		{ 2.0, 5.0, 1.0, 2.0, 0.5, 0.1,		0.0, 0.0, 0.0,	-1.0, -1.0, 0.0, 1.0, -1.0, 0.0 },						// backing faster than head
+		{ 10.0, 1.0, 0.0, 3.0, 4.0, 0.2,	0.0, 0.0, 0.0,	0.0, -1.0, 0.0,	0.0, 1.0, 0.0 },						// no flank spread
+		{ 10.0, 1.0, 3.0, CONSTANTS_NAMESPACE::Pi<double>(), CONSTANTS_NAMESPACE::Pi<double>(), 1e-9,
+											0.0, 0.0, 0.0,	-1.0, 0.0, 0.0,	1.0, 0.0, 0.0 },						// barely any slope
+		{ 30.0, 2.0, 8.0, -CONSTANTS_NAMESPACE::Pi<double>() * 0.5, -1.0, 10.0,
+											0.0, 0.0, 5.0,	-1.0, 0.5, 0.0,	1.0, 0.5, 10.0 },						// very steep
+		{ 10.0, 1.0, 3.0, (2.0 * CONSTANTS_NAMESPACE::Pi<double>()), 0.0, 0.5,
+											1e6, 1e6, 1e3,	1e6 - 1e-3, 1e6, 1e3, 1e6 + 1e-3, 1e6, 1e3 },			// far from the origin, close together
+		{ 10.0, 1.0, 3.0, 0.25, 0.25, 0.5,	0.0, 0.0, 0.0,	-1.0, -1.0, -1.0, 1.0, 1.0, 1.0 },						// neighbours in a line through the point
+	};
+	const std::uint32_t num_edges = sizeof(edges) / sizeof(edges[0]);
+
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<double> ros_d(0.0, 100.0), unit_d(0.0, 1.0), angle_d(-(2.0 * CONSTANTS_NAMESPACE::Pi<double>()), (2.0 * CONSTANTS_NAMESPACE::Pi<double>())),
+		aspect_d(0.0, 2.0), loc_d(-1e4, 1e4), off_d(-50.0, 50.0), z_d(-20.0, 20.0);
+
+	const std::uint32_t n = num_edges + count;
+	std::vector<FirePoint<_type>> fps(n);
+	std::vector<growPointState<_type>> states(n);
+	std::vector<XYVectorType> batched(n);
+
+	for (std::uint32_t dimensions = 2; dimensions <= 3; dimensions++) {	// separately, GrowEllipses() won't mix them in a batch
+		for (std::uint32_t i = 0; i < n; i++) {
+			FirePoint<_type> &fp = fps[i];
+			growPointState<_type> &state = states[i];
+			edge e;
+			if (i < num_edges)
+				e = edges[i];
+			else {
+				e.ros = ros_d(gen);
+				e.bros = e.ros * unit_d(gen);
+				e.fros = e.ros * unit_d(gen);
+				e.raz = angle_d(gen);
+				e.azimuth = angle_d(gen);
+				e.aspect = aspect_d(gen);
+				e.cx = loc_d(gen);					e.cy = loc_d(gen);					e.cz = z_d(gen);
+				e.px = e.cx + off_d(gen);			e.py = e.cy + off_d(gen);			e.pz = e.cz + z_d(gen);
+				e.sx = e.cx + off_d(gen);			e.sy = e.cy + off_d(gen);			e.sz = e.cz + z_d(gen);
+			}
+			fp.m_fbp_ros = e.ros;
+			fp.m_fbp_bros = e.bros;
+			fp.m_fbp_fros = e.fros;
+			fp.m_fbp_raz = (_type)e.raz;
+			fp.m_fbp_ros_ratio = 1.0;
+			state.fp = &fp;
+			state.sts = sts;
+			state.c_pt.x = e.cx;	state.c_pt.y = e.cy;	state.c_pt.z = e.cz;
+			state.p_pt.x = e.px;	state.p_pt.y = e.py;	state.p_pt.z = e.pz;
+			state.s_pt.x = e.sx;	state.s_pt.y = e.sy;	state.s_pt.z = e.sz;
+			state.aspect = e.aspect;
+			state.azimuth = e.azimuth;
+			state.flags = (dimensions == 2) ? (1ull << CWFGM_SCENARIO_OPTION_USE_2DGROWTH) : 0;
+			state.ellipse = true;
+		}
+
+		GrowEllipses(&states[0], n);
+		for (std::uint32_t i = 0; i < n; i++)
+			batched[i] = fps[i].m_ellipse_ros;
+
+		for (std::uint32_t i = 0; i < n; i++) {
+			fps[i].growEllipse(states[i]);
+			const double error = std::max(fabs(fps[i].m_ellipse_ros.x - batched[i].x), fabs(fps[i].m_ellipse_ros.y - batched[i].y)) / (1.0 + fps[i].m_ellipse_ros.Length());
+			if ((error > *max_error) || (std::isnan(error)))
+				*max_error = error;
+		}
+	}
+	return ((*max_error <= 1e-6) && (!std::isnan(*max_error))) ? S_OK : S_FALSE;
+}
 
-	growVoxelParms<_type> cgvs(gvs->gvp);
 
+template<class _type>
+static void growPoints(growPointState<_type> *states, std::uint32_t cnt) {
+	FirePoint<_type>::GrowEllipses(states, cnt);
+	for (std::uint32_t i = 0; i < cnt; i++)
+		states[i].fp->GrowFinish(states[i]);
+}
+
+static bool claimChunk(growVoxelQueue *queue, bool own, std::uint32_t &chunk) {
+	std::uint64_t range = queue->range.load(std::memory_order_relaxed);
 	while (1) {
-		std::uint32_t cnt = 0, l1 = 0, l2 = 0;
-		gvs->lock_ll.Lock();
-		ScenarioFire<_type> *sf_loop = gvs->sf;
-		FireFront<_type> *ff_loop = gvs->ff;
-		FirePoint<_type> *end_fp, *fp_loop = gvs->fp;
-
-		for (; gvs->sf->LN_Succ(); gvs->sf = gvs->sf->LN_Succ(), l1 = 1) {
-			if (l1)
-				gvs->ff = gvs->sf->LH_Head();
-			for (; gvs->ff->LN_Succ(); gvs->ff = gvs->ff->LN_Succ(), l2 = 1) {
-				if (l2)
-					gvs->fp = gvs->ff->LH_Head();
-				for (; gvs->fp->LN_Succ(); gvs->fp = gvs->fp->LN_Succ()) {
-					if (cnt >= gvs->gvp.queue_up) {
-						goto DONE_SCAN;
-					}
-					if (gvs->fp->m_status == FP_FLAG_NORMAL)
-						cnt++;					// we find QUEUE_UP # of points to grow
-				}
-			}
+		std::uint32_t begin = (std::uint32_t)range, end = (std::uint32_t)(range >> 32);
+		if (begin >= end)
+			return false;
+		std::uint64_t next = own ? (range + 1) : ((((std::uint64_t)(end - 1)) << 32) | begin);
+		if (queue->range.compare_exchange_weak(range, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+			chunk = own ? begin : (end - 1);
+			return true;
 		}
+	}
+}
 
 
-DONE_SCAN:
-		end_fp = gvs->fp;
+template<class _type>
+std::uint32_t AFX_CDECL growTerrainInit(APTR parameter) {
+	growTerrainIterator<_type> *gts = (growTerrainIterator<_type>*)parameter;
+	while (1) {
+		std::uint32_t i = gts->next.fetch_add(1, std::memory_order_relaxed) * gts->chunk;
+		if (i >= gts->num_points)
+			return 1;
+		std::uint32_t end = (std::min)(i + gts->chunk, gts->num_points);
+		for (; i < end; i++)
+			growTerrainFetch(gts->sts, gts->grid, *gts->points[i].fp, *gts->points[i].terrain);
+	}
+}
+
 
-		gvs->lock_ll.Unlock();					// let other threads have access to this struct
+template<class _type>
+std::uint32_t AFX_CDECL growVoxelInit(APTR parameter) {
+	growVoxelIterator<_type> *gvs = (growVoxelIterator<_type>*)parameter;
+	std::uint32_t self = NumaTopology::WorkerSlot();			// the worker's own run, so it's on the memory it first touched
+	if (self >= gvs->num_queues)
+		self = gvs->next_queue.fetch_add(1) % gvs->num_queues;
+	std::vector<growPointState<_type>> states(gvs->chunk);
 
-		if (!cnt) {						// if we're at the end of the list
-			return 1;					// return 'cause we're done this job
+	while (1) {
+		std::uint32_t chunk;
+		if (!claimChunk(gvs->queues + self, true, chunk)) {
+			std::uint32_t i;
+			for (i = 1; i < gvs->num_queues; i++)			// ours is empty, so take the last chunk from someone else's
+				if (claimChunk(gvs->queues + ((self + i) % gvs->num_queues), false, chunk))
+					break;
+			if (i == gvs->num_queues)
+				return 1;								// everything's been claimed, we're done this job
 		}
 
-		l1 = l2 = 0;
-		for (; sf_loop->LN_Succ(); sf_loop = sf_loop->LN_Succ(), l1 = 1) {
-		  if (l1)
-			  ff_loop = sf_loop->LH_Head();
-		  cgvs.self_fire = sf_loop;
-		  cgvs.accel_dtime = cgvs.self_fire_timestep->m_time - sf_loop->Ignition()->m_ignitionTime;
-		  for (; ff_loop->LN_Succ(); ff_loop = ff_loop->LN_Succ(), l2 = 1) {
-		    if (l2)
-			    fp_loop = ff_loop->LH_Head();
-		    cgvs.self = ff_loop;
-		    for (; fp_loop->LN_Succ(); fp_loop = fp_loop->LN_Succ()) {
-					if (fp_loop == end_fp)
-						goto DONE_GROW;
-					if (fp_loop->m_status == FP_FLAG_NORMAL) {
-						bool valid;
-						ICWFGM_Fuel *fuel = sf_loop->TimeStep()->m_scenario->GetFuel(sf_loop->TimeStep()->m_time, *fp_loop, valid);
-						bool result;
-						if ((valid) && (fuel) && (SUCCEEDED(fuel->IsNonFuel(&result))) && (!result)) {
-
-							fp_loop->Grow(&cgvs, fuel);
-						} else {
-							fp_loop->m_ellipse_ros.x = fp_loop->m_ellipse_ros.y = 0.0;
-							fp_loop->m_fbp_ros_ratio = 1.0;
-							fp_loop->m_status = FP_FLAG_NOFUEL;
-						}
-					}
-		    }
-		  }
+		std::uint32_t prepared = 0,
+			i = chunk * gvs->chunk,
+			end = (std::min)(i + gvs->chunk, gvs->num_points);
+		for (; i < end; i++) {
+			FirePoint<_type> *fp = gvs->points[i].fp;
+			const growVoxelParms<_type> *cgvs = gvs->points[i].gvs;
+			const std::uint32_t index = gvs->points[i].index;
+			bool valid, nonfuel;
+			ICWFGM_Fuel *fuel = cgvs->self_fire_timestep->m_scenario->GetFuel(cgvs->self_fire_timestep->m_time, *fp, valid, nonfuel);
+			if (!nonfuel) {
+				if (fp->GrowPrepare(cgvs, fuel, states[prepared], cgvs->terrain + index,
+					cgvs->terrain + (index ? (index - 1) : (cgvs->num_terrain - 1)), cgvs->terrain + ((index + 1) % cgvs->num_terrain)))
+					prepared++;
+			} else {
+				fp->m_ellipse_ros.x = fp->m_ellipse_ros.y = 0.0;
+				fp->m_fbp_ros_ratio = 1.0;
+				fp->m_status = FP_FLAG_NOFUEL;
+			}
 		}
-DONE_GROW:
-		;
+		growPoints(states.data(), prepared);			// ellipses for the whole chunk at once
 	}
 }
 
@@ -587,22 +799,38 @@ void FireFront<_type>::GrowPoints() {
 	gvs.target_idx = s->m_scenario->m_windTargetIndex;
 	gvs.target_sub_idx = s->m_scenario->m_windTargetSubIndex;
 
-	FirePoint<_type> *fp = LH_Head();
-	while (fp->LN_Succ()) {
+	std::vector<growTerrain<_type>> terrain;					// each vertex's terrain is fetched once, rather than again by both of its neighbours
+	FirePoint<_type> *fp;
+	for (fp = LH_Head(); fp->LN_Succ(); fp = fp->LN_Succ()) {
+		terrain.emplace_back();
+		if (growTerrainNeeded(fp))
+			growTerrainFetch(gvs.self_fire_timestep, gvs.grid, *fp, terrain.back());
+	}
+	const std::uint32_t n = (std::uint32_t)terrain.size();
+	gvs.terrain = terrain.data();
+	gvs.num_terrain = n;
+
+	std::vector<growPointState<_type>> states(GROW_BATCH);
+	std::uint32_t prepared = 0, index = 0;
+
+	for (fp = LH_Head(); fp->LN_Succ(); fp = fp->LN_Succ(), index++) {
 		if (fp->m_status == FP_FLAG_NORMAL) {
-			bool valid;
-			ICWFGM_Fuel *fuel = gvs.self_fire_timestep->m_scenario->GetFuel(gvs.self_fire_timestep->m_time, *fp, valid);
-			bool result;
-			if ((valid) && (fuel) && (SUCCEEDED(fuel->IsNonFuel(&result))) && (!result)) {
-				fp->Grow(&gvs, fuel);
+			bool valid, nonfuel;
+			ICWFGM_Fuel *fuel = gvs.self_fire_timestep->m_scenario->GetFuel(gvs.self_fire_timestep->m_time, *fp, valid, nonfuel);
+			if (!nonfuel) {
+				if ((fp->GrowPrepare(&gvs, fuel, states[prepared], &terrain[index], &terrain[index ? (index - 1) : (n - 1)], &terrain[(index + 1) % n]))
+					&& (++prepared == GROW_BATCH)) {
+					growPoints(states.data(), prepared);
+					prepared = 0;
+				}
 			} else {
 				fp->m_ellipse_ros.x = fp->m_ellipse_ros.y = 0.0;
 				fp->m_fbp_ros_ratio = 1.0;
 				fp->m_status = FP_FLAG_NOFUEL;
 			}
 		}
-		fp = fp->LN_Succ();
 	}
+	growPoints(states.data(), prepared);
 }
 
 
@@ -627,13 +855,15 @@ void ScenarioTimeStep<_type>::StatsFires() {
 		sf = sf->LN_Succ();
 	}
 
-	std::uint32_t queue_up;
-	if (m_scenario->m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_SPATIAL))
-		queue_up = QUEUE_UP;
-	else
-		queue_up = QUEUE_UP >> 1;
+	const std::uint32_t queue_up = m_scenario->m_statsTuner.Chunk();
+	const auto start = std::chrono::steady_clock::now();
+
+	std::unique_lock<std::mutex> pool;							// held across both jobs below
+	if ((m_scenario->m_pool) && (m_scenario->m_statsTuner.Parallel(total_num_points)))
+		pool = m_scenario->AcquirePool();
+	const bool parallel = (pool.owns_lock()) && (m_scenario->m_pool);
 
-	if ((total_num_points > queue_up) && (m_scenario->m_pool)) {
+	if (parallel) {
 		growVoxelIterator<_type> gvs;
 		gvs.gvp.self_fire_timestep = this;
 		Centroid(&gvs.gvp.centroid);
@@ -665,18 +895,107 @@ void ScenarioTimeStep<_type>::StatsFires() {
 
 		gvs.gvp.queue_up = queue_up;
 
-		for (gvs.sf = m_fires.LH_Head(); gvs.sf->LN_Succ(); gvs.sf = gvs.sf->LN_Succ())
-			for (gvs.ff = gvs.sf->LH_Head(); gvs.ff->LN_Succ(); gvs.ff = gvs.ff->LN_Succ())
-				for (gvs.fp = gvs.ff->LH_Head(); gvs.fp->LN_Succ(); gvs.fp = gvs.fp->LN_Succ()) {
-					//move to current thread for testing
-					weak_assert(gvs.sf);
-					m_scenario->m_pool->SetJobFunction(growVoxelInit<_type>, &gvs);
-					m_scenario->m_pool->StartJob();
-					m_scenario->m_pool->BlockOnJob();
-					goto DONE;
+		std::uint32_t num_fronts = 0, num_points = 0, num_vertices = 0, num_terrain = 0;
+		FireFront<_type> *ff;
+		FirePoint<_type> *fp;
+		for (sf = m_fires.LH_Head(); sf->LN_Succ(); sf = sf->LN_Succ())
+			for (ff = sf->LH_Head(); ff->LN_Succ(); ff = ff->LN_Succ(), num_fronts++)
+				for (fp = ff->LH_Head(); fp->LN_Succ(); fp = fp->LN_Succ(), num_vertices++) {
+					if (fp->m_status == FP_FLAG_NORMAL)
+						num_points++;
+					if (growTerrainNeeded(fp))
+						num_terrain++;
 				}
-DONE:
-		;
+
+		if (num_points) {
+			if (m_scenario->m_omp_gvs_array_size < num_fronts) {
+				if (m_scenario->m_omp_gvs_array)	free(m_scenario->m_omp_gvs_array);
+				m_scenario->m_omp_gvs_array = (growVoxelParms<_type>*)malloc(num_fronts * sizeof(growVoxelParms<_type>));
+				m_scenario->m_omp_gvs_array_size = m_scenario->m_omp_gvs_array ? num_fronts : 0;
+			}
+			if (m_scenario->m_omp_gps_array_size < num_points) {
+				if (m_scenario->m_omp_gps_array)	free(m_scenario->m_omp_gps_array);
+				m_scenario->m_omp_gps_array = (growPointStruct<_type>*)malloc(num_points * sizeof(growPointStruct<_type>));
+				m_scenario->m_omp_gps_array_size = m_scenario->m_omp_gps_array ? num_points : 0;
+				m_scenario->FirstTouch(m_scenario->m_omp_gps_array, m_scenario->m_omp_gps_array_size * sizeof(growPointStruct<_type>));
+			}
+			if (m_scenario->m_omp_terrain_array_size < num_vertices) {
+				if (m_scenario->m_omp_terrain_array)	free(m_scenario->m_omp_terrain_array);
+				m_scenario->m_omp_terrain_array = (growTerrain<_type>*)malloc(num_vertices * sizeof(growTerrain<_type>));
+				m_scenario->m_omp_terrain_array_size = m_scenario->m_omp_terrain_array ? num_vertices : 0;
+				m_scenario->FirstTouch(m_scenario->m_omp_terrain_array, m_scenario->m_omp_terrain_array_size * sizeof(growTerrain<_type>));
+			}
+			if (m_scenario->m_omp_gts_array_size < num_terrain) {
+				if (m_scenario->m_omp_gts_array)	free(m_scenario->m_omp_gts_array);
+				m_scenario->m_omp_gts_array = (growTerrainPoint<_type>*)malloc(num_terrain * sizeof(growTerrainPoint<_type>));
+				m_scenario->m_omp_gts_array_size = m_scenario->m_omp_gts_array ? num_terrain : 0;
+			}
+			if ((!m_scenario->m_omp_gvs_array) || (!m_scenario->m_omp_gps_array) || (!m_scenario->m_omp_terrain_array) || (!m_scenario->m_omp_gts_array))
+				throw std::bad_alloc();
+
+			growVoxelParms<_type> *cgvs = m_scenario->m_omp_gvs_array;		// the per-front parameters are set up once here rather than as each
+			growPointStruct<_type> *gps = m_scenario->m_omp_gps_array;		// worker comes across a new front
+			growTerrain<_type> *terrain = m_scenario->m_omp_terrain_array;
+			growTerrainPoint<_type> *gts = m_scenario->m_omp_gts_array;
+			for (sf = m_fires.LH_Head(); sf->LN_Succ(); sf = sf->LN_Succ())
+				for (ff = sf->LH_Head(); ff->LN_Succ(); ff = ff->LN_Succ(), cgvs++) {
+					new (cgvs) growVoxelParms<_type>(gvs.gvp);
+					cgvs->self_fire = sf;
+					cgvs->self = ff;
+					cgvs->accel_dtime = m_time - sf->Ignition()->m_ignitionTime;
+					cgvs->terrain = terrain;
+					std::uint32_t index = 0;
+					for (fp = ff->LH_Head(); fp->LN_Succ(); fp = fp->LN_Succ(), index++) {
+						if (fp->m_status == FP_FLAG_NORMAL) {
+							gps->fp = fp;
+							gps->gvs = cgvs;
+							gps->index = index;
+							gps++;
+						}
+						if (growTerrainNeeded(fp)) {
+							gts->fp = fp;
+							gts->terrain = terrain + index;
+							gts++;
+						}
+					}
+					cgvs->num_terrain = index;
+					terrain += index;
+				}
+
+			growTerrainIterator<_type> gti;						// every vertex's terrain is fetched once up front, rather than by each
+			gti.points = m_scenario->m_omp_gts_array;			// of the (up to) three points that use it
+			gti.num_points = num_terrain;
+			gti.chunk = queue_up;
+			gti.next = 0;
+			gti.sts = this;
+			gti.grid = gvs.gvp.grid;
+
+			m_scenario->m_pool->SetJobFunction(growTerrainInit<_type>, &gti);
+			m_scenario->m_pool->StartJob();
+			m_scenario->m_pool->BlockOnJob();
+
+			std::uint32_t num_chunks = (num_points + queue_up - 1) / queue_up;
+			std::uint32_t num_queues = m_scenario->m_numthreads ? m_scenario->m_numthreads : 1;
+			if (num_queues > num_chunks)
+				num_queues = num_chunks;
+			std::vector<growVoxelQueue> queues(num_queues);
+			for (std::uint32_t i = 0; i < num_queues; i++) {			// contiguous runs, so each worker starts on its own part of the perimeter
+				std::uint64_t begin = (std::uint64_t)num_chunks * i / num_queues,
+					end = (std::uint64_t)num_chunks * (i + 1) / num_queues;
+				queues[i].range = begin | (end << 32);
+			}
+
+			gvs.points = m_scenario->m_omp_gps_array;
+			gvs.num_points = num_points;
+			gvs.chunk = queue_up;
+			gvs.queues = queues.data();
+			gvs.num_queues = num_queues;
+			gvs.next_queue = 0;
+
+			m_scenario->m_pool->SetJobFunction(growVoxelInit<_type>, &gvs);
+			m_scenario->m_pool->StartJob();
+			m_scenario->m_pool->BlockOnJob();
+		}
 	} else {
 		ScenarioFire<_type> *ff = m_fires.LH_Head();
 		while (ff->LN_Succ()) {
@@ -684,6 +1003,7 @@ DONE:
 			ff = ff->LN_Succ();
 		}
 	}
+	m_scenario->m_statsTuner.Record(total_num_points, parallel, m_scenario->m_numthreads, start);
 }
 
 
@@ -23,6 +23,7 @@
 #include "ScenarioTimeStep.h"
 #include "scenario.h"
 #include "FireEngine_ext.h"
+#include "ScenarioTrace.h"
 
 
 template<class _type>
@@ -63,15 +64,7 @@ void FireFront<_type>::AddPoints() {
 		perimeterResolution = Fire()->TimeStep()->m_scenario->m_scenario->perimeterResolution(0.0);
 	Fire()->TimeStep()->m_scenario->gridToInternal1D(perimeterResolution);
 
-	{
-		static int _ap_call = 0;
-		if (_ap_call < 10) {
-			fprintf(stderr, "[AP#%d] perimRes=%.15e npts=%u fronts=%p\n",
-				_ap_call, (double)perimeterResolution, NumPoints(), (void*)this);
-			fflush(stderr);
-		}
-		_ap_call++;
-	}
+	SCENARIO_TRACE_FRONT(ScenarioTraceEvent::ADD_POINTS, Fire()->TimeStep()->m_scenario, this, (double)perimeterResolution, (double)NumPoints());
 
 	while (next->LN_Succ()) {
 		if ((prev->m_status == FP_FLAG_NORMAL) || (curr->m_status == FP_FLAG_NORMAL) || (next->m_status == FP_FLAG_NORMAL)) {
@@ -98,20 +91,7 @@ void FireFront<_type>::AddPoints() {
 
 					new_pt = new FirePoint<_type>(loc);
 					InsertPoint(new_pt, (FirePoint<_type>*)last_pt);
-					{
-						static int _ip_log = 0;
-						if (_ip_log < 200) {
-							fprintf(stderr, "[ADDPT#%d] side=PREV new=(%.15e,%.15e) "
-								"ref1=(%.15e,%.15e) ref2=(%.15e,%.15e) "
-								"dist=%.15e df=%.6f sa=%.6f\n",
-								_ip_log, (double)new_pt->x, (double)new_pt->y,
-								(double)last_pt->x, (double)last_pt->y,
-								(double)curr->x, (double)curr->y,
-								(double)dist, (double)dist_factor, (double)sin_angle);
-							fflush(stderr);
-							_ip_log++;
-						}
-					}
+					SCENARIO_TRACE_VERTEX(ScenarioTraceEvent::ADD_POINT, Fire()->TimeStep()->m_scenario, new_pt, (double)new_pt->x, (double)new_pt->y, (double)dist, (double)dist_factor);
 					last_pt = new_pt;
 					dist_factor *= 0.5;
 					cnt_prev++;
@@ -138,20 +118,7 @@ void FireFront<_type>::AddPoints() {
 
 					new_pt = new FirePoint<_type>(loc);
 					InsertPoint(new_pt, (FirePoint<_type>*)curr);
-					{
-						static int _ip_log2 = 0;
-						if (_ip_log2 < 200) {
-							fprintf(stderr, "[ADDPT#%d] side=NEXT new=(%.15e,%.15e) "
-								"ref1=(%.15e,%.15e) ref2=(%.15e,%.15e) "
-								"dist=%.15e df=%.6f sa=%.6f\n",
-								200 + _ip_log2, (double)new_pt->x, (double)new_pt->y,
-								(double)last_pt->x, (double)last_pt->y,
-								(double)curr->x, (double)curr->y,
-								(double)dist, (double)dist_factor, (double)sin_angle);
-							fflush(stderr);
-							_ip_log2++;
-						}
-					}
+					SCENARIO_TRACE_VERTEX(ScenarioTraceEvent::ADD_POINT, Fire()->TimeStep()->m_scenario, new_pt, (double)new_pt->x, (double)new_pt->y, (double)dist, (double)dist_factor);
 					last_pt = new_pt;
 					dist_factor *= 0.5;
 					cnt_next++;
@@ -327,16 +294,7 @@ void FireFront<_type>::equiDistantPoints(const FirePoint<_type> *start, const Fi
 	_type steps = ceil(dist_factor);
 	std::uint32_t cnt_next, num = (std::uint32_t)steps;
 
-	{
-		static int _eq_call = 0;
-		if (_eq_call < 50) {
-			fprintf(stderr, "[EQ#%d] poly=%p df=%.6f steps=%u start=(%.6f,%.6f) end=(%.6f,%.6f)\n",
-				_eq_call, (void*)this, (double)dist_factor, num,
-				(double)start->x, (double)start->y, (double)end->x, (double)end->y);
-			fflush(stderr);
-		}
-		_eq_call++;
-	}
+	SCENARIO_TRACE_FRONT(ScenarioTraceEvent::EQUIDISTANT, Fire()->TimeStep()->m_scenario, this, (double)dist_factor, (double)num);
 
 	XYPointType delta = (*end - *start);
 	delta /= steps;
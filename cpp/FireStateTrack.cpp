@@ -24,7 +24,7 @@
 #include "ScenarioTimeStep.h"
 #include "scenario.h"
 #include "raytrace.h"
-#include <omp.h>
+#include "ScenarioTrace.h"
 
 
 template<class _type>
@@ -227,44 +227,42 @@ void FireFront<_type>::trackPointGrid(const FirePoint<_type> *actual_fp, FirePoi
 }
 
 
-#define QUEUE_UP_GRID	64
-
 template<class _type>
-void FireFront<_type>::TrackFireGrid() {
+void FireFront<_type>::TrackFireGrid(bool multithread) {
 	stepVoxelStart<_type> svs;
 	svs.self = this;
 	svs.grid_per_meter = 1.0;
 	Fire()->TimeStep()->m_scenario->toInternal1D(svs.grid_per_meter);
 
-	if ((NumPoints() > QUEUE_UP_GRID) && (Fire()->TimeStep()->m_scenario->m_pool)) {
+	Scenario<_type> *scenario = Fire()->TimeStep()->m_scenario;
+	const std::uint32_t num_points = NumPoints();
+	const std::uint32_t chunk = scenario->m_gridTuner.Chunk();
+	const auto start = std::chrono::steady_clock::now();
+	bool parallel = false;
+
+	if ((multithread) && (scenario->m_pool) && (scenario->m_gridTuner.Parallel(num_points))) {
 		svs.use_lock = true;
 
 		std::vector<FirePoint<_type>*> &fp_array = Fire()->TimeStep()->m_scenario->m_omp_fp_array;
-		std::int32_t i = 0, num_pts = NumPoints();
-		if (fp_array.size() < num_pts)
-			fp_array.resize(num_pts);
+		std::uint32_t num_pts = 0;
+		if (fp_array.size() < num_points)
+			fp_array.resize(num_points);
 		FirePoint<_type> *fp1 = LH_Head();
 		while (fp1->LN_Succ()) {
 			if (fp1->m_status == FP_FLAG_NORMAL) {
-				fp_array[i++] = fp1;
+				fp_array[num_pts++] = fp1;
 			}
 			fp1 = fp1->LN_Succ();
 		}
-		num_pts = i;
-		int thread_id = (Fire()->TimeStep()->m_scenario->m_scenario->m_optionFlags & (1ull << (CWFGM_SCENARIO_OPTION_FORCE_AFFINITY))) ? -1 : -2;
-		#pragma omp parallel for num_threads(Fire()->TimeStep()->m_scenario->m_scenario->m_threadingNumProcessors) firstprivate(thread_id)
-		for (i = 0; i < num_pts; i++) {
-			if (thread_id == -1) {
-				thread_id = omp_get_thread_num();
-				CWorkerThread::native_handle_type thread = CWorkerThreadPool::GetCurrentThread();
-				CWorkerThreadPool::SetThreadAffinityToMask(thread, thread_id);
-			}
-			FirePoint<_type> *curr = fp_array[i];
+		parallel = scenario->ParallelFor(num_pts, chunk, [&](std::uint32_t begin, std::uint32_t end) {
+			for (std::uint32_t i = begin; i < end; i++) {
+				FirePoint<_type> *curr = fp_array[i];
 
-			if (curr->m_status == FP_FLAG_NORMAL) {
+				if (curr->m_status == FP_FLAG_NORMAL) {
 					trackPointGrid(curr->m_prevPoint, curr, &svs);
+				}
 			}
-		}
+		});
 
 	} else { 
 		svs.use_lock = false;
@@ -277,6 +275,8 @@ void FireFront<_type>::TrackFireGrid() {
 			curr = curr->LN_Succ();
 		}
 	}
+	if (multithread)						// else we're already on a worker, timing it would count a parallel run as serial
+		scenario->m_gridTuner.Record(num_points, parallel, scenario->m_scenario->m_threadingNumProcessors, start);
 }
 
 
@@ -294,53 +294,20 @@ void FireFront<_type>::trackPointPrevFire(const FirePoint<_type> *actual_fp, Fir
 	XYPolyRefType *node;								// catches up with the tail of another fire) AND then "eat" into the other fire's area that it had already burned in an unreasonable manner.
 	XYPolyNodeType *other_fp;
 
-	/* ── Vertex 506 trace: targeted at the divergent vertex ── */
-	bool _trace506 = false;
-	{
-		double _dx = (double)fp->x - 449.817;
-		double _dy = (double)fp->y - 399.323;
-		if (_dx*_dx + _dy*_dy < 1.0) _trace506 = true;  /* within 1 unit of vertex 506 */
-	}
-
 	sts = Fire()->LN_CalcPred()->TimeStep();
 	if (sts) {
 		sf = sts->m_fires.LH_Head();
-		int _sf_idx = 0;
 		while (sf->LN_Succ()) {
-			bool _fct = sf->FastCollisionTest(path, 0.0);
-			if (_trace506) {
-				fprintf(stderr, "[V506] sf=%d fct=%d from=(%.8f,%.8f) to=(%.8f,%.8f) sf_npts=%u\n",
-					_sf_idx, _fct?1:0,
-					(double)actual_fp->x, (double)actual_fp->y,
-					(double)fp->x, (double)fp->y,
-					sf->NumPoints());
-				fflush(stderr);
-			}
-			if (_fct) {
+			if (sf->FastCollisionTest(path, 0.0))
 				sf->IntersectionSet(path, list, 0, actual_fp);
-				if (_trace506) {
-					fprintf(stderr, "[V506] IntersectionSet returned %d hits\n", (int)list.GetCount());
-					if (list.GetCount()) {
-						auto* _n = list.LH_Head();
-						fprintf(stderr, "[V506] first intersection=(%.8f,%.8f)\n",
-							(double)_n->intersection_().x, (double)_n->intersection_().y);
-					}
-					fflush(stderr);
-				}
-			}
 			while (list.GetCount() > 1)
 				delete list.RemTail();
 			sf = sf->LN_Succ();
-			_sf_idx++;
 		}
+		SCENARIO_TRACE_VERTEX(ScenarioTraceEvent::TRACK_VECTOR, sts->m_scenario, fp, (double)fp->x, (double)fp->y, (double)list.GetCount());
 		if (list.GetCount()) {
 			node = list.RemHead();
 			other_fp = node->LN_Ptr();
-			if (_trace506) {
-				fprintf(stderr, "[V506] MOVED to intersection=(%.8f,%.8f)\n",
-					(double)node->intersection_().x, (double)node->intersection_().y);
-				fflush(stderr);
-			}
 			if (svs->use_lock)
 				svs->lock_self.Lock();
 
@@ -400,7 +367,7 @@ std::int32_t ScenarioTimeStep<_type>::pointInsideVectors(const XYPointType &pt)
 		if (v->box.PointInside(pt, RECT_POINTINSIDE_ALL_BORDERS)) {
 			auto p = v->LH_Head();
 			while (p->LN_Succ()) {
-				if (p->Participates(m_time)) {
+				if (m_scenario->StaticVectorBreakParticipates(p, m_time)) {
 					auto pn = m_staticVectorBreaksLL.FindPtr(p);
 					inside = p->PointInArea(pt);
 					if (inside) {
@@ -785,9 +752,6 @@ void FireFront<_type>::trackPointVector(const FirePoint<_type> *actual_fp, FireP
 }
 
 
-#define QUEUE_UP_VECTOR		64
-
-
 template<class _type>
 void FireFront<_type>::TrackFireVector() {
 	stepVoxelStart<_type> svs;
@@ -795,47 +759,42 @@ void FireFront<_type>::TrackFireVector() {
 	svs.grid_per_meter = 1.0;
 	Fire()->TimeStep()->m_scenario->toInternal1D(svs.grid_per_meter);
 
-	if ((NumPoints() > QUEUE_UP_VECTOR) && (Fire()->TimeStep()->m_scenario->m_pool)) {
+	Scenario<_type> *scenario = Fire()->TimeStep()->m_scenario;
+	const std::uint32_t num_points = NumPoints();
+	const std::uint32_t chunk = scenario->m_vectorTuner.Chunk();
+	const auto start = std::chrono::steady_clock::now();
+	bool parallel = false;
+
+	if ((scenario->m_pool) && (scenario->m_vectorTuner.Parallel(num_points))) {
 		svs.use_lock = true;
 
 		std::vector<FirePoint<_type>*> &fp_array = Fire()->TimeStep()->m_scenario->m_omp_fp_array;
-		std::int32_t i = 0, num_pts = NumPoints();
-		if (fp_array.size() < num_pts)
-			fp_array.resize(num_pts);
+		std::uint32_t num_pts = 0;
+		if (fp_array.size() < num_points)
+			fp_array.resize(num_points);
 		FirePoint<_type> *fp1 = LH_Head();
 		while (fp1->LN_Succ()) {
 			if (!fp1->Equals(*fp1->m_prevPoint))
-				fp_array[i++] = fp1;
+				fp_array[num_pts++] = fp1;
 			fp1 = fp1->LN_Succ();
 		}
-		num_pts = i;
-		int thread_id = (Fire()->TimeStep()->m_scenario->m_scenario->m_optionFlags & (1ull << (CWFGM_SCENARIO_OPTION_FORCE_AFFINITY))) ? -1 : -2;
-		#pragma omp parallel for num_threads(Fire()->TimeStep()->m_scenario->m_scenario->m_threadingNumProcessors) firstprivate(thread_id)
-		for (i = 0; i < num_pts; i++) {
-			if (thread_id == -1) {
-				thread_id = omp_get_thread_num();
-				CWorkerThread::native_handle_type thread = CWorkerThreadPool::GetCurrentThread();
-				CWorkerThreadPool::SetThreadAffinityToMask(thread, thread_id);
+		parallel = scenario->ParallelFor(num_pts, chunk, [&](std::uint32_t begin, std::uint32_t end) {
+			for (std::uint32_t i = begin; i < end; i++) {
+				FirePoint<_type> *curr = fp_array[i];
+				weak_assert(!curr->Equals(*curr->m_prevPoint));
+				trackPointPrevFire(curr->m_prevPoint, curr, &svs);
 			}
-			FirePoint<_type> *curr = fp_array[i];
-			weak_assert(!curr->Equals(*curr->m_prevPoint));
-			trackPointPrevFire(curr->m_prevPoint, curr, &svs);
-		}
+		});
 
-		thread_id = (Fire()->TimeStep()->m_scenario->m_scenario->m_optionFlags & (1ull << (CWFGM_SCENARIO_OPTION_FORCE_AFFINITY))) ? -1 : -2;
-		#pragma omp parallel for num_threads(Fire()->TimeStep()->m_scenario->m_scenario->m_threadingNumProcessors) firstprivate(thread_id)
-		for (i = 0; i < num_pts; i++) {
-			if (thread_id == -1) {
-				thread_id = omp_get_thread_num();
-				CWorkerThread::native_handle_type thread = CWorkerThreadPool::GetCurrentThread();
-				CWorkerThreadPool::SetThreadAffinityToMask(thread, thread_id);
-			}
-			FirePoint<_type> *curr = fp_array[i];
+		scenario->ParallelFor(num_pts, chunk, [&](std::uint32_t begin, std::uint32_t end) {
+			for (std::uint32_t i = begin; i < end; i++) {
+				FirePoint<_type> *curr = fp_array[i];
 
-			if (!curr->Equals(*curr->m_prevPoint)) {
-				trackPointVector(curr->m_prevPoint, curr, &svs);
+				if (!curr->Equals(*curr->m_prevPoint)) {
+					trackPointVector(curr->m_prevPoint, curr, &svs);
+				}
 			}
-		}
+		});
 
 	} else {
 		svs.use_lock = false;
@@ -853,6 +812,7 @@ void FireFront<_type>::TrackFireVector() {
 			curr = curr->LN_Succ();
 		}
 	}
+	scenario->m_vectorTuner.Record(num_points, parallel, scenario->m_scenario->m_threadingNumProcessors, start);
 }
 
 
@@ -24,10 +24,12 @@ template class ScenarioFire<fireengine_float_type>;
 template class IgnitionNode<fireengine_float_type>;
 template class ScenarioCache<fireengine_float_type>;
 template class XY_PolyLLSetBB<fireengine_float_type>;
+template class ScenarioLandscape<fireengine_float_type>;
 template class FireFrontStats<fireengine_float_type>;
 template class FireFrontExport<fireengine_float_type>;
 template struct growVoxelParms<fireengine_float_type>;
 template struct growPointStruct<fireengine_float_type>;
+template struct growTerrain<fireengine_float_type>;
 template class ScenarioTimeStep<fireengine_float_type>;
 template class ScenarioGridCache<fireengine_float_type>;
 template struct growVoxelIterator<fireengine_float_type>;
@@ -0,0 +1,207 @@
+/**
+ * WISE_Scenario_Growth_Module: NumaTopology.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "NumaTopology.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#ifdef _MSC_VER
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+namespace {
+
+thread_local std::uint32_t workerSlot = (std::uint32_t)-1;
+
+#ifndef _MSC_VER
+bool readLine(const std::string &path, std::string &line) {
+	FILE *f = fopen(path.c_str(), "r");
+	if (!f)
+		return false;
+	char buffer[4096];
+	bool ok = fgets(buffer, sizeof(buffer), f) != nullptr;
+	fclose(f);
+	if (ok)
+		line = buffer;
+	return ok;
+}
+
+std::vector<std::uint32_t> parseList(const std::string &list) {	// the kernel's "0-3,8-11" format
+	std::vector<std::uint32_t> ids;
+	const char *s = list.c_str();
+	while (*s) {
+		char *end;
+		unsigned long first = strtoul(s, &end, 10);
+		if (end == s)
+			break;
+		unsigned long last = first;
+		s = end;
+		if (*s == '-') {
+			last = strtoul(s + 1, &end, 10);
+			s = end;
+		}
+		for (unsigned long i = first; i <= last; i++)
+			ids.push_back((std::uint32_t)i);
+		while ((*s == ',') || (*s == '\n') || (*s == ' '))
+			s++;
+	}
+	return ids;
+}
+#endif
+
+}
+
+
+NumaTopology &NumaTopology::Instance() {
+	static NumaTopology topology;
+	return topology;
+}
+
+
+NumaTopology::NumaTopology() {
+	m_numNodes = 0;
+
+#ifndef _MSC_VER
+	cpu_set_t allowed;									// leave out anything the process (or its container) can't run on
+	CPU_ZERO(&allowed);
+	bool restricted = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+	std::string line;
+	std::vector<std::uint32_t> nodes;
+	if (readLine("/sys/devices/system/node/online", line))
+		nodes = parseList(line);
+	for (std::uint32_t node : nodes) {
+		if (!readLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", line))
+			continue;
+		bool any = false;
+		for (std::uint32_t id : parseList(line)) {
+			if ((restricted) && (id < CPU_SETSIZE) && (!CPU_ISSET(id, &allowed)))
+				continue;
+			cpuEntry c;
+			c.id = id;
+			c.node = m_numNodes;
+			c.sibling = false;
+			c.used = 0;
+			if (readLine("/sys/devices/system/cpu/cpu" + std::to_string(id) + "/topology/thread_siblings_list", line)) {
+				std::vector<std::uint32_t> siblings = parseList(line);
+				c.sibling = (!siblings.empty()) && (siblings.front() != id);
+			}
+			m_cpus.push_back(c);
+			any = true;
+		}
+		if (any)
+			m_numNodes++;
+	}
+#endif
+
+	if (m_cpus.empty()) {								// no NUMA information, so one node
+		std::uint32_t count = std::thread::hardware_concurrency();
+		for (std::uint32_t id = 0; id < count; id++)
+			m_cpus.push_back({ id, 0, false, 0 });
+		m_numNodes = 1;
+	}
+}
+
+
+NumaTopology::placement NumaTopology::Acquire(std::uint32_t threads) {
+	placement p;
+	std::lock_guard<std::mutex> guard(m_lock);
+	if (m_cpus.empty())
+		return p;
+
+	std::vector<std::uint32_t> used(m_numNodes, 0), count(m_numNodes, 0);
+	for (const cpuEntry &c : m_cpus) {
+		used[c.node] += c.used;
+		count[c.node]++;
+	}
+	std::uint32_t start = 0;							// the least busy node, relative to its size
+	for (std::uint32_t n = 1; n < m_numNodes; n++)
+		if ((std::uint64_t)used[n] * count[start] < (std::uint64_t)used[start] * count[n])
+			start = n;
+	auto distance = [&](const cpuEntry &c) { return (c.node + m_numNodes - start) % m_numNodes; };
+
+	std::vector<std::uint32_t> chosen;
+	for (std::uint32_t t = 0; t < threads; t++) {
+		std::uint32_t best = 0;
+		for (std::uint32_t i = 1; i < m_cpus.size(); i++) {
+			const cpuEntry &c = m_cpus[i], &b = m_cpus[best];
+			if (c.used != b.used) {
+				if (c.used < b.used)
+					best = i;
+			} else if (c.sibling != b.sibling) {
+				if (!c.sibling)
+					best = i;
+			} else if (distance(c) < distance(b))
+				best = i;
+		}
+		m_cpus[best].used++;
+		chosen.push_back(best);
+	}
+
+	std::stable_sort(chosen.begin(), chosen.end(), [&](std::uint32_t a, std::uint32_t b) { return distance(m_cpus[a]) < distance(m_cpus[b]); });
+	for (std::uint32_t i : chosen) {
+		p.cpu.push_back(m_cpus[i].id);
+		p.node.push_back(m_cpus[i].node);
+	}
+	return p;
+}
+
+
+void NumaTopology::Release(const placement &p) {
+	std::lock_guard<std::mutex> guard(m_lock);
+	for (std::uint32_t id : p.cpu)
+		for (cpuEntry &c : m_cpus)
+			if ((c.id == id) && (c.used)) {
+				c.used--;
+				break;
+			}
+}
+
+
+bool NumaTopology::Pin(std::uint32_t cpu) {
+#ifdef _MSC_VER
+	if (cpu >= 64)
+		return false;
+	return ::SetThreadAffinityMask(::GetCurrentThread(), 1ull << cpu) != 0;
+#else
+	if (cpu >= CPU_SETSIZE)
+		return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+}
+
+
+void NumaTopology::SetWorkerSlot(std::uint32_t slot) {
+	workerSlot = slot;
+}
+
+
+std::uint32_t NumaTopology::WorkerSlot() {
+	return workerSlot;
+}
@@ -0,0 +1,108 @@
+/**
+ * WISE_Scenario_Growth_Module: ScenarioSpill.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScenarioSpill.h"
+#include "google/protobuf/message_lite.h"
+
+#include <chrono>
+#include <string>
+#include <system_error>
+
+
+constexpr std::uint64_t SPILL_INITIAL_SIZE = 16 * 1024 * 1024;
+
+
+ScenarioSpillStore::ScenarioSpillStore() {
+	m_capacity = 0;
+	m_used = 0;
+
+	std::error_code ec;
+	std::filesystem::path dir = std::filesystem::temp_directory_path(ec);
+	if (ec)
+		dir = std::filesystem::current_path();
+	m_path = dir / ("wise_spill_" + std::to_string((std::uintptr_t)this) + "_" +
+		std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp");
+}
+
+
+ScenarioSpillStore::~ScenarioSpillStore() {
+	if (m_file.is_open())
+		m_file.close();
+	if (m_capacity) {
+		std::error_code ec;
+		std::filesystem::remove(m_path, ec);
+	}
+}
+
+
+bool ScenarioSpillStore::grow(std::uint64_t size) {
+	try {
+		boost::iostreams::mapped_file_params params(m_path.string());
+		params.flags = boost::iostreams::mapped_file::readwrite;
+		if (m_file.is_open()) {
+			m_file.close();
+			std::filesystem::resize_file(m_path, size);		// throws if the disk is full, the records we have are still in the file
+		} else
+			params.new_file_size = size;
+		m_file.open(params);
+	} catch (std::exception &) {
+		if (!m_file.is_open()) {							// try to get back what we had
+			try {
+				boost::iostreams::mapped_file_params params(m_path.string());
+				params.flags = boost::iostreams::mapped_file::readwrite;
+				if (m_capacity)
+					m_file.open(params);
+			} catch (std::exception &) {
+				m_records.clear();
+				m_used = 0;
+			}
+		}
+		return false;
+	}
+	m_capacity = size;
+	return true;
+}
+
+
+bool ScenarioSpillStore::Push(const google::protobuf::MessageLite &record) {
+	const std::uint64_t size = record.ByteSizeLong();
+	if ((!m_file.is_open()) || (m_used + size > m_capacity)) {
+		std::uint64_t capacity = m_capacity ? (m_capacity << 1) : SPILL_INITIAL_SIZE;
+		while (capacity < m_used + size)
+			capacity <<= 1;
+		if (!grow(capacity))
+			return false;
+	}
+	if (!record.SerializeToArray(m_file.data() + m_used, (int)size))
+		return false;
+	m_records.push_back(m_used);
+	m_used += size;
+	return true;
+}
+
+
+bool ScenarioSpillStore::Pop(google::protobuf::MessageLite &record) {
+	if (m_records.empty())
+		return false;
+	const std::uint64_t offset = m_records.back();
+	if (!record.ParseFromArray(m_file.const_data() + offset, (int)(m_used - offset)))
+		return false;									// left where it is, so the caller can keep its step spilled
+	m_records.pop_back();
+	m_used = offset;
+	return true;
+}
@@ -0,0 +1,54 @@
+/**
+ * WISE_Scenario_Growth_Module: ScenarioSpill.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SCENARIOSPILL_H
+#define __SCENARIOSPILL_H
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace google { namespace protobuf { class MessageLite; } }
+
+// Backing store for the perimeters of old time steps, when a scenario is asked to keep only its most recent steps in memory.
+// Steps are always spilled oldest first and paged back in newest first, so the records form a stack in one memory mapped file
+// that is grown as needed and never fragments.  The file is private to the scenario and is removed when the store is destroyed.
+
+class ScenarioSpillStore {
+public:
+	ScenarioSpillStore();
+	~ScenarioSpillStore();
+
+	bool Push(const google::protobuf::MessageLite &record);		// false if the file couldn't be grown, in which case nothing is written
+	bool Pop(google::protobuf::MessageLite &record);			// the most recently pushed record, which is only removed if it could be read
+
+	std::uint32_t Count() const								{ return (std::uint32_t)m_records.size(); };
+	std::uint64_t Size() const								{ return m_used; };		// bytes in use
+
+private:
+	bool grow(std::uint64_t size);
+
+	std::filesystem::path					m_path;
+	boost::iostreams::mapped_file			m_file;
+	std::uint64_t							m_capacity,
+											m_used;
+	std::vector<std::uint64_t>				m_records;		// offset of each record, the record runs to the next one (or m_used)
+};
+
+#endif
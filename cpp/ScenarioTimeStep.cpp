@@ -25,9 +25,12 @@
 #include "GridCom_ext.h"
 #include "FireEngine_ext.h"
 #include "CWFGM_Scenario_Internal.h"
-#include <omp.h>
+#include "ScenarioTrace.h"
 #include <algorithm>
 
+
+#define ADVANCE_ALONE	4096		// fires with more vertices than this are advanced one at a time, each on the whole pool
+
 #ifdef ROB_5CM
 #define EPSILON (0.05)
 #else
@@ -79,6 +82,9 @@ ScenarioTimeStep<_type>::ScenarioTimeStep(Scenario<_type> *scenario, const WTime
 	m_scenario = scenario;
 	m_evented = 0;
 	m_ignitioned = 0;
+	m_spilled = 0;
+	m_final = 0;
+	m_nearest = nullptr;
 	m_centroid.x = m_centroid.y = -99999999.0;
 
 	m_scenario->m_timeSteps.AddTail(this);
@@ -199,8 +205,30 @@ ScenarioTimeStep<_type>::ScenarioTimeStep(Scenario<_type> *scenario, const WTime
 }
 
 
+template<class _type>
+ScenarioTimeStep<_type>::ScenarioTimeStep(Scenario<_type> *scenario, const WTime &time) : m_time(time) {
+	m_displayable = 0;
+	m_vectorBreaksLL = nullptr;
+	m_scenario = scenario;
+	m_evented = 0;
+	m_ignitioned = 0;
+	m_spilled = 0;
+	m_final = 1;					// the caller restores the perimeters before anything can query them
+	m_nearest = nullptr;
+	m_centroid.x = m_centroid.y = -99999999.0;
+	m_tickCountStart = 0;
+	m_tickCountEnd = 0;
+	m_memoryBegin = m_memoryEnd = 0;
+	m_assetCount = 0;
+
+	m_scenario->m_timeSteps.AddTail(this);
+	PreCalculation();				// same grid events (and grid sizing) as the original step saw, but no locking since it isn't calculated
+}
+
+
 template<class _type>
 ScenarioTimeStep<_type>::~ScenarioTimeStep() {
+	ClearNearest();
 	if (m_vectorBreaksLL) {
 		std::uint32_t i, cnt = (std::uint32_t)m_vectorBreaksLL->size();
 		for (i = 0; i < cnt; i++)
@@ -299,6 +327,9 @@ void ScenarioTimeStep<_type>::PostCalculation() {
 	gridmax.x = parms.TargetGridMax.x;
 	gridmax.y = parms.TargetGridMax.y;
 	m_scenario->Size(gridmin, gridmax);
+
+	ClearNearest();
+	m_final = 1;
 }
 
 
@@ -527,6 +558,210 @@ std::int32_t ScenarioTimeStep<_type>::PointInArea(const XYPointType &pt) const {
 }
 
 
+template<class _type>
+class pointInAreaEdges {							// every edge of a time step's perimeters in flat arrays, one run per fire, so a batch of
+public:												// point in polygon tests can sweep the edges with SIMD instead of chasing the lists
+	using XYPointType = XY_PointTempl<_type>;
+
+	pointInAreaEdges(const MinListTempl<ScenarioFire<_type>> &fires) {
+		ScenarioFire<_type> *sf = fires.LH_Head();
+		while (sf->LN_Succ()) {
+			m_fires.push_back(sf);
+			m_start.push_back((std::uint32_t)m_x0.size());
+			FireFront<_type> *ff = sf->LH_Head();
+			while (ff->LN_Succ()) {
+				FirePoint<_type> *fp = ff->LH_Head(), *np;
+				if (fp->LN_Succ())
+					while (fp->LN_Succ()) {
+						np = fp->LN_Succ()->LN_Succ() ? fp->LN_Succ() : ff->LH_Head();
+						m_x0.push_back(fp->x);
+						m_y0.push_back(fp->y);
+						m_x1.push_back(np->x);
+						m_y1.push_back(np->y);
+						fp = fp->LN_Succ();
+					}
+				ff = ff->LN_Succ();
+			}
+			sf = sf->LN_Succ();
+		}
+		m_start.push_back((std::uint32_t)m_x0.size());
+	}
+
+	std::int32_t PointInArea(const XYPointType &pt, const _type eps) const {	// same encoding as ScenarioTimeStep::PointInArea()
+		std::int32_t val = 0, on_hull = 0, retval;
+		for (std::uint32_t f = 0; f < m_fires.size(); f++) {
+			ScenarioFire<_type> *sf = m_fires[f];
+			if (!sf->FastCollisionTest(pt, 0.0))
+				continue;
+
+			const _type *x0 = m_x0.data(), *y0 = m_y0.data(), *x1 = m_x1.data(), *y1 = m_y1.data();
+			const _type px = pt.x, py = pt.y;
+			std::int32_t winding = 0, near = 0;
+		#pragma omp simd reduction(+:winding) reduction(|:near)
+			for (std::uint32_t i = m_start[f]; i < m_start[f + 1]; i++) {
+				const _type dx = x1[i] - x0[i], dy = y1[i] - y0[i];
+				const _type left = dx * (py - y0[i]) - (px - x0[i]) * dy;		// > 0 when the point is left of the edge
+				const std::int32_t up = (y0[i] <= py) & (y1[i] > py);
+				const std::int32_t down = (y0[i] > py) & (y1[i] <= py);
+				winding += (up & (left > 0.0)) - (down & (left < 0.0));
+				near |= (fabs(left) <= eps * (fabs(dx) + fabs(dy))) &
+					(px >= std::min(x0[i], x1[i]) - eps) & (px <= std::max(x0[i], x1[i]) + eps) &
+					(py >= std::min(y0[i], y1[i]) - eps) & (py <= std::max(y0[i], y1[i]) + eps);
+			}
+
+			if (near)
+				retval = sf->PointInArea(pt, 0.0);		// on (or all but on) the hull, leave it to the exact test
+			else
+				retval = winding ? 2 : 0;
+			val += (retval & (~1));
+			on_hull |= (retval & 1);
+		}
+		return val + on_hull;
+	}
+
+private:
+	std::vector<ScenarioFire<_type>*> m_fires;
+	std::vector<std::uint32_t> m_start;				// first edge of each fire, and one past the last
+	std::vector<_type> m_x0, m_y0, m_x1, m_y1;
+};
+
+
+template<class _type>
+void ScenarioTimeStep<_type>::PointsInArea(const XYPointType *pts, std::uint32_t cnt, std::uint8_t *inside) const {
+	pointInAreaEdges<_type> edges(m_fires);
+	double eps = 1.0e-6;
+	m_scenario->gridToInternal1D(eps);
+
+	m_scenario->ParallelFor(cnt, (cnt >= 1024) ? 256 : cnt, [&](std::uint32_t begin, std::uint32_t end) {
+		for (std::uint32_t i = begin; i < end; i++) {
+			inside[i] = edges.PointInArea(pts[i], eps) ? 1 : 0;
+			weak_assert((inside[i] != 0) == (PointInArea(pts[i]) != 0));
+		}
+	});
+}
+
+
+template<class _type>
+class nearestPointTree {							// 2-D tree over every vertex of a time step whose perimeters are done, so a nearest point query
+public:												// doesn't have to visit every vertex
+	using XYPointType = XY_PointTempl<_type>;
+
+	nearestPointTree(const MinListTempl<ScenarioFire<_type>> &fires) {
+		std::uint32_t seq = 0;
+		const ScenarioFire<_type> *sf = fires.LH_Head();
+		while (sf->LN_Succ()) {
+			FireFront<_type> *ff = sf->LH_Head();
+			while (ff->LN_Succ()) {
+				FirePoint<_type> *fp = ff->LH_Head();
+				while (fp->LN_Succ()) {
+					m_nodes.push_back({ fp->x, fp->y, fp, ff, seq++ });
+					fp = fp->LN_Succ();
+				}
+				ff = ff->LN_Succ();
+			}
+			sf = sf->LN_Succ();
+		}
+		build(0, m_nodes.size(), 0);
+	}
+
+	FirePoint<_type> *Nearest(const XYPointType &pt, bool all_points, const std::vector<const FireFront<_type>*> *fronts, FireFront<_type> **firefront) const {
+		query q{ pt, all_points, fronts, nullptr, 0.0, 0 };
+		search(0, m_nodes.size(), 0, q);
+		if (firefront)
+			*firefront = q.best ? q.best->ff : nullptr;
+		return q.best ? q.best->fp : nullptr;
+	}
+
+private:
+	struct node {
+		_type x, y;
+		FirePoint<_type> *fp;
+		FireFront<_type> *ff;
+		std::uint32_t seq;							// fire / front / point order, so ties go the same way as walking the lists
+	};
+
+	struct query {
+		const XYPointType &pt;
+		bool all_points;
+		const std::vector<const FireFront<_type>*> *fronts;
+		const node *best;
+		_type d2;
+		std::uint32_t seq;
+	};
+
+	void build(size_t lo, size_t hi, std::uint32_t depth) {
+		if (hi - lo <= 1)
+			return;
+		size_t mid = (lo + hi) >> 1;
+		if (depth & 1)
+			std::nth_element(m_nodes.begin() + lo, m_nodes.begin() + mid, m_nodes.begin() + hi, [](const node &a, const node &b) { return a.y < b.y; });
+		else
+			std::nth_element(m_nodes.begin() + lo, m_nodes.begin() + mid, m_nodes.begin() + hi, [](const node &a, const node &b) { return a.x < b.x; });
+		build(lo, mid, depth + 1);
+		build(mid + 1, hi, depth + 1);
+	}
+
+	void search(size_t lo, size_t hi, std::uint32_t depth, query &q) const {
+		if (lo >= hi)
+			return;
+		size_t mid = (lo + hi) >> 1;
+		const node &n = m_nodes[mid];
+
+		bool participates = q.all_points ? (n.fp->m_status != FP_FLAG_FIRE) : (n.fp->m_status == FP_FLAG_NORMAL);	// same as FireFront::FindPoint_Participates()
+		if ((participates) && (q.fronts))
+			participates = (std::find(q.fronts->begin(), q.fronts->end(), n.ff) != q.fronts->end());
+		if (participates) {
+			_type dx = n.x - q.pt.x, dy = n.y - q.pt.y, d2 = dx * dx + dy * dy;
+			if ((!q.best) || (d2 < q.d2) || ((d2 == q.d2) && (n.seq < q.seq))) {
+				q.best = &n;
+				q.d2 = d2;
+				q.seq = n.seq;
+			}
+		}
+
+		_type diff = (depth & 1) ? (q.pt.y - n.y) : (q.pt.x - n.x);
+		if (diff < 0.0) {
+			search(lo, mid, depth + 1, q);
+			if ((!q.best) || (diff * diff <= q.d2))
+				search(mid + 1, hi, depth + 1, q);
+		} else {
+			search(mid + 1, hi, depth + 1, q);
+			if ((!q.best) || (diff * diff <= q.d2))
+				search(lo, mid, depth + 1, q);
+		}
+	}
+
+	std::vector<node> m_nodes;
+};
+
+
+template<class _type>
+nearestPointTree<_type> *ScenarioTimeStep<_type>::nearestTree() const {
+	nearestPointTree<_type> *tree = m_nearest.load(std::memory_order_acquire);
+	if (!tree) {
+		CThreadSemaphoreEngage engage(&m_nearestLock, SEM_TRUE);
+		tree = m_nearest.load(std::memory_order_relaxed);
+		if (!tree) {
+			try {
+				tree = new nearestPointTree<_type>(m_fires);
+			} catch (std::bad_alloc &) {
+				return nullptr;						// just walk the lists
+			}
+			m_nearest.store(tree, std::memory_order_release);
+		}
+	}
+	return tree;
+}
+
+
+template<class _type>
+void ScenarioTimeStep<_type>::ClearNearest() {
+	nearestPointTree<_type> *tree = m_nearest.exchange(nullptr);
+	if (tree)
+		delete tree;
+}
+
+
 template<class _type>
 FirePoint<_type> *ScenarioTimeStep<_type>::GetNearestPoint(const XYPointType &pt, bool all_points, FireFront<_type> **firefront, bool must_be_inside) const {
 	FirePoint<_type> *fp = NULL;
@@ -541,6 +776,27 @@ FirePoint<_type> *ScenarioTimeStep<_type>::GetNearestPoint(const XYPointType &pt
 		weak_assert(in);		// would have already passed this test
 #endif
 
+	nearestPointTree<_type> *tree;
+	if ((m_final) && (!m_spilled) && (tree = nearestTree())) {
+		std::vector<const FireFront<_type>*> inside;
+		if (must_be_inside) {
+			while (fs->LN_Succ()) {
+				if (fs->FastCollisionTest(pt, 0.0)) {
+					FireFront<_type> *ff = fs->LH_Head();
+					while (ff->LN_Succ()) {
+						if (ff->PointInArea(pt))
+							inside.push_back(ff);
+						ff = ff->LN_Succ();
+					}
+				}
+				fs = fs->LN_Succ();
+			}
+			if (inside.empty())
+				return nullptr;
+		}
+		return tree->Nearest(pt, all_points, must_be_inside ? &inside : nullptr, firefront);
+	}
+
 	while (fs->LN_Succ()) {
 		FireFront<_type> *ff = fs->LH_Head();
 		while (ff->LN_Succ()) {
@@ -573,11 +829,10 @@ FirePoint<_type> *ScenarioTimeStep<_type>::GetNearestPoint(const XYPointType &pt
 
 
 template<class _type>
-void ScenarioTimeStep<_type>::advanceFire(ActiveFire<_type> *af) {
+void ScenarioTimeStep<_type>::advanceFire(ActiveFire<_type> *af, std::vector<ScenarioFire<_type>*> &copies) {
 	ScenarioFire<_type> *sf = af->LN_Ptr();
 	ScenarioFire<_type> *sf_new = new ScenarioFire<_type>(this, sf->Ignition(), sf);
 	sf_new->m_activeFire = sf->m_activeFire;
-	bool ptr_updated = false;
 	if ((m_evented && (!m_ignitioned)) ||
 		(af->m_endTime == m_time) ||
 		((!m_displayable) && (!(m_scenario->m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_INDEPENDENT_TIMESTEPS))))) {
@@ -585,36 +840,42 @@ void ScenarioTimeStep<_type>::advanceFire(ActiveFire<_type> *af) {
 		sf_new->m_activeFire->LN_Ptr(sf_new);	// only update the pointer to the current image of this fire if we can actually calculate from it
 		sf_new->BoundingBox(sf_new->m_activeFire->m_boundingBox);
 		XYRectangleType bbox(sf->m_activeFire->m_boundingBox);
-		ptr_updated = true;
 	}
 
 #ifdef DEBUG
 	weak_assert(sf->NumPolys());
 #endif
 
-	int fronts_copied = 0;
-	FireFront<_type> *ff = sf->LH_Head();
-	while (ff->LN_Succ()) {						// this copies the fires from the previous state to this one, to advance them here
-		weak_assert(ff->Fire() == sf);
-		weak_assert(ff->Fire() != sf_new);
-		if (ff->NumPoints() >= 3) {
-			FireFront<_type> *new_ff = new FireFront<_type>(sf_new, *ff);
-			if (!(m_scenario->m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_FALSE_SCALING)))
-				new_ff->SetCacheScale(sf_new->GetCacheScale());
-			sf_new->AddPoly(new_ff);
-			fronts_copied++;
-		}
-		ff = ff->LN_Succ();
-	}
-	m_fires.AddTail(sf_new);
-	sf_new->InitArea(sf->Area());
+	m_fires.AddTail(sf_new);					// the order of m_fires is settled here, whatever order the copies finish in
+	copies.push_back(sf_new);
+}
 
-	if (m_displayable) {
-		fprintf(stderr, "[ADV-FIRE] disp=1 t=%lld sts=%p sf=%p sf_polys=%d copied=%d ptr_upd=%d fires_cnt=%d\n",
-			(long long)m_time.GetTotalSeconds(), (void*)this, (void*)sf, (int)sf->NumPolys(),
-			fronts_copied, (int)ptr_updated, (int)m_fires.GetCount());
-		fflush(stderr);
-	}
+
+template<class _type>
+void ScenarioTimeStep<_type>::copyFires(std::vector<ScenarioFire<_type>*> &copies) {
+	m_scenario->ParallelFor((std::uint32_t)copies.size(), 1, [&](std::uint32_t begin, std::uint32_t end) {	// each fire only reads its own image in the
+		for (std::uint32_t i = begin; i < end; i++) {																// previous step, so they're copied side by side
+			ScenarioFire<_type> *sf_new = copies[i], *sf = sf_new->LN_CalcPred();
+
+			FireFront<_type> *ff = sf->LH_Head();
+			while (ff->LN_Succ()) {						// this copies the fires from the previous state to this one, to advance them here
+				weak_assert(ff->Fire() == sf);
+				weak_assert(ff->Fire() != sf_new);
+				if (ff->NumPoints() >= 3) {
+					FireFront<_type> *new_ff = new FireFront<_type>(sf_new, *ff);
+					if (!(m_scenario->m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_FALSE_SCALING)))
+						new_ff->SetCacheScale(sf_new->GetCacheScale());
+					sf_new->AddPoly(new_ff);
+				}
+				ff = ff->LN_Succ();
+			}
+			sf_new->InitArea(sf->Area());
+
+			SCENARIO_TRACE_FRONT(ScenarioTraceEvent::ADVANCE_FIRE, m_scenario, sf_new, (double)m_time.GetTotalSeconds(), (double)sf->NumPolys(),
+				(double)sf_new->NumPolys(), (sf_new->m_activeFire->LN_Ptr() == sf_new) ? 1.0 : 0.0);
+		}
+	});
+	copies.clear();
 }
 
 
@@ -629,6 +890,7 @@ bool ScenarioTimeStep<_type>::AdvanceFires() {					// copies fires from the prev
 	std::string mtime = m_time.ToString(WTIME_FORMAT_AS_LOCAL | WTIME_FORMAT_WITHDST | WTIME_FORMAT_ABBREV | WTIME_FORMAT_DATE | WTIME_FORMAT_TIME);
 #endif
 
+	std::vector<ScenarioFire<_type>*> copies;
 	std::uint32_t af_cnt = 0;
 	ActiveFire<_type> *af = m_scenario->m_activeFires.LH_Head();
 	while (af->LN_Succ()) {
@@ -640,7 +902,7 @@ bool ScenarioTimeStep<_type>::AdvanceFires() {					// copies fires from the prev
 				(m_displayable && (m_scenario->m_scenario->m_displayInterval.GetTotalSeconds()))) {
 				// it can be displayable if all timesteps are, or if it's the end of a Simulation_Step() call,
 				// so don't necessarily add it if we want all timesteps
-				advanceFire(af);
+				advanceFire(af, copies);
 				af->m_advanced = 1;
 				af_cnt++;
 			}
@@ -660,7 +922,7 @@ bool ScenarioTimeStep<_type>::AdvanceFires() {					// copies fires from the prev
 				while (f != af) {
 					if (f->m_advanced) {
 						af->m_endTime = m_time;
-						advanceFire(af);
+						advanceFire(af, copies);
 						af->m_advanced = 1;
 						af_cnt++;
 						break;
@@ -672,6 +934,8 @@ bool ScenarioTimeStep<_type>::AdvanceFires() {					// copies fires from the prev
 			}
 		}
 
+	copyFires(copies);
+
 	if ((m_scenario->m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_INDEPENDENT_TIMESTEPS)) && (af_cnt != m_scenario->m_activeFires.GetCount())) {
 		_type area = 0.0;
 		ScenarioFire<_type> *sf = pred->m_fires.LH_Head();
@@ -705,7 +969,8 @@ bool ScenarioTimeStep<_type>::AdvanceFires() {					// copies fires from the prev
 											while (fp->LN_Succ()) {
 												if (ff1->WithinDistance(*fp, st * 2.0, false)) {
 													af->m_endTime = m_time;
-													advanceFire(af);
+													advanceFire(af, copies);
+													copyFires(copies);		// the next pass tests against its fronts
 													weak_assert(!af->Attached(f));
 													af->Attach(f);
 													af->m_advanced = 1;
@@ -729,7 +994,8 @@ bool ScenarioTimeStep<_type>::AdvanceFires() {					// copies fires from the prev
 	    }
 	}
 
-	bool advanced = false;
+	std::vector<std::pair<ScenarioFire<_type>*, _type>> fires;
+	fires.reserve(m_fires.GetCount());
 	ScenarioFire<_type> *sf = m_fires.LH_Head();
 	while (sf->LN_Succ()) {
 		WTimeSpan elapsed;
@@ -749,20 +1015,39 @@ bool ScenarioTimeStep<_type>::AdvanceFires() {					// copies fires from the prev
 		// adjust that to "cell-size" (1/resolution)/sec to go from ROS to our
 		// ellipse A, B, C
 		sf->m_gusting = m_scenario->m_scenario->m_impl->m_go.AssignPercentGusting(sf, m_time);
-		advanced |= sf->AdvanceFire(scale);
+		fires.emplace_back(sf, scale);
 		sf = sf->LN_Succ();
 	}
 
+	bool advanced = false;
+	std::vector<std::uint8_t> fire_advanced(fires.size(), 0);
+	std::uint32_t num_fires = 0;
+	for (std::uint32_t i = 0; i < fires.size(); i++)			// large fires are still advanced one at a time, with their vertices spread over the pool
+		if (fires[i].first->NumPoints() > ADVANCE_ALONE)
+			advanced |= fires[i].first->AdvanceFire(fires[i].second, true);
+		else
+			fires[num_fires++] = fires[i];
+
+	if (num_fires) {
+		m_scenario->ParallelFor(num_fires, 1, [&](std::uint32_t begin, std::uint32_t end) {
+			for (std::uint32_t i = begin; i < end; i++)
+				if (fires[i].first->AdvanceFire(fires[i].second, false))
+					fire_advanced[i] = 1;
+		});
+		for (std::uint32_t i = 0; i < num_fires; i++)
+			advanced |= fire_advanced[i] ? true : false;
+	}
+
 	return advanced;
 }
 
 
 template<class _type>
-bool ScenarioFire<_type>::AdvanceFire(const _type scale) {
+bool ScenarioFire<_type>::AdvanceFire(const _type scale, bool alone) {
 	bool advanced = false;
 	FireFront<_type> *ff = LH_Head();
 	while (ff->LN_Succ()) {
-		advanced |= ff->AdvanceFire(scale);
+		advanced |= ff->AdvanceFire(scale, alone);
 		ff = ff->LN_Succ();
 	}
 	return advanced;
@@ -770,18 +1055,45 @@ bool ScenarioFire<_type>::AdvanceFire(const _type scale) {
 
 
 template<class _type>
-void ScenarioTimeStep<_type>::SimplifyFires() {
+void ScenarioTimeStep<_type>::SimplifyFires(bool simplify) {
+	std::vector<FireFront<_type>*> &fronts = m_scenario->m_omp_ff_array;
+	std::vector<FireFront<_type>*> &tracked = m_scenario->m_omp_tracked_array;
+	const std::uint32_t threshold = m_scenario->m_gridTuner.Threshold();
+	std::uint32_t num_fronts = 0;
 	ScenarioFire<_type> *sf;
-
-	sf = m_fires.LH_Head();
-	while (sf->LN_Succ()) {
-		FireFront<_type> *ff = sf->LH_Head();
-		while (ff->LN_Succ()) {
-			ff->Simplify();
-			ff = ff->LN_Succ();
+	FireFront<_type> *ff;
+
+	tracked.clear();
+	for (sf = m_fires.LH_Head(); sf->LN_Succ(); sf = sf->LN_Succ())
+		num_fronts += sf->NumPolys();
+	if (fronts.size() < num_fronts)
+		fronts.resize(num_fronts);
+
+	std::uint32_t num_large = 0;								// fronts that would grid track on the whole pool are only simplified here, and
+	for (sf = m_fires.LH_Head(); sf->LN_Succ(); sf = sf->LN_Succ())	// go first as they take the longest - the rest are simplified then tracked by
+		for (ff = sf->LH_Head(); ff->LN_Succ(); ff = ff->LN_Succ())	// the same worker without waiting on any other front
+			if (ff->NumPoints() > threshold)
+				fronts[num_large++] = ff;
+	std::uint32_t i = num_large;
+	for (sf = m_fires.LH_Head(); sf->LN_Succ(); sf = sf->LN_Succ())
+		for (ff = sf->LH_Head(); ff->LN_Succ(); ff = ff->LN_Succ())
+			if (ff->NumPoints() <= threshold)
+				fronts[i++] = ff;
+
+	if ((!simplify) && (num_fronts - num_large < 2))
+		return;													// nothing to run side by side, so TrackFires() does the lot
+
+	m_scenario->ParallelFor(num_fronts, 1, [&](std::uint32_t begin, std::uint32_t end) {
+		for (std::uint32_t j = begin; j < end; j++) {
+			if (simplify)
+				fronts[j]->Simplify();
+			if (j >= num_large)
+				fronts[j]->TrackFireGrid(false);
 		}
-		sf = sf->LN_Succ();
-	}
+	});
+
+	tracked.assign(fronts.begin() + num_large, fronts.begin() + num_fronts);
+	std::sort(tracked.begin(), tracked.end());
 }
 
 
@@ -912,9 +1224,9 @@ void ScenarioTimeStep<_type>::reviewStaticBreaks() {				// record the first time
 			if (sf->FastCollisionTest(vb->box, 0.0)) {
 				XY_PolyLLTimed<_type>* p = vb->LH_Head();
 				while (p->LN_Succ()) {
-					if (!p->m_usedTime.GetTime(0)) {
+					if (!m_scenario->StaticVectorBreakUsed(p).GetTime(0)) {
 						if (sf->FastCollisionTest(*p, 0.0)) {
-							p->m_usedTime = m_time;
+							m_scenario->StaticVectorBreakUsed(p, m_time);
 
 							XY_PolyLLPolyRef<_type>* r = new XY_PolyLLPolyRef<_type>();
 							r->LN_Ptr(p);
@@ -942,15 +1254,18 @@ void ScenarioTimeStep<_type>::TrackFires() {						// ray traces looking for barr
 	buildVectorBreaks();
 	reviewStaticBreaks();
 
+	const std::vector<FireFront<_type>*> &tracked = m_scenario->m_omp_tracked_array;
 	ff = m_fires.LH_Head();
 	while (ff->LN_Succ()) {
 		FireFront<_type> *ff1 = ff->LH_Head();
 		while (ff1->LN_Succ()) {
-			ff1->TrackFireGrid();
+			if (!std::binary_search(tracked.begin(), tracked.end(), ff1))
+				ff1->TrackFireGrid();
 			ff1 = ff1->LN_Succ();
 		}
 		ff = ff->LN_Succ();
 	}
+	m_scenario->m_omp_tracked_array.clear();
 
 	ff = m_fires.LH_Head();
 	while (ff->LN_Succ()) {
@@ -1094,63 +1409,222 @@ void ScenarioTimeStep<_type>::UnOverlapFiresNull() {
 }
 
 
+template<class _type>
+class unOverlapIndex {								// bounding boxes bucketed on a coarse grid, to find the fires or breaks that could hold a point or
+public:												// touch a box without testing every one of them
+	using XYPointType = XY_PointTempl<_type>;
+	using XYRectangleType = XY_RectangleTempl<_type>;
+
+	std::vector<XYRectangleType> m_boxes;			// caller fills these in, an empty box (min > max) is never found
+
+	void Build() {
+		std::uint32_t i, cnt = (std::uint32_t)m_boxes.size();
+		bool one = false;
+		for (i = 0; i < cnt; i++)
+			if (m_boxes[i].m_min.x <= m_boxes[i].m_max.x) {
+				if (!one) {
+					m_bounds = m_boxes[i];
+					one = true;
+				} else
+					m_bounds.EncompassRectangle(m_boxes[i]);
+			}
+		m_dim = 0;
+		if (!one)
+			return;
+		m_dim = (std::uint32_t)ceil(sqrt((double)cnt));
+		if (m_dim > 64)
+			m_dim = 64;
+		m_cellX = (m_bounds.m_max.x - m_bounds.m_min.x) / (_type)m_dim;
+		m_cellY = (m_bounds.m_max.y - m_bounds.m_min.y) / (_type)m_dim;
+		if (m_cellX <= 0.0)	m_cellX = 1.0;
+		if (m_cellY <= 0.0)	m_cellY = 1.0;
+
+		m_start.assign(m_dim * m_dim + 1, 0);		// counting sort into cells, compressed rows
+		for (std::uint32_t pass = 0; pass < 2; pass++) {
+			if (pass) {
+				for (i = 1; i <= m_dim * m_dim; i++)
+					m_start[i] += m_start[i - 1];
+				m_items.resize(m_start[m_dim * m_dim]);
+			}
+			for (i = 0; i < cnt; i++) {
+				std::uint32_t x0, y0, x1, y1;
+				if (!cells(m_boxes[i], x0, y0, x1, y1))
+					continue;
+				for (std::uint32_t y = y0; y <= y1; y++)
+					for (std::uint32_t x = x0; x <= x1; x++) {
+						if (pass)
+							m_items[--m_start[y * m_dim + x + 1]] = i;
+						else
+							m_start[y * m_dim + x + 1]++;
+					}
+			}
+		}
+	}
+
+	template<class F>
+	void Query(const XYPointType &pt, F f) const {	// every box holding pt, once each, in index order
+		if ((!m_dim) || (!m_bounds.PointInside(pt)))
+			return;
+		std::uint32_t x = cell(pt.x, m_bounds.m_min.x, m_cellX), y = cell(pt.y, m_bounds.m_min.y, m_cellY);
+		for (std::uint32_t i = m_start[y * m_dim + x]; i < m_start[y * m_dim + x + 1]; i++)
+			if (m_boxes[m_items[i]].PointInside(pt))
+				f(m_items[i]);
+	}
+
+	void Query(const XYRectangleType &box, std::vector<std::uint32_t> &found) const {	// every box touching box, sorted
+		found.clear();
+		std::uint32_t x0, y0, x1, y1;
+		if (!cells(box, x0, y0, x1, y1))
+			return;
+		for (std::uint32_t y = y0; y <= y1; y++)
+			for (std::uint32_t x = x0; x <= x1; x++)
+				for (std::uint32_t i = m_start[y * m_dim + x]; i < m_start[y * m_dim + x + 1]; i++) {
+					const XYRectangleType &b = m_boxes[m_items[i]];
+					if ((b.m_min.x <= box.m_max.x) && (b.m_max.x >= box.m_min.x) && (b.m_min.y <= box.m_max.y) && (b.m_max.y >= box.m_min.y))
+						found.push_back(m_items[i]);
+				}
+		std::sort(found.begin(), found.end());
+		found.erase(std::unique(found.begin(), found.end()), found.end());
+	}
+
+private:
+	std::uint32_t cell(_type v, _type min, _type size) const {
+		std::int64_t c = (std::int64_t)((v - min) / size);
+		if (c < 0)					return 0;
+		if (c >= (std::int64_t)m_dim)	return m_dim - 1;
+		return (std::uint32_t)c;
+	}
+
+	bool cells(const XYRectangleType &box, std::uint32_t &x0, std::uint32_t &y0, std::uint32_t &x1, std::uint32_t &y1) const {
+		if ((!m_dim) || (box.m_min.x > box.m_max.x))
+			return false;
+		if ((box.m_max.x < m_bounds.m_min.x) || (box.m_min.x > m_bounds.m_max.x) || (box.m_max.y < m_bounds.m_min.y) || (box.m_min.y > m_bounds.m_max.y))
+			return false;
+		x0 = cell(box.m_min.x, m_bounds.m_min.x, m_cellX);
+		x1 = cell(box.m_max.x, m_bounds.m_min.x, m_cellX);
+		y0 = cell(box.m_min.y, m_bounds.m_min.y, m_cellY);
+		y1 = cell(box.m_max.y, m_bounds.m_min.y, m_cellY);
+		return true;
+	}
+
+	XYRectangleType m_bounds;
+	std::uint32_t m_dim = 0;
+	_type m_cellX, m_cellY;
+	std::vector<std::uint32_t> m_start, m_items;
+};
+
+
+#define QUEUE_UP_UNOVERLAP	128
+
 template<class _type>
 void ScenarioTimeStep<_type>::UnOverlapFires() {					// ***** this still has to be done - this is essentially performing polygon subtraction - when we do this, we
 										// also have to test for fires completely within another, and we can remove that part of the code in
 										// trackPoints()
 										// ***** really, this method should be subtracting one fire front from another (or vector break), but for now,
 										// this should do a reasonable approximation mock-up
+	std::vector<ScenarioFire<_type>*> fires;
+	unOverlapIndex<_type> fireIndex, breakIndex;
 	ScenarioFire<_type> *sf = m_fires.LH_Head();
-	std::uint32_t i, i_cnt;
 	while (sf->LN_Succ()) {
-		FireFront<_type> *ff = sf->LH_Head();
+		XYRectangleType b;
+		if ((!sf->NumPolys()) || (!sf->BoundingBox(b))) {
+			b.m_min.x = b.m_min.y = DBL_MAX;
+			b.m_max.x = b.m_max.y = -DBL_MAX;
+		}
+		fires.push_back(sf);
+		fireIndex.m_boxes.push_back(b);
+		sf = sf->LN_Succ();
+	}
+	fireIndex.Build();
+
+	std::vector<const XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>*> staticBreaks;
+	auto p = m_staticVectorBreaksLL.LH_Head();
+	while (p->LN_Succ()) {
+		XYRectangleType b;
+		if (!p->LN_Ptr()->BoundingBox(b)) {
+			b.m_min.x = b.m_min.y = DBL_MAX;
+			b.m_max.x = b.m_max.y = -DBL_MAX;
+		}
+		staticBreaks.push_back(p->LN_Ptr());
+		breakIndex.m_boxes.push_back(b);
+		p = p->LN_Succ();
+	}
+	const std::uint32_t numStatic = (std::uint32_t)staticBreaks.size(),
+		numDynamic = m_vectorBreaksLL ? (std::uint32_t)m_vectorBreaksLL->size() : 0;
+	std::uint32_t i, i_cnt;
+	for (i = 0; i < numDynamic; i++)
+		breakIndex.m_boxes.push_back((*m_vectorBreaksLL)[i]->box);
+	breakIndex.Build();
+
+	std::vector<FirePoint<_type>*> &fp_array = m_scenario->m_omp_fp_array;	// every active vertex, and which fire it belongs to
+	std::vector<std::uint32_t> owner;
+	std::int32_t num_pts = 0;
+	for (i = 0; i < (std::uint32_t)fires.size(); i++)
+		num_pts += fires[i]->NumPoints();
+	if ((std::int32_t)fp_array.size() < num_pts)
+		fp_array.resize(num_pts);
+	owner.resize(num_pts);
+	num_pts = 0;
+	for (i = 0; i < (std::uint32_t)fires.size(); i++) {
+		FireFront<_type> *ff = fires[i]->LH_Head();
 		while (ff->LN_Succ()) {
 			FirePoint<_type> *fp = ff->LH_Head();
 			while (fp->LN_Succ()) {
 				if (!fp->m_status) {
-					auto p = m_staticVectorBreaksLL.LH_Head();
-					while (p->LN_Succ()) {
-						const XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>* v = p->LN_Ptr();
-						if (v->PointInArea(*fp, 0.0)) {
-							fp->m_status = FP_FLAG_VECTOR;
-							break;
-						}
-						p = p->LN_Succ();
-					}
-					if (!fp->m_status) {
-						if (m_vectorBreaksLL)
-							i_cnt = (std::uint32_t)m_vectorBreaksLL->size();
-						else
-							i_cnt = 0;
-						for (i = 0; i < i_cnt; i++) {
-							if ((*m_vectorBreaksLL)[i]->box.PointInside(*fp))
-								if ((*m_vectorBreaksLL)[i]->PointInArea(*fp, 0.0))
-									fp->m_status = FP_FLAG_VECTOR;
-						}
-					}
-				}
-				if (!fp->m_status) {
-					ScenarioFire<_type> *test = m_fires.LH_Head();
-					while (test->LN_Succ()) {
-						if (test != sf) {
-							if (test->PointInArea(*fp, 0.0))
-								fp->m_status = FP_FLAG_FIRE;
-						}
-						test = test->LN_Succ();
-					}
+					fp_array[num_pts] = fp;
+					owner[num_pts++] = i;
 				}
 				fp = fp->LN_Succ();
 			}
 			ff = ff->LN_Succ();
 		}
-		sf = sf->LN_Succ();
 	}
 
-	sf = m_fires.LH_Head();
-	while (sf->LN_Succ()) {
+	m_scenario->ParallelFor(num_pts, (num_pts > QUEUE_UP_UNOVERLAP) ? 64 : num_pts, [&](std::uint32_t begin, std::uint32_t end) {
+		for (std::uint32_t j = begin; j < end; j++) {	// each thread only sets the status of its own vertices, and nothing it tests against changes
+			FirePoint<_type> *fp = fp_array[j];
+			breakIndex.Query(*fp, [&](std::uint32_t b) {
+				if (fp->m_status)
+					return;
+				if (b < numStatic) {
+					if (staticBreaks[b]->PointInArea(*fp, 0.0))
+						fp->m_status = FP_FLAG_VECTOR;
+				} else if ((*m_vectorBreaksLL)[b - numStatic]->PointInArea(*fp, 0.0))
+					fp->m_status = FP_FLAG_VECTOR;
+			});
+			if (!fp->m_status)
+				fireIndex.Query(*fp, [&](std::uint32_t f) {
+					if ((!fp->m_status) && (f != owner[j]) && (fires[f]->PointInArea(*fp, 0.0)))
+						fp->m_status = FP_FLAG_FIRE;
+				});
+		}
+	});
+
+										// clipping a fire changes it, and also cleans up the fires it's clipped against, so a fire's clipping is
+										// put in a later wave than every earlier fire (in list order) that it, or one of its neighbours, touches
+	const std::uint32_t num_fires = (std::uint32_t)fires.size();
+	std::vector<std::vector<std::uint32_t>> neighbours(num_fires), waves;
+	std::vector<std::int32_t> lastWave(num_fires, -1);
+	for (i = 0; i < num_fires; i++) {
+		fireIndex.Query(fireIndex.m_boxes[i], neighbours[i]);
+		std::int32_t wave = lastWave[i];
+		for (auto f : neighbours[i])
+			if (lastWave[f] > wave)
+				wave = lastWave[f];
+		wave++;
+		lastWave[i] = wave;
+		for (auto f : neighbours[i])
+			lastWave[f] = wave;
+		if (waves.size() <= (size_t)wave)
+			waves.resize(wave + 1);
+		waves[wave].push_back(i);
+	}
+
+	auto clip = [&](std::uint32_t k, bool multithread) {
+		ScenarioFire<_type> *sf = fires[k];
 		sf->m_newVertexStatus = FP_FLAG_FIRE;
-		ScenarioFire<_type> *sf2 = m_fires.LH_Head();
-		while (sf2->LN_Succ()) {
+		for (auto f : neighbours[k]) {			// in list order, same as testing them all
+			ScenarioFire<_type> *sf2 = fires[f];
 			if ((sf2 != sf) && (sf2->m_fireArea >= sf->m_fireArea))
 				if (sf->FastCollisionTest(*sf2, 0.0)) {
 					FireFront<_type> *ff = sf2->LH_Head();
@@ -1164,42 +1638,52 @@ void ScenarioTimeStep<_type>::UnOverlapFires() {					// ***** this still has to
 						ff = ff->LN_Succ();
 					}
 
-					sf->ClipAgainst(*sf2, PolysetOperation::DIFF, m_scenario->m_multithread, &m_setMetrics, nullptr);
+					sf->ClipAgainst(*sf2, PolysetOperation::DIFF, multithread, &m_setMetrics, nullptr);
 				}
-			sf2 = sf2->LN_Succ();
 		}
 		sf->m_newVertexStatus = FP_FLAG_VECTOR;
 
-		if (m_vectorBreaksLL)
-			i_cnt = (std::uint32_t)m_vectorBreaksLL->size();
-		else	i_cnt = 0;
-		for (i = 0; i < i_cnt; i++)
+		for (std::uint32_t i = 0; i < numDynamic; i++)
 			if (sf->FastCollisionTest(*((*m_vectorBreaksLL)[i]), 0.0)) {
-				sf->ClipAgainst(*((*m_vectorBreaksLL)[i]), PolysetOperation::DIFF, m_scenario->m_multithread, &m_setMetrics, nullptr);
+				sf->ClipAgainst(*((*m_vectorBreaksLL)[i]), PolysetOperation::DIFF, multithread, &m_setMetrics, nullptr);
 			}
 
-		i_cnt = m_scenario->StaticVectorBreakCount();
-		for (i = 0; i < i_cnt; i++) {
+		XY_PolyLLTimedParticipation participation{ &m_time, m_scenario->StaticVectorBreakUsedTimes() };
+		std::uint32_t i_cnt = m_scenario->StaticVectorBreakCount();
+		for (std::uint32_t i = 0; i < i_cnt; i++) {
 			XY_PolyLLSetBB<_type> *it = (XY_PolyLLSetBB<_type>*)m_scenario->StaticVectorBreak(i);
 			if (sf->FastCollisionTest(*it, 0.0)) {
 				bool relevant = false;
 				auto p = it->LH_Head();
 				while (p->LN_Succ()) {
-					if (p->Participates(m_time)) {
+					if (m_scenario->StaticVectorBreakParticipates(p, m_time)) {
 						relevant = true;
 						break;
 					}
 					p = p->LN_Succ();
 				}
 				if (relevant)
-					sf->ClipAgainst(*it, PolysetOperation::DIFF, m_scenario->m_multithread, &m_setMetrics, &m_time);
+					sf->ClipAgainst(*it, PolysetOperation::DIFF, multithread, &m_setMetrics, &participation);
 			}
 		}
 
 		sf->m_fireArea = sf->Area();
 
 		sf->m_newVertexStatus = FP_FLAG_NORMAL;
-		sf = sf->LN_Succ();
+	};
+
+	for (auto &wave : waves) {
+		i_cnt = (std::uint32_t)wave.size();
+		if ((i_cnt > 1) && (m_scenario->m_pool)) {		// fires in a wave don't share anything, so they're clipped side by side - the metrics
+														// are already shared by the polyset code's own threads
+			m_scenario->ParallelFor(i_cnt, 1, [&](std::uint32_t begin, std::uint32_t end) {
+				for (std::uint32_t j = begin; j < end; j++)
+					clip(wave[j], false);
+			});
+		} else {
+			for (i = 0; i < i_cnt; i++)
+				clip(wave[i], m_scenario->m_multithread);
+		}
 	}
 }
 
@@ -1520,9 +2004,9 @@ void ScenarioTimeStep<_type>::addPoint(const XYPointType &loc, bool &valid, XYPo
 				{
 					auto p = v->LH_Head();
 					while (p->LN_Succ()) {
-						if ((p->m_usedTime.GetTime(0)) || (p->FastCollisionTest(loc, 0.0))) {
-							if (!p->m_usedTime.GetTime(0)) {				// if we happen to come across a vector break that could include the new ignition point, then flag it as
-								p->m_usedTime = m_time;						// something we find interesting
+						if ((m_scenario->StaticVectorBreakUsed(p).GetTime(0)) || (p->FastCollisionTest(loc, 0.0))) {
+							if (!m_scenario->StaticVectorBreakUsed(p).GetTime(0)) {	// if we happen to come across a vector break that could include the new ignition point, then flag it as
+								m_scenario->StaticVectorBreakUsed(p, m_time);		// something we find interesting
 
 								XY_PolyLLPolyRef<_type>* r = new XY_PolyLLPolyRef<_type>();
 								r->LN_Ptr(p);
@@ -1664,36 +2148,34 @@ void ScenarioTimeStep<_type>::AddFirePoints() {
 	_type epsilon = EPSILON;		// epsilon is 5cm
 	m_scenario->gridToInternal1D(epsilon);
 
-	if ((m_scenario->m_multithread) && (m_fires.GetCount() > 1)) {
+	std::uint32_t num_fronts = 0;
+	for (ScenarioFire<_type> *sf = m_fires.LH_Head(); sf->LN_Succ(); sf = sf->LN_Succ())
+		num_fronts += sf->NumPolys();
+
+	if ((m_scenario->m_multithread) && (num_fronts > 1)) {
+		std::vector<FireFront<_type>*> &fp_array = m_scenario->m_omp_ff_array;	// every front of every fire in one job, so fronts don't wait on the
+		std::uint32_t i = 0;												// largest front of their own fire before the next fire starts
+		if (fp_array.size() < num_fronts)
+			fp_array.resize(num_fronts);
 		ScenarioFire<_type> *sf = m_fires.LH_Head();
 		while (sf->LN_Succ()) {
-			std::vector<FireFront<_type>*> &fp_array = m_scenario->m_omp_ff_array;
-			std::int32_t i = 0, num_pts = sf->NumPolys();
-			if (fp_array.size() < num_pts)
-				fp_array.resize(num_pts);
+			if (m_scenario->m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_SPATIAL_THRESHOLD_DYNAMIC))
+				sf->InitArea(sf->Area());
 			FireFront<_type> *fp1 = sf->LH_Head();
 			while (fp1->LN_Succ()) {
 				fp_array[i++] = fp1;
 				fp1 = fp1->LN_Succ();
 			}
-			if (m_scenario->m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_SPATIAL_THRESHOLD_DYNAMIC))
-				sf->InitArea(sf->Area());
+			sf = sf->LN_Succ();
+		}
 
-			int thread_id = (m_scenario->m_scenario->m_optionFlags & (1ull << (CWFGM_SCENARIO_OPTION_FORCE_AFFINITY))) ? -1 : -2;
-			#pragma omp parallel for num_threads(m_scenario->m_scenario->m_threadingNumProcessors) firstprivate(thread_id)
-			for (i = 0; i < num_pts; i++) {
-				if (thread_id == -1) {
-					thread_id = omp_get_thread_num();
-					CWorkerThread::native_handle_type thread = CWorkerThreadPool::GetCurrentThread();
-					CWorkerThreadPool::SetThreadAffinityToMask(thread, thread_id);
-				}
-				FireFront<_type> *fs = fp_array[i];
+		m_scenario->ParallelFor(num_fronts, 1, [&](std::uint32_t begin, std::uint32_t end) {	// fronts vary a lot in size, so one at a time
+			for (std::uint32_t j = begin; j < end; j++) {
+				FireFront<_type> *fs = fp_array[j];
 				fs->CleanPoly(epsilon, FireFront<_type>::Flags::INTERPRET_POLYGON);
-				fs->AddPoints();			
+				fs->AddPoints();
 			}
-
-			sf = sf->LN_Succ();
-		}
+		});
 
 		sf = m_fires.LH_Head();
 		while (sf->LN_Succ()) {
@@ -1757,6 +2239,24 @@ std::uint32_t ScenarioTimeStep<_type>::NumActivePoints() const {
 }
 
 
+template<class _type>
+void ScenarioTimeStep<_type>::PhaseCounts(std::uint64_t &points, std::uint64_t &fronts, std::uint64_t &clips) const {
+	points = 0;
+	fronts = 0;
+	ScenarioFire<_type> *sf = m_fires.LH_Head();
+	while (sf->LN_Succ()) {
+		FireFront<_type> *ff = sf->LH_Head();
+		while (ff->LN_Succ()) {
+			points += ff->NumPoints();
+			fronts++;
+			ff = ff->LN_Succ();
+		}
+		sf = sf->LN_Succ();
+	}
+	clips = (std::uint64_t)m_advanceMetrics.numInvocations + (std::uint64_t)m_setMetrics.numInvocations;
+}
+
+
 template<class _type>
 HRESULT ScenarioFire<_type>::RetrieveStat(const std::uint16_t stat, double *stats) const {
 	double s = 0.0;
@@ -2128,21 +2628,15 @@ HRESULT ScenarioTimeStep<_type>::RetrieveStat(const std::uint16_t stat, ICWFGM_F
 		count = 1;
 
 	boost::multi_array<typename Scenario<_type>::closest_calc, 2> pt_array(boost::extents[discretize][discretize]);
-	if (count != 1) {
-		int thread_id = (m_scenario->m_scenario->m_optionFlags & (1ull << (CWFGM_SCENARIO_OPTION_FORCE_AFFINITY))) ? -1 : -2;
-		std::int64_t i;
-
-#pragma omp parallel for num_threads(m_scenario->m_scenario->m_threadingNumProcessors) firstprivate(thread_id, pt_array)
-		for (i = 0; i < num; i++) {
-			if (thread_id == -1) {
-				thread_id = omp_get_thread_num();
-				CWorkerThread::native_handle_type thread = CWorkerThreadPool::GetCurrentThread();
-				CWorkerThreadPool::SetThreadAffinityToMask(thread, thread_id);
+	if ((count != 1) && (num <= 0xffffffff)) {
+		m_scenario->ParallelFor((std::uint32_t)num, 16, [&](std::uint32_t begin, std::uint32_t end) {
+			boost::multi_array<typename Scenario<_type>::closest_calc, 2> chunk_array(boost::extents[discretize][discretize]);
+			for (std::uint32_t i = begin; i < end; i++) {
+				const uint64_t cx = cx1 + i % xsize;
+				const uint64_t cy = cy1 + i / xsize;
+				retrieveDStat(stat, fuel, discretize, sts_prev, stats, step, cx, cy, chunk_array, &add_lock);
 			}
-			const uint64_t cx = cx1 + i % xsize;
-			const uint64_t cy = cy1 + i / xsize;
-			retrieveDStat(stat, fuel, discretize, sts_prev, stats, step, cx, cy, pt_array, &add_lock);
-		}
+		});
 	} else {
 		std::uint64_t cx, cy;
 		for (cx = cx1; cx <= cx2; cx++)
@@ -0,0 +1,206 @@
+/**
+ * WISE_Scenario_Growth_Module: ScenarioTrace.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScenarioTrace.h"
+
+#if SCENARIO_TRACE_LEVEL > SCENARIO_TRACE_LEVEL_OFF
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+constexpr std::uint32_t TRACE_RING_SIZE = 8192;		// must be a power of 2
+
+const char *traceEventName[] = {
+	"PHASE",
+	"ADVANCE_FIRE",
+	"ADD_POINTS",
+	"ADD_POINT",
+	"EQUIDISTANT",
+	"GROW_WEATHER",
+	"GROW",
+	"CAN_BURN",
+	"TRACK_VECTOR",
+	"EXPORT"
+};
+static_assert(sizeof(traceEventName) / sizeof(traceEventName[0]) == (size_t)ScenarioTraceEvent::COUNT, "traceEventName is out of date");
+
+
+struct TraceRing {									// single producer (the owning thread), single consumer (the drain thread)
+	ScenarioTraceRecord			records[TRACE_RING_SIZE];
+	std::atomic<std::uint32_t>	head{ 0 },			// only written by the owning thread
+								tail{ 0 };			// only written by the drain
+	std::uint32_t				sequence{ 0 };
+	std::uint16_t				thread;
+	std::atomic<bool>			retired{ false };	// owning thread has exited, free once drained
+};
+
+
+class TraceDrain {
+public:
+	TraceDrain() {
+		const char *path = getenv("WISE_SCENARIO_TRACE");
+		if ((path) && (*path))
+			m_out = fopen(path, "w");
+		if (!m_out)
+			m_out = stderr;
+		m_thread = std::thread(&TraceDrain::run, this);
+	}
+
+	void Shutdown() {								// stops and joins the drain thread, then writes out what's left - the drain itself stays
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			if (m_stop)
+				return;
+			m_stop = true;
+		}
+		m_wake.notify_all();
+		m_thread.join();
+		Flush();									// rings still owned by live threads are left in place, those threads may still touch them
+	}
+
+	TraceRing *Register() {
+		TraceRing *ring = new TraceRing();
+		std::lock_guard<std::mutex> guard(m_lock);
+		ring->thread = m_nextThread++;
+		m_rings.push_back(ring);
+		return ring;
+	}
+
+	void Flush() {
+		std::lock_guard<std::mutex> guard(m_lock);
+		drainAll();
+	}
+
+private:
+	void run() {
+		std::unique_lock<std::mutex> guard(m_lock);
+		while (!m_stop) {
+			m_wake.wait_for(guard, std::chrono::milliseconds(50));
+			drainAll();
+		}
+	}
+
+	void drainAll() {								// m_lock must be held
+		for (auto it = m_rings.begin(); it != m_rings.end(); ) {
+			TraceRing *ring = *it;
+			bool retired = ring->retired.load(std::memory_order_acquire);
+			drain(ring);
+			if (retired) {
+				delete ring;
+				it = m_rings.erase(it);
+			} else
+				it++;
+		}
+		fflush(m_out);
+	}
+
+	void drain(TraceRing *ring) {
+		std::uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+		const std::uint32_t head = ring->head.load(std::memory_order_acquire);
+		while (tail != head) {
+			const ScenarioTraceRecord &r = ring->records[tail & (TRACE_RING_SIZE - 1)];
+			fprintf(m_out, "%llu %u:%u %s sc=%p obj=%p %.17g %.17g %.17g %.17g\n",
+				(unsigned long long)r.timestamp, (unsigned)r.thread, (unsigned)r.sequence,
+				(r.event < (std::uint16_t)ScenarioTraceEvent::COUNT) ? traceEventName[r.event] : "?",
+				r.scenario, r.object, r.v[0], r.v[1], r.v[2], r.v[3]);
+			tail++;
+		}
+		ring->tail.store(tail, std::memory_order_release);
+	}
+
+	std::mutex					m_lock;
+	std::condition_variable		m_wake;
+	std::vector<TraceRing *>	m_rings;
+	std::thread					m_thread;
+	FILE						*m_out{ nullptr };
+	std::uint16_t				m_nextThread{ 0 };
+	bool						m_stop{ false };
+};
+
+
+TraceDrain &traceDrain() {							// never destroyed, detached threads can still be recording while statics are torn down
+	static TraceDrain *drain = []() {
+		TraceDrain *d = new TraceDrain();
+		std::atexit([]() { traceDrain().Shutdown(); });	// at exit, or when the library's unloaded, before stdio closes or our code goes away
+		return d;
+	}();
+	return *drain;
+}
+
+
+struct TraceRingOwner {
+	TraceRing *ring{ nullptr };
+	~TraceRingOwner() {
+		if (ring)
+			ring->retired.store(true, std::memory_order_release);
+	}
+};
+
+thread_local TraceRingOwner traceRingOwner;
+
+}
+
+
+void ScenarioTrace::Record(ScenarioTraceEvent event, const void *scenario, const void *object, double v0, double v1, double v2, double v3) {
+	TraceRing *ring = traceRingOwner.ring;
+	if (!ring)
+		ring = traceRingOwner.ring = traceDrain().Register();
+
+	const std::uint32_t head = ring->head.load(std::memory_order_relaxed);
+	const std::uint32_t sequence = ring->sequence++;
+	if ((head - ring->tail.load(std::memory_order_acquire)) >= TRACE_RING_SIZE)
+		return;										// full, drop it rather than wait on the drain - the sequence gap shows it
+
+	ScenarioTraceRecord &r = ring->records[head & (TRACE_RING_SIZE - 1)];
+	r.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	r.scenario = scenario;
+	r.object = object;
+	r.v[0] = v0;
+	r.v[1] = v1;
+	r.v[2] = v2;
+	r.v[3] = v3;
+	r.event = (std::uint16_t)event;
+	r.thread = ring->thread;
+	r.sequence = sequence;
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+
+void ScenarioTrace::Flush() {
+	traceDrain().Flush();
+}
+
+#else
+
+void ScenarioTrace::Record(ScenarioTraceEvent /*event*/, const void * /*scenario*/, const void * /*object*/, double /*v0*/, double /*v1*/, double /*v2*/, double /*v3*/) {
+}
+
+
+void ScenarioTrace::Flush() {
+}
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * WISE_Scenario_Growth_Module: ScenarioTrace.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SCENARIOTRACE_H
+#define __SCENARIOTRACE_H
+
+#include <cstdint>
+
+// Tracing for the simulation kernels.  Records are fixed size, written to a ring buffer owned by the calling thread (no locks,
+// no formatting), and drained to a file by a background thread.  The level is chosen at compile time (SCENARIO_TRACE_LEVEL, set
+// from CMake) - any trace above that level compiles to nothing, arguments included, so release builds pay nothing.
+// The output goes to the file named by the WISE_SCENARIO_TRACE environment variable, or to stderr if that isn't set.
+
+#define SCENARIO_TRACE_LEVEL_OFF		0
+#define SCENARIO_TRACE_LEVEL_STEP		1	// once per time step or simulation phase
+#define SCENARIO_TRACE_LEVEL_FRONT		2	// once per fire or fire front
+#define SCENARIO_TRACE_LEVEL_VERTEX		3	// once per vertex, inside the growth kernels
+
+#ifndef SCENARIO_TRACE_LEVEL
+#define SCENARIO_TRACE_LEVEL			SCENARIO_TRACE_LEVEL_OFF
+#endif
+
+
+enum class ScenarioTraceEvent : std::uint16_t {	// v[] contents are listed for each event
+	PHASE = 0,			// object = time step: phase, points, fronts, clips
+	ADVANCE_FIRE,		// object = scenario fire: time, polygons, fronts copied, active fire updated
+	ADD_POINTS,			// object = fire front: perimeter resolution, points
+	ADD_POINT,			// object = new fire point: x, y, distance, distance factor
+	EQUIDISTANT,		// object = fire front: distance factor, steps
+	GROW_WEATHER,		// object = fire point: time, FFMC, FWI, ISI
+	GROW,				// object = fire point: time, can burn, ROSeq, ellipse ROS
+	CAN_BURN,			// object = nullptr: time, gate (> 0 can burn), RH, FWI
+	TRACK_VECTOR,		// object = fire point: x, y, intersections found
+	EXPORT,				// object = time step: time, points, interior, skipped
+	COUNT
+};
+
+
+struct ScenarioTraceRecord {					// 64 bytes, one per cache line
+	std::uint64_t		timestamp;				// steady clock, nanoseconds
+	const void			*scenario;
+	const void			*object;
+	double				v[4];
+	std::uint16_t		event;
+	std::uint16_t		thread;
+	std::uint32_t		sequence;				// per-thread, gaps mean records were dropped because the ring was full
+};
+
+
+namespace ScenarioTrace {
+	void Record(ScenarioTraceEvent event, const void *scenario, const void *object, double v0 = 0.0, double v1 = 0.0, double v2 = 0.0, double v3 = 0.0);
+	void Flush();								// synchronously drains every thread's ring
+}
+
+
+#if SCENARIO_TRACE_LEVEL >= SCENARIO_TRACE_LEVEL_STEP
+#define SCENARIO_TRACE_STEP(...)		ScenarioTrace::Record(__VA_ARGS__)
+#else
+#define SCENARIO_TRACE_STEP(...)		((void)0)
+#endif
+
+#if SCENARIO_TRACE_LEVEL >= SCENARIO_TRACE_LEVEL_FRONT
+#define SCENARIO_TRACE_FRONT(...)		ScenarioTrace::Record(__VA_ARGS__)
+#else
+#define SCENARIO_TRACE_FRONT(...)		((void)0)
+#endif
+
+#if SCENARIO_TRACE_LEVEL >= SCENARIO_TRACE_LEVEL_VERTEX
+#define SCENARIO_TRACE_VERTEX(...)		ScenarioTrace::Record(__VA_ARGS__)
+#else
+#define SCENARIO_TRACE_VERTEX(...)		((void)0)
+#endif
+
+#endif
@@ -0,0 +1,244 @@
+/**
+ * WISE_Scenario_Growth_Module: StepArena.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "StepArena.h"
+#include "NumaTopology.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+
+namespace {
+
+thread_local StepArena *currentArena = nullptr;
+
+constexpr size_t roundUp(size_t bytes)			{ return (bytes + 15) & ~((size_t)15); }
+
+}
+
+
+StepArena::freeList::freeList() {
+	for (std::uint32_t i = 0; i < SIZE_CLASSES; i++)
+		classes[i].bytes = 0;
+	clear();
+}
+
+
+void StepArena::freeList::clear() {
+	for (std::uint32_t i = 0; i < SIZE_CLASSES; i++) {
+		classes[i].head = nullptr;
+		classes[i].count = 0;
+	}
+}
+
+
+StepArena::StepArena() : m_current(nullptr), m_blocks(nullptr), m_live(0), m_reserved(0) {
+	for (std::uint32_t i = 0; i < FREE_SLOTS; i++)
+		m_slots[i] = nullptr;
+}
+
+
+StepArena::~StepArena() {
+	Release();
+	for (std::uint32_t i = 0; i < FREE_SLOTS; i++)
+		delete m_slots[i].load(std::memory_order_relaxed);
+}
+
+
+void *StepArena::Allocate(size_t bytes) {
+	size_t total = roundUp(bytes) + HEADER;
+	void *memory = nullptr;
+
+	const std::uint32_t slot = NumaTopology::WorkerSlot();
+	if (slot < FREE_SLOTS) {
+		freeList *list = m_slots[slot].load(std::memory_order_relaxed);
+		if (list)
+			memory = pop(list, total);
+	} else {
+		sizeClass *c = findClass(&m_shared, total, false);
+		if ((c) && (c->count.load(std::memory_order_relaxed))) {
+			std::lock_guard<std::mutex> guard(m_freeLock);
+			memory = pop(&m_shared, total);
+		}
+	}
+	if (memory)
+		memset(memory, 0, total);
+	else
+		memory = bump(total);
+
+	*(StepArena **)memory = this;
+	*((size_t *)memory + 1) = total;
+	m_live.fetch_add(1, std::memory_order_relaxed);
+	return (unsigned char *)memory + HEADER;
+}
+
+
+void *StepArena::bump(size_t total) {
+	const size_t block_header = roundUp(sizeof(block));
+
+	if (total > (BLOCK_SIZE >> 2)) {					// big enough to get a block to itself, rather than waste the rest of the current one
+		void *memory = calloc(1, block_header + total);
+		if (!memory)
+			throw std::bad_alloc();
+		block *b = new (memory) block;
+		b->size = total;
+		b->used = total;
+		std::lock_guard<std::mutex> guard(m_blockLock);
+		b->next = m_blocks;
+		m_blocks = b;
+		m_reserved.fetch_add(total, std::memory_order_relaxed);
+		return (unsigned char *)b + block_header;
+	}
+
+	while (1) {
+		block *b = m_current.load(std::memory_order_acquire);
+		if (b) {
+			size_t offset = b->used.fetch_add(total, std::memory_order_relaxed);
+			if (offset + total <= b->size)
+				return (unsigned char *)b + block_header + offset;
+		}
+
+		std::lock_guard<std::mutex> guard(m_blockLock);
+		if (m_current.load(std::memory_order_acquire) != b)
+			continue;									// someone else has already started a new one
+		void *memory = calloc(1, block_header + BLOCK_SIZE);
+		if (!memory)
+			throw std::bad_alloc();
+		block *n = new (memory) block;
+		n->size = BLOCK_SIZE;
+		n->used = 0;
+		n->next = m_blocks;
+		m_blocks = n;
+		m_reserved.fetch_add(BLOCK_SIZE, std::memory_order_relaxed);
+		m_current.store(n, std::memory_order_release);
+	}
+}
+
+
+StepArena::sizeClass *StepArena::findClass(freeList *list, size_t bytes, bool add) {	// for m_shared, add is only set with m_freeLock held
+	for (std::uint32_t i = 0; i < SIZE_CLASSES; i++) {
+		size_t b = list->classes[i].bytes;
+		if (b == bytes)
+			return list->classes + i;
+		if ((!b) && (add)) {
+			list->classes[i].bytes = bytes;
+			return list->classes + i;
+		}
+	}
+	return nullptr;
+}
+
+
+void *StepArena::pop(freeList *list, size_t bytes) {
+	sizeClass *c = findClass(list, bytes, false);
+	if ((!c) || (!c->head))
+		return nullptr;
+	freeNode *n = c->head;
+	c->head = n->next;
+	c->count.fetch_sub(1, std::memory_order_relaxed);
+	return n;
+}
+
+
+void StepArena::push(freeList *list, void *memory, size_t bytes) {
+	sizeClass *c = findClass(list, bytes, true);
+	if (!c)
+		return;											// an odd size, it just waits for the arena to go
+	freeNode *n = (freeNode *)memory;
+	n->next = c->head;
+	c->head = n;
+	c->count.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void StepArena::recycle(void *memory, size_t bytes) {
+	const std::uint32_t slot = NumaTopology::WorkerSlot();
+	if (slot < FREE_SLOTS) {
+		freeList *list = m_slots[slot].load(std::memory_order_relaxed);
+		if (!list) {
+			list = new (std::nothrow) freeList;
+			if (!list)
+				return;									// it just waits for the arena to go
+			m_slots[slot].store(list, std::memory_order_relaxed);
+		}
+		push(list, memory, bytes);
+	} else {
+		std::lock_guard<std::mutex> guard(m_freeLock);
+		push(&m_shared, memory, bytes);
+	}
+}
+
+
+void StepArena::Release() {
+	std::lock_guard<std::mutex> guard(m_blockLock);
+	std::lock_guard<std::mutex> guard2(m_freeLock);
+	while (m_blocks) {
+		block *b = m_blocks;
+		m_blocks = b->next;
+		free(b);
+	}
+	m_current.store(nullptr, std::memory_order_release);
+	m_shared.clear();
+	for (std::uint32_t i = 0; i < FREE_SLOTS; i++) {
+		freeList *list = m_slots[i].load(std::memory_order_relaxed);
+		if (list)
+			list->clear();
+	}
+	m_reserved = 0;
+}
+
+
+void *StepArena::New(size_t bytes) {
+	if (currentArena)
+		return currentArena->Allocate(bytes);
+
+	void *memory = calloc(1, roundUp(bytes) + HEADER);
+	if (!memory)
+		throw std::bad_alloc();
+	*(StepArena **)memory = nullptr;
+	return (unsigned char *)memory + HEADER;
+}
+
+
+void StepArena::Free(void *memory) {
+	if (!memory)
+		return;
+	unsigned char *base = (unsigned char *)memory - HEADER;
+	StepArena *owner = *(StepArena **)base;
+	if (owner) {
+		owner->m_live.fetch_sub(1, std::memory_order_relaxed);
+		owner->recycle(base, *((size_t *)base + 1));
+	} else
+		free(base);
+}
+
+
+StepArena *StepArena::Current() {
+	return currentArena;
+}
+
+
+StepArena::Scope::Scope(StepArena *arena) : m_prev(currentArena) {
+	currentArena = arena;
+}
+
+
+StepArena::Scope::~Scope() {
+	currentArena = m_prev;
+}
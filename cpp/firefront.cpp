@@ -18,14 +18,13 @@
 
 #include "angles.h"
 #include "macros.h"
-#include <omp.h>
+#include <atomic>
 #include "CWFGM_Scenario.h"
 #include "firefront.h"
 #include "ScenarioTimeStep.h"
 #include "scenario.h"
 
 
-IMPLEMENT_OBJECT_CACHE_MT_TEMPLATE(FireFront, FireFront, 4 * 1024 * 1024 / sizeof(FireFront<fireengine_float_type>), false, 16, fireengine_float_type)
 IMPLEMENT_OBJECT_CACHE_MT_TEMPLATE(FireFrontExport, FireFrontExport, 256 * 1024 / sizeof(FireFrontExport<fireengine_float_type>), false, 16, fireengine_float_type)
 
 
@@ -163,10 +162,7 @@ FirePoint<_type> *FireFront<_type>::GetNearestPoint(const XYPointType &pt, bool
 #define QUEUE_UP	128
 
 template<class _type>
-bool FireFront<_type>::advancePoint(const _type scale, const FirePoint<_type> *prev, FirePoint<_type> *curr, const FirePoint<_type> *next,
-    const XYPointType &prev_e_ros, const XYPointType &curr_e_ros, const XYPointType &next_e_ros) {
-
-//	does curr_e_ros equal m_ellipse_ros?
+bool FireFront<_type>::advancePoint(const _type scale, FirePoint<_type> *curr) {
 	if (curr->CanMove()) {				// only smooth (and advance) active points
 
 		bool retval;
@@ -189,66 +185,41 @@ bool FireFront<_type>::advancePoint(const _type scale, const FirePoint<_type> *p
 	return false;
 }
 
-template<class _type>
-struct advancePointStr {
-	FireFront<_type> *self;
-	FirePoint<_type> * VOLATILE fp;
-	CThreadCriticalSection lock_ll;
-	_type scale;
-};
-
 
 template<class _type>
-bool FireFront<_type>::AdvanceFire(const _type scale) {
+bool FireFront<_type>::AdvanceFire(const _type scale, bool alone) {
 	EnableCaching(false);
 
-	bool advanced = false;
-	if ((NumPoints() > QUEUE_UP) && (Fire()->TimeStep()->m_scenario->m_pool)) {
-
+	std::uint32_t num_pts = NumPoints();
+	if ((alone) && (num_pts > QUEUE_UP) && (Fire()->TimeStep()->m_scenario->m_pool)) {	// m_omp_fp_array is shared, so only when no other fire is being advanced
 		std::vector<FirePoint<_type> *> &fp_array = Fire()->TimeStep()->m_scenario->m_omp_fp_array;
-		std::int32_t i = 0, num_pts = NumPoints();
 		if ((std::uint32_t)fp_array.size() < num_pts)
 			fp_array.resize(num_pts);
+		std::uint32_t i = 0;
 		FirePoint<_type> *fp = LH_Head();
 		while (fp->LN_Succ()) {
 			fp_array[i++] = fp;
 			fp = fp->LN_Succ();
 		}
 
-		int thread_id = (Fire()->TimeStep()->m_scenario->m_scenario->m_optionFlags & (1ull << (CWFGM_SCENARIO_OPTION_FORCE_AFFINITY))) ? -1 : -2;
-		#pragma omp parallel for shared(advanced) num_threads(Fire()->TimeStep()->m_scenario->m_scenario->m_threadingNumProcessors) firstprivate(thread_id)
-		for (i = 0; i < num_pts; i++) {
-			if (thread_id == -1) {
-				thread_id = omp_get_thread_num();
-				CWorkerThread::native_handle_type thread = CWorkerThreadPool::GetCurrentThread();
-				CWorkerThreadPool::SetThreadAffinityToMask(thread, thread_id);
-			}
-			FirePoint<_type> *next = fp_array[i];
-			FirePoint<_type> *curr = next->LN_PredWrap();
-			FirePoint<_type> *prev = curr->LN_PredWrap();
-			if (advancePoint(scale, prev, curr, next, prev->m_prevPoint->m_ellipse_ros, curr->m_prevPoint->m_ellipse_ros, next->m_prevPoint->m_ellipse_ros))
-				advanced = true;
-		}
+		std::atomic<bool> advanced(false);
+		Fire()->TimeStep()->m_scenario->ParallelFor(num_pts, QUEUE_UP, [&](std::uint32_t begin, std::uint32_t end) {
+			bool adv = false;
+			for (std::uint32_t j = begin; j < end; j++)
+				if (advancePoint(scale, fp_array[j]))
+					adv = true;
+			if (adv)
+				advanced.store(true, std::memory_order_relaxed);
+		});
+		return advanced.load();
+	}
 
-	} else {
-		FirePoint<_type>	*curr = LH_Tail(),
-							*prev = curr->LN_Pred(),
-							*next = LH_Head();				// we deal with the neighbours for smoothing
-
-		XYPointType	next_e_ros,
-					prev_e_ros = prev->m_prevPoint->m_ellipse_ros,
-					curr_e_ros = curr->m_prevPoint->m_ellipse_ros;
-
-		while (next->LN_Succ()) {
-			next_e_ros = next->m_prevPoint->m_ellipse_ros;
-			if (advancePoint(scale, prev, curr, next, prev_e_ros, curr_e_ros, next_e_ros))
-				advanced = true;
-			prev_e_ros = curr_e_ros;
-			curr_e_ros = next_e_ros;
-			prev = curr;
-			curr = next;
-			next = next->LN_Succ();
-		}
+	bool advanced = false;
+	FirePoint<_type> *fp = LH_Head();
+	while (fp->LN_Succ()) {
+		if (advancePoint(scale, fp))
+			advanced = true;
+		fp = fp->LN_Succ();
 	}
 	return advanced;
 }
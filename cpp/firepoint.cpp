@@ -25,9 +25,6 @@
 #include "propsysreplacement.h"
 
 
-IMPLEMENT_OBJECT_CACHE_MT_TEMPLATE(FirePoint, FirePoint, 1024*1024*256/sizeof(FirePoint<fireengine_float_type>), true, 16, fireengine_float_type)
-
-
 template<class _type>
 FirePoint<_type>::FirePoint() {
 	m_prevPoint = nullptr;
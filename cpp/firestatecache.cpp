@@ -25,10 +25,42 @@
 #include "GridCom_ext.h"
 #include "ScenarioTimeStep.h"
 #include "CWFGM_Scenario_Internal.h"
-#include <omp.h>
+#include "ScenarioTrace.h"
+#include <atomic>
+#include <cstring>
 
 
 #define ADVANCE_FUDGE (0.015)		// should modify to calculate off the angle through intersection with the vector break
+#define FUEL_TILE		32			// cells on a side of the per-thread fuel cache, neighbouring vertices land in the same or adjacent slots
+#define WEATHER_CACHE	8192		// entries in the shared weather cache, a step only needs as many as the cells its vertices are in
+
+
+namespace {
+
+struct fuelTileEntry {
+	std::uint64_t	owner;			// ScenarioCache::m_fuelTileOwner, 0 for an empty slot
+	std::uint64_t	time;			// the grid only changes at event times, and steps end on every event time
+	XY_Rectangle	bbox;			// area the grid engine says the answer holds for
+	ICWFGM_Fuel		*fuel;
+	bool			valid, nonfuel;
+};
+
+thread_local fuelTileEntry fuelTile[FUEL_TILE * FUEL_TILE];
+std::atomic<std::uint64_t> fuelTileOwners{ 0 };	// so a new scenario at a freed one's address can't pick up its entries
+
+struct placeJob {
+	std::atomic<std::uint32_t>		next;
+	const NumaTopology::placement	*placement;
+};
+
+struct firstTouchJob {
+	std::atomic<std::uint32_t>		next;	// for any worker that wasn't given a slot
+	unsigned char					*memory;
+	size_t							bytes;
+	std::uint32_t					workers;
+};
+
+}
 
 
 template<class _type>
@@ -45,6 +77,13 @@ ScenarioGridCache<_type>::ScenarioGridCache(CCWFGM_Scenario *scenario, const XY_
 
 	m_minArea = 0.25;
 	gridToInternal2D(m_minArea);
+
+	XYPointType dims = m_ur - m_ll;
+	m_plot_X = (std::uint16_t)(dims.x * m_iresolution);
+	m_plot_Y = (std::uint16_t)(dims.y * m_iresolution);
+	m_arrivalX = 0;
+	m_arrivalTail = nullptr;
+	m_arrivalLost = false;
 }
 
 
@@ -57,10 +96,18 @@ template<class _type>
 void ScenarioGridCache<_type>::Size(const XYPointType &ll, const XYPointType &ur) {
 	if (!(m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_CACHE_GRID_POINTS))) {
 		XYPointType dims = ur - ll;
+		std::uint16_t plot_X = (std::uint16_t)(dims.x * m_iresolution),
+			plot_Y = (std::uint16_t)(dims.y * m_iresolution);
+		if ((plot_X != m_plot_X) || (plot_Y != m_plot_Y) || (!m_ll.Equals(ll))) {
+			CRWThreadSemaphoreEngage _semaphore_engageT(m_cplock, SEM_TRUE);
+			if (m_arrivalTail)
+				m_arrivalLost = true;			// recorded cells don't line up with the new grid
+			m_arrival.clear();
+		}
 		m_ll = ll;
 		m_ur = ur;
-		m_plot_X = (std::uint16_t)(dims.x * m_iresolution);
-		m_plot_Y = (std::uint16_t)(dims.y * m_iresolution);
+		m_plot_X = plot_X;
+		m_plot_Y = plot_Y;
 		return;
 	}
 }
@@ -493,99 +540,254 @@ void ScenarioGridCache<_type>::fromInternal3D(_type& value) const {			// opportu
 #endif
 
 template<class _type>
-void ScenarioGridCache<_type>::RecordTimeStep(ScenarioTimeStep<_type> *sts1) {
-	if (m_scenario->m_optionFlags & (1ull <<  CWFGM_SCENARIO_OPTION_PURGE_NONDISPLAYABLE))
-		if (!sts1->m_displayable)
-			return;			// no point in adding it if we're just going to delete it anyway
+bool ScenarioGridCache<_type>::arrivalCellXY(const XYPointType &pt, std::uint16_t &x, std::uint16_t &y, bool centered) const {
+	XYPointType loc(pt);
+	if (!(m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_FALSE_ORIGIN))) {
+		loc.x -= m_ll.x;
+		loc.y -= m_ll.y;
+	}
+	if (!(m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_FALSE_SCALING))) {
+		loc.x *= m_iresolution;
+		loc.y *= m_iresolution;
+	}
+	if ((loc.x < 0.0) || (loc.y < 0.0) || (loc.x >= (_type)m_plot_X) || (loc.y >= (_type)m_plot_Y))
+		return false;
+	x = (std::uint16_t)loc.x;
+	y = (std::uint16_t)loc.y;
+	if (centered)						// the raster only knows about the centers of its cells
+		if ((fabs(loc.x - (_type)x - 0.5) > 1.0e-4) || (fabs(loc.y - (_type)y - 0.5) > 1.0e-4))
+			return false;
+	return true;
+}
 
-	CRWThreadSemaphoreEngage _semaphore_engageT(m_cplock, SEM_TRUE);
-	const ScenarioTimeStep<_type> *sts = sts1, *sts_prev = sts->LN_Pred();
 
-	if (!sts_prev->LN_Pred()) {
-		return;
+template<class _type>
+const typename ScenarioGridCache<_type>::arrivalCell *ScenarioGridCache<_type>::arrivalLookup(std::uint16_t x, std::uint16_t y) const {
+	if (m_arrival.empty())
+		return nullptr;
+	const arrivalTile *tile = m_arrival[(y / ARRIVAL_TILE) * m_arrivalX + (x / ARRIVAL_TILE)].get();
+	if (!tile)
+		return nullptr;
+	return &tile->cell[(y % ARRIVAL_TILE) * ARRIVAL_TILE + (x % ARRIVAL_TILE)];
+}
+
+
+template<class _type>
+typename ScenarioGridCache<_type>::arrivalCell *ScenarioGridCache<_type>::arrivalAlloc(std::uint16_t x, std::uint16_t y) {
+	if (m_arrival.empty()) {
+		m_arrivalX = (m_plot_X + ARRIVAL_TILE - 1) / ARRIVAL_TILE;
+		m_arrival.resize((std::size_t)m_arrivalX * ((m_plot_Y + ARRIVAL_TILE - 1) / ARRIVAL_TILE));
 	}
+	std::unique_ptr<arrivalTile> &tile = m_arrival[(y / ARRIVAL_TILE) * m_arrivalX + (x / ARRIVAL_TILE)];
+	if (!tile)
+		tile = std::make_unique<arrivalTile>();
+	return &tile->cell[(y % ARRIVAL_TILE) * ARRIVAL_TILE + (x % ARRIVAL_TILE)];
+}
 
+
+template<class _type>
+void ScenarioGridCache<_type>::RecordTimeStep(ScenarioTimeStep<_type> *sts) {
+	CRWThreadSemaphoreEngage _semaphore_engageT(m_cplock, SEM_TRUE);
+	if ((m_arrivalLost) || (!m_plot_X) || (!m_plot_Y))
+		return;
+	if (m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_INDEPENDENT_TIMESTEPS))
+		return;								// a step's perimeter needn't contain the last one's, so inside an earlier step doesn't mean burned now
+	weak_assert((!m_arrivalTail) || (m_arrivalTail->m_time < sts->m_time));
+
+	const bool stats = (m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_CACHE_GRID_POINTS)) ? true : false;
 	XYRectangleType bounds;
 	ScenarioFire<_type> *sf = sts->m_fires.LH_Head();
 	while (sf->LN_Succ()) {
 		if (sf->BoundingBox(bounds)) {
-			bounds.m_min -= m_ll;
-			bounds.m_max -= m_ll;
-			bounds.m_min *= m_iresolution;
-			bounds.m_max *= m_iresolution;
-
-			std::uint16_t x1 = (bounds.m_min.x < 0.0) ? 0 : (std::uint16_t)bounds.m_min.x,
-				x2 = (bounds.m_max.x < 0.0) ? 0 : (std::uint16_t)bounds.m_max.x,
-				y1 = (bounds.m_min.y < 0.0) ? 0 : (std::uint16_t)bounds.m_min.y,
-				y2 = (bounds.m_max.y < 0.0) ? 0 : (std::uint16_t)bounds.m_max.y,
-				x, y;
-			if (x1 >= m_plot_X)	x1 = m_plot_X - 1;
-			if (x2 >= m_plot_X)	x2 = m_plot_X - 1;
-			if (y1 >= m_plot_Y)	y1 = m_plot_Y - 1;
-			if (y2 >= m_plot_Y)	y2 = m_plot_Y - 1;
-
-			for (x = x1; x <= x2; x++)
-				for (y = y1; y <= y2; y++) {
-					sts = sts1;
-					std::uint32_t idx = arrayIndex(x, y);
-
-					XYPointType pt(x, y);
-					pt.x += 0.5;
-					pt.y += 0.5;
-					pt *= m_resolution;
-					pt += m_ll;
-
-					if (!sts->PointInArea(pt))
-						continue;
-
-					//				check to see if it's outide sf->prev, if not then skip
-									// this check will be implicit due to how the simulation runs
-
-					//				follow existing logic for picking curr or prev closest point and store
-
-					FireFront<_type>* closest_ff;
-				AGAIN:
-					FirePoint<_type>* closest = sts->GetNearestPoint(pt, true, &closest_ff, true);
-
-					if (!closest) {				// so, this will occur and will loop back until we find an appropriate closest point - shouldn't matter if the timestep includes all ScenarioFire's or not
-						weak_assert(false);				// shouldn't occur due to the continue statement/test above
-						sts = sts->LN_Pred();
-						if (sts->LN_Pred())
-							goto AGAIN;
-						continue;
+			std::uint16_t x1, y1, x2, y2;
+			XYPointType loc(bounds.m_min);
+			if (!(m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_FALSE_ORIGIN)))
+				loc -= m_ll;
+			if (!(m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_FALSE_SCALING)))
+				loc *= m_iresolution;
+			x1 = (loc.x < 0.0) ? 0 : ((loc.x >= m_plot_X) ? m_plot_X - 1 : (std::uint16_t)loc.x);
+			y1 = (loc.y < 0.0) ? 0 : ((loc.y >= m_plot_Y) ? m_plot_Y - 1 : (std::uint16_t)loc.y);
+			loc = bounds.m_max;
+			if (!(m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_FALSE_ORIGIN)))
+				loc -= m_ll;
+			if (!(m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_FALSE_SCALING)))
+				loc *= m_iresolution;
+			x2 = (loc.x < 0.0) ? 0 : ((loc.x >= m_plot_X) ? m_plot_X - 1 : (std::uint16_t)loc.x);
+			y2 = (loc.y < 0.0) ? 0 : ((loc.y >= m_plot_Y) ? m_plot_Y - 1 : (std::uint16_t)loc.y);
+
+			for (std::uint16_t ty = y1 / ARRIVAL_TILE; ty <= y2 / ARRIVAL_TILE; ty++)		// tiles are allocated up front so the rows can be filled in parallel
+				for (std::uint16_t tx = x1 / ARRIVAL_TILE; tx <= x2 / ARRIVAL_TILE; tx++)
+					arrivalAlloc(tx * ARRIVAL_TILE, ty * ARRIVAL_TILE);
+
+			sts->m_scenario->ParallelFor(y2 - y1 + 1, 1, [&](std::uint32_t begin, std::uint32_t end) {	// a row at a time, rows don't share cells
+				for (std::uint32_t r = begin; r < end; r++) {
+					const std::uint16_t y = (std::uint16_t)(y1 + r);
+					for (std::uint16_t x = x1; x <= x2; x++) {
+						arrivalCell *c = const_cast<arrivalCell *>(arrivalLookup(x, (std::uint16_t)y));
+						if (c->arrival)
+							continue;					// inside an earlier step, or another fire's box in this step
+
+						XYPointType pt(x, y);
+						pt.x += 0.5;
+						pt.y += 0.5;
+						if (!(m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_FALSE_SCALING)))
+							pt *= m_resolution;
+						if (!(m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_FALSE_ORIGIN)))
+							pt += m_ll;
+
+						if (!sts->PointInArea(pt))
+							continue;
+						c->arrival = sts;
+						if (!stats)
+							continue;
+
+														// same choice between the current and previous perimeters as getStatsClosestVertex()
+						FireFront<_type> *closest_ff;
+						FirePoint<_type> *closest = sts->GetNearestPoint(pt, true, &closest_ff, true);
+						if (!closest)
+							continue;
+
+						const ScenarioTimeStep<_type> *sts_prev;
+						ScenarioFire<_type> *psf = closest_ff->Fire()->LN_CalcPred();
+						if ((psf) && (!psf->TimeStep()->m_spilled))
+							sts_prev = psf->TimeStep();
+						else
+							sts_prev = nullptr;
+
+						FirePoint<_type> *prev_closest;
+						FireFront<_type> *prev_closest_ff;
+						if (sts_prev)	prev_closest = sts_prev->GetNearestPoint(pt, false, &prev_closest_ff, false);
+						else			prev_closest = nullptr;
+
+						FirePoint<_type> *fp;
+						if ((prev_closest) && (prev_closest->DistanceToSquared(pt) < closest->DistanceToSquared(pt))) {
+							fp = prev_closest;
+							c->closest = sts_prev;
+						} else {
+							fp = closest;
+							c->closest = sts;
+						}
+						double ros, fi, raz;
+						fp->RetrieveStat(CWFGM_FIRE_STAT_ROS, ros);
+						fp->RetrieveStat(CWFGM_FIRE_STAT_FI, fi);
+						fp->RetrieveStat(CWFGM_FIRE_STAT_RAZ, raz);
+						c->ros = ros;
+						c->fi = fi;
+						c->raz = raz;
 					}
-
-					ScenarioFire<_type>* psf = closest_ff->Fire()->LN_CalcPred();
-					if (psf)	sts_prev = psf->TimeStep();
-					else		sts_prev = nullptr;
-
-					FirePoint<_type>* prev_closest;
-					FireFront<_type>* prev_closest_ff;
-					if (sts_prev)	prev_closest = sts_prev->GetNearestPoint(pt, false, &prev_closest_ff, false);
-					else			prev_closest = nullptr;
-
 				}
+			});
 		}
 		sf = sf->LN_Succ();
 	}
+	m_arrivalTail = sts;
+}
+
+
+template<class _type>
+void ScenarioGridCache<_type>::ForgetTimeStep(const ScenarioTimeStep<_type> *sts, const ScenarioTimeStep<_type> *replacement) {
+	CRWThreadSemaphoreEngage _semaphore_engageT(m_cplock, SEM_TRUE);
+	if ((!m_arrivalTail) || (m_arrivalTail->m_time < sts->m_time))
+		return;								// never recorded, nothing refers to it
+
+	for (auto &tile : m_arrival)
+		if (tile)
+			for (std::uint32_t i = 0; i < ARRIVAL_TILE * ARRIVAL_TILE; i++) {
+				arrivalCell &c = tile->cell[i];
+				if (c.arrival == sts) {
+					c.arrival = replacement;		// the next step still contains the center, but its closest vertex would be a different one
+					c.closest = nullptr;
+				} else if (c.closest == sts)
+					c.closest = nullptr;
+			}
+	if (m_arrivalTail == sts) {
+		m_arrivalTail = sts->LN_Pred();
+		if (!m_arrivalTail->LN_Pred())
+			m_arrivalTail = nullptr;
+	}
+}
+
+
+template<class _type>
+void ScenarioGridCache<_type>::ClearArrivals() {
+	CRWThreadSemaphoreEngage _semaphore_engageT(m_cplock, SEM_TRUE);
+	m_arrival.clear();
+	m_arrivalTail = nullptr;
+	m_arrivalLost = false;
 }
 
 
+template<class _type>
+bool ScenarioGridCache<_type>::ArrivalBurned(const XYPointType &pt, const ScenarioTimeStep<_type> *sts, bool &burned) const {
+	CRWThreadSemaphoreEngage _semaphore_engageT(*(CRWThreadSemaphore *)&m_cplock, SEM_FALSE);
+	if ((m_arrivalLost) || (!m_arrivalTail) || (m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_INDEPENDENT_TIMESTEPS)))
+		return false;
+	if ((m_arrivalTail->m_time < sts->m_time) && (m_arrivalTail->LN_Succ()->LN_Succ()))
+		return false;						// not recorded yet
+
+	std::uint16_t x, y;
+	if (!arrivalCellXY(pt, x, y, true))
+		return false;
+	const arrivalCell *c = arrivalLookup(x, y);
+	burned = ((c) && (c->arrival) && (c->arrival->m_time <= sts->m_time));
+	weak_assert((sts->m_spilled) || (burned == (sts->PointInArea(pt) != 0)));
+	return true;
+}
+
+
+template<class _type>
+bool ScenarioGridCache<_type>::ArrivalClosest(const XYPointType &pt, const WTime &mintime, const WTime &time, const ScenarioTimeStep<_type> *&closest, _type &ros, _type &fi, _type &raz) const {
+	CRWThreadSemaphoreEngage _semaphore_engageT(*(CRWThreadSemaphore *)&m_cplock, SEM_FALSE);
+	if ((m_arrivalLost) || (!m_arrivalTail) || (!time.GetTime(0)) || (m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_INDEPENDENT_TIMESTEPS)))
+		return false;
+	if ((m_arrivalTail->m_time < time) && (m_arrivalTail->LN_Succ()->LN_Succ()))
+		return false;
+
+	std::uint16_t x, y;
+	if (!arrivalCellXY(pt, x, y, true))
+		return false;
+	const arrivalCell *c = arrivalLookup(x, y);
+	if ((!c) || (!c->arrival) || (c->arrival->m_time > time)) {
+	    #ifdef _DEBUG
+		const ScenarioTimeStep<_type> *sts = m_arrivalTail;
+		while ((sts->LN_Pred()) && (sts->m_time > time))
+			sts = sts->LN_Pred();
+		weak_assert((!sts->LN_Pred()) || (sts->m_spilled) || (!sts->PointInArea(pt)));
+	    #endif
+		closest = nullptr;					// not burned by time
+		return true;
+	}
+	weak_assert((c->arrival->m_spilled) || (c->arrival->PointInArea(pt)));
+	if ((mintime.GetTime(0)) && (c->arrival->m_time <= mintime))
+		return false;						// the first perimeter after mintime isn't the one that reached the cell
+	if (!c->closest)
+		return false;
+	if ((mintime.GetTime(0)) && (c->closest->m_time <= mintime))
+		return false;						// the previous perimeter is excluded, so the closest vertex may be a different one
+
+	closest = c->closest;
+	ros = c->ros;
+	fi = c->fi;
+	raz = c->raz;
+	return true;
+}
+
 
 template<class _type>
 ScenarioCache<_type>::ScenarioCache(CCWFGM_Scenario* scenario, const XY_Point &start_ll, const XY_Point &start_ur, const _type resolution, const double landscapeFMC, const double landscapeElev, std::uint32_t numthreads) :
 		ScenarioGridCache<_type>(scenario, start_ll, start_ur, resolution),
 		m_numthreads(numthreads),
 		m_specifiedFMC_Landscape(landscapeFMC),
-		m_specifiedElev_Landscape(landscapeElev)
+		m_specifiedElev_Landscape(landscapeElev),
+		m_weatherCache(WEATHER_CACHE, (numthreads + 1) >> 1)					// a shard for every pair of threads, like m_closestcache
 {
 	m_pool = nullptr;
 	m_multithread = (CWorkerThreadPool::NumberProcessors() > 1) && (numthreads >= 2);
+	m_fuelTileOwner = ++fuelTileOwners;
 
 	PreCalculation();
 
-	m_assets = false;
-	m_staticVectorBreaksLL = nullptr;				// turned off as per Cordy's instructions
+	m_assets = false;								// static vector breaks are built on the first step, or shared in from an ensemble
 
 	HRESULT hr;
 	PolymorphicAttribute var;
@@ -600,33 +802,108 @@ ScenarioCache<_type>::ScenarioCache(CCWFGM_Scenario* scenario, const XY_Point &s
 
 template<class _type>
 void ScenarioCache<_type>::InitThreadPool(bool multithread) {
+	std::lock_guard<std::mutex> lock(m_poolLock);
 	if (!m_pool) {
 		m_multithread = (CWorkerThreadPool::NumberProcessors() > 1) && (multithread) && (m_numthreads >= 2);
 
 		if (m_multithread) {
-			m_pool = new CWorkerThreadPool(nullptr, nullptr, m_numthreads, THREAD_PRIORITY_BELOW_NORMAL, (m_scenario->m_optionFlags & (1ull << (CWFGM_SCENARIO_OPTION_FORCE_AFFINITY))) ? true : false);
-			omp_set_num_threads(m_numthreads);
-		}
-		else {
-			omp_set_num_threads(1);
+			m_pool = new CWorkerThreadPool(nullptr, nullptr, m_numthreads, THREAD_PRIORITY_BELOW_NORMAL, false);	// we place the workers ourselves
+
+			if (m_scenario->m_optionFlags & (1ull << (CWFGM_SCENARIO_OPTION_FORCE_AFFINITY)))
+				m_placement = NumaTopology::Instance().Acquire(m_numthreads);
+			placeJob job;						// every worker runs this once, taking the next slot (and its CPU if we're pinning)
+			job.next = 0;
+			job.placement = &m_placement;
+			m_pool->SetJobFunction(placeInit, &job);
+			m_pool->StartJob();
+			m_pool->BlockOnJob();
 		}
 	}
-	else if ((!multithread)) {
-		delete m_pool;
-		m_pool = nullptr;
-		omp_set_num_threads(1);
+	else if ((!multithread))
+		releasePool();
+}
+
+
+template<class _type>
+void ScenarioCache<_type>::releasePool() {
+	delete m_pool;
+	m_pool = nullptr;
+	if (!m_placement.cpu.empty()) {
+		NumaTopology::Instance().Release(m_placement);
+		m_placement.cpu.clear();
+		m_placement.node.clear();
 	}
 }
 
 
 template<class _type>
-ScenarioCache<_type>::~ScenarioCache() {
-	if (m_staticVectorBreaksLL) {
-		std::uint32_t i, cnt = (std::uint32_t)m_staticVectorBreaksLL->size();
-		for (i = 0; i < cnt; i++)
-			delete m_staticVectorBreaksLL->at(i);
-		delete m_staticVectorBreaksLL;
+std::uint32_t AFX_CDECL ScenarioCache<_type>::placeInit(APTR parameter) {
+	placeJob *job = (placeJob *)parameter;
+	std::uint32_t slot = job->next.fetch_add(1);
+	NumaTopology::SetWorkerSlot(slot);
+	if (slot < job->placement->cpu.size())
+		NumaTopology::Pin(job->placement->cpu[slot]);
+	return 1;
+}
+
+
+template<class _type>
+void ScenarioCache<_type>::FirstTouch(void *memory, size_t bytes) const {
+	if ((!m_pool) || (!memory) || (!bytes))
+		return;
+	firstTouchJob job;
+	job.next = 0;
+	job.memory = (unsigned char *)memory;
+	job.bytes = bytes;
+	job.workers = m_numthreads;
+	m_pool->SetJobFunction(firstTouchInit, &job);
+	m_pool->StartJob();
+	m_pool->BlockOnJob();
+}
+
+
+template<class _type>
+std::uint32_t AFX_CDECL ScenarioCache<_type>::firstTouchInit(APTR parameter) {
+	firstTouchJob *job = (firstTouchJob *)parameter;
+	std::uint32_t slot = NumaTopology::WorkerSlot();
+	if (slot >= job->workers)
+		slot = job->next.fetch_add(1) % job->workers;
+	size_t begin = job->bytes * slot / job->workers,
+		end = job->bytes * (slot + 1) / job->workers;
+	memset(job->memory + begin, 0, end - begin);
+	return 1;
+}
+
+
+template<class _type>
+std::uint32_t AFX_CDECL ScenarioCache<_type>::parallelInit(APTR parameter) {
+	parallelJob *job = (parallelJob *)parameter;
+	StepArena::Scope scope(job->arena);
+	while (1) {
+		std::uint32_t begin = job->next.fetch_add(1, std::memory_order_relaxed) * job->chunk;
+		if (begin >= job->count)
+			return 1;
+		job->call(job->fn, begin, (std::min)(begin + job->chunk, job->count));
 	}
+}
+
+
+template<class _type>
+bool ScenarioCache<_type>::runParallel(parallelJob &job) const {
+	if ((!m_pool) || (job.count <= job.chunk))
+		return false;
+	std::unique_lock<std::mutex> lock = AcquirePool();
+	if ((!lock.owns_lock()) || (!m_pool))
+		return false;
+	m_pool->SetJobFunction(parallelInit, &job);
+	m_pool->StartJob();
+	m_pool->BlockOnJob();
+	return true;
+}
+
+
+template<class _type>
+ScenarioCache<_type>::~ScenarioCache() {
 	AssetNode<_type>* an = m_scenario->m_impl->m_assetList.LH_Head();
 	while (an->LN_Succ()) {
 		AssetGeometryNode<_type>* agn;
@@ -636,7 +913,7 @@ ScenarioCache<_type>::~ScenarioCache() {
 	}
 
 	if (m_pool)
-		delete m_pool;
+		releasePool();
 
 	PostCalculation();
 }
@@ -744,8 +1021,92 @@ ICWFGM_Fuel* ScenarioCache<_type>::GetFuel(const WTime& time, const XY_Point& pt
 
 template<class _type>
 ICWFGM_Fuel *ScenarioCache<_type>::GetFuel(const WTime &time, const XYPointType &pt, bool &valid) const {
+	bool nonfuel;
+	return GetFuel(time, pt, valid, nonfuel);
+}
+
 
-	return GetFuel_NotCached(time, pt, valid);
+template<class _type>
+ICWFGM_Fuel *ScenarioCache<_type>::GetFuel(const WTime &time, const XYPointType &pt, bool &valid, bool &nonfuel) const {
+	XY_Point _pt(pt);
+	fromInternal(_pt);
+	return getFuelUTM(time, _pt, valid, nonfuel);
+}
+
+
+template<class _type>
+ICWFGM_Fuel *ScenarioCache<_type>::getFuelUTM(const WTime &time, const XY_Point &pt, bool &valid, bool &nonfuel) const {
+	double ir = (double)ScenarioGridCache<_type>::iresolution();
+	std::int64_t cx = (std::int64_t)floor(pt.x * ir), cy = (std::int64_t)floor(pt.y * ir);
+	fuelTileEntry &e = fuelTile[(cy & (FUEL_TILE - 1)) * FUEL_TILE + (cx & (FUEL_TILE - 1))];
+	std::uint64_t t = time.GetTotalMicroSeconds();
+	if ((e.owner == m_fuelTileOwner) && (e.time == t) &&
+	    (pt.x >= e.bbox.m_min.x) && (pt.x < e.bbox.m_max.x) && (pt.y >= e.bbox.m_min.y) && (pt.y < e.bbox.m_max.y)) {
+		valid = e.valid;
+		nonfuel = e.nonfuel;
+		return e.fuel;
+	}
+
+	HRESULT hr;
+	ICWFGM_Fuel *fuel;
+	XY_Rectangle bbox;
+	bool result;
+	bbox.m_min = bbox.m_max = pt;				// the grid engine fills or adjusts it, if it doesn't then an empty box isn't cached
+	if (FAILED(hr = m_scenario->m_gridEngine->GetFuelData(m_scenario->m_layerThread, pt, time, &fuel, &valid, &bbox)) || (!valid)) {
+		valid = false;
+		nonfuel = true;
+		return nullptr;							// not cached, it may be a transient failure
+	}
+	nonfuel = (!fuel) || (FAILED(hr = fuel->IsNonFuel(&result))) || (result);
+
+	if (bbox.m_min.x < (double)cx / ir)			bbox.m_min.x = (double)cx / ir;		// the slot is for this cell, not the whole box
+	if (bbox.m_min.y < (double)cy / ir)			bbox.m_min.y = (double)cy / ir;
+	if (bbox.m_max.x > (double)(cx + 1) / ir)	bbox.m_max.x = (double)(cx + 1) / ir;
+	if (bbox.m_max.y > (double)(cy + 1) / ir)	bbox.m_max.y = (double)(cy + 1) / ir;
+	if ((bbox.m_max.x <= bbox.m_min.x) || (bbox.m_max.y <= bbox.m_min.y))
+		return fuel;
+
+	e.owner = m_fuelTileOwner;
+	e.time = t;
+	e.bbox = bbox;
+	e.fuel = fuel;
+	e.valid = valid;
+	e.nonfuel = nonfuel;
+	return fuel;
+}
+
+
+template<class _type>
+HRESULT ScenarioCache<_type>::GetWeatherUTM(const WTime &time, const XY_Point &pt, std::uint64_t interpolate, IWXData *wx, IFWIData *ifwi, DFWIData *dfwi, bool *wx_valid) const {
+	if (interpolate & (1ull << CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_SPATIAL))
+		return m_scenario->m_gridEngine->GetWeatherData(m_scenario->m_layerThread, pt, time, interpolate, wx, ifwi, dfwi, wx_valid, nullptr);
+
+	double ir = (double)ScenarioGridCache<_type>::iresolution();
+	weather_key key;
+	key.cx = (std::int64_t)floor(pt.x * ir);
+	key.cy = (std::int64_t)floor(pt.y * ir);
+	key.time = time.GetTotalMicroSeconds();
+	key.interpolate = interpolate;
+
+	weather_value value;
+	if ((m_weatherCache.Retrieve(&key, &value)) &&
+	    (pt.x >= value.bbox.m_min.x) && (pt.x < value.bbox.m_max.x) && (pt.y >= value.bbox.m_min.y) && (pt.y < value.bbox.m_max.y)) {
+		*wx = value.wx;
+		*ifwi = value.ifwi;
+		*dfwi = value.dfwi;
+		*wx_valid = true;
+		return S_OK;
+	}
+
+	value.bbox.m_min = value.bbox.m_max = pt;		// in case the grid engine doesn't fill it in, an empty box never matches
+	HRESULT hr = m_scenario->m_gridEngine->GetWeatherData(m_scenario->m_layerThread, pt, time, interpolate, wx, ifwi, dfwi, wx_valid, &value.bbox);
+	if (SUCCEEDED(hr) && (*wx_valid) && (value.bbox.m_max.x > value.bbox.m_min.x) && (value.bbox.m_max.y > value.bbox.m_min.y)) {
+		value.wx = *wx;								// failures aren't cached, they may be transient
+		value.ifwi = *ifwi;
+		value.dfwi = *dfwi;
+		m_weatherCache.Store(&key, &value);
+	}
+	return hr;
 }
 
 
@@ -805,18 +1166,18 @@ bool ScenarioCache<_type>::isNonFuelUTM_NotCached(const WTime& time, const XYPoi
 
 template<class _type>
 bool ScenarioCache<_type>::IsNonFuel(const WTime& time, const XYPointType& pt, bool& valid) const {
-	XY_Point _pt(pt);
-	fromInternal(_pt);
-
-	return isNonFuelUTM_NotCached(time, _pt, valid, nullptr);
-
+	bool nonfuel;
+	GetFuel(time, pt, valid, nonfuel);
+	return nonfuel;
 }
 
 
 template<class _type>
 bool ScenarioCache<_type>::IsNonFuelUTM(const WTime& time, const XYPointType& _pt, bool& valid) const {
-
-	return isNonFuelUTM_NotCached(time, _pt, valid, nullptr);
+	bool nonfuel;
+	XY_Point pt(_pt);
+	getFuelUTM(time, pt, valid, nonfuel);
+	return nonfuel;
 }
 
 
@@ -828,10 +1189,11 @@ std::uint32_t ScenarioCache<_type>::AssetCount() const {
 
 template<class _type>
 void ScenarioCache<_type>::buildStaticVectorBreaks() {
-	if (m_staticVectorBreaksLL)
+	if (m_landscape)
 		return;
 
-	m_staticVectorBreaksLL = new std::vector<XY_PolyLLSetBB<_type>*>();
+	m_landscape = std::make_shared<ScenarioLandscape<_type>>();
+	landscapeKey(*m_landscape);
 
 	VectorEngineNode *ven = m_scenario->m_vectorEngineList.LH_Head();
 	while (ven->LN_Succ()) {
@@ -869,6 +1231,7 @@ void ScenarioCache<_type>::buildStaticVectorBreaks() {
 									poly_ll->AddPoint(n);
 								}
 
+								poly_ll->m_index = m_landscape->m_staticVectorBreakPolys++;
 								poly_ll->m_publicFlags = XY_PolyLLTimed<_type>::Flags::INTERPRET_POLYGON;
 								poly_ll->CleanPoly(0.0, XY_PolyLLTimed<_type>::Flags::INTERPRET_POLYGON);
 								poly_ll->EnableCaching(true);
@@ -888,7 +1251,7 @@ void ScenarioCache<_type>::buildStaticVectorBreaks() {
 
 								weak_assert(poly_set->NumPolys());
 								poly_set->RescanRanges(false, m_multithread);
-								m_staticVectorBreaksLL->push_back(poly_set);
+								m_landscape->m_staticVectorBreaks.push_back(poly_set);
 							}
 						}
 					}
@@ -897,6 +1260,7 @@ void ScenarioCache<_type>::buildStaticVectorBreaks() {
 		}
 		ven = ven->LN_Succ();
 	}
+	m_staticVectorBreakUsed.assign(m_landscape->m_staticVectorBreakPolys, WTime((std::uint64_t)0, nullptr));
 }
 
 template<class _type>
@@ -905,10 +1269,39 @@ void ScenarioCache<_type>::buildAssets() {
 		return;
 
 	m_assets = true;
+	if (!m_landscape)
+		buildStaticVectorBreaks();
+	const bool share = m_landscape->m_assetsBuilt;	// else we're building the landscape, so record what we build for any other scenarios
+
 	AssetNode<_type>* ven = m_scenario->m_impl->m_assetList.LH_Head();
 	while (ven->LN_Succ()) {
 		std::uint32_t size, num, br_size, i;
 
+		if (share) {
+			const typename ScenarioLandscape<_type>::AssetGeometry *ag = m_landscape->Asset(ven->m_asset.get());
+			if (ag) {
+				for (auto geometry : ag->geometry) {
+					AssetGeometryNode<_type>* agn = new AssetGeometryNode<_type>(m_scenario->m_timeManager);
+					XYPolyNodeType* n = geometry->LH_Head();
+					while (n->LN_Succ()) {
+						XYPolyNodeType* nn = agn->m_geometry.New();
+						nn->x = n->x;
+						nn->y = n->y;
+						agn->m_geometry.AddPoint(nn);
+						n = n->LN_Succ();
+					}
+					agn->m_geometry.m_publicFlags = geometry->m_publicFlags;
+					agn->m_geometry.RescanRanges(false);
+					ven->m_geometry.AddTail(agn);
+				}
+				ven = ven->LN_Succ();
+				continue;
+			}
+		}
+
+		typename ScenarioLandscape<_type>::AssetGeometry ag;
+		ag.asset = ven->m_asset.get();
+
 		XY_PolyLLSetBB<_type> poly_set;
 		WTime zero((std::uint64_t)0, m_scenario->m_timeManager);
 		if (SUCCEEDED(ven->m_asset->GetAssetCount(zero, &num)) && (num)) {
@@ -957,28 +1350,102 @@ void ScenarioCache<_type>::buildAssets() {
 								}
 								agn->m_geometry.RescanRanges(false);
 								ven->m_geometry.AddTail(agn);
+								if (!share)
+									ag.geometry.push_back(new XYPolyLLType(agn->m_geometry));
 							}
 						}
 					}
 				}
 			}
 		}
+		if (!share)
+			m_landscape->m_assets.push_back(std::move(ag));
+		ven = ven->LN_Succ();
+	}
+	m_landscape->m_assetsBuilt = true;
+}
+
+
+template<class _type>
+void ScenarioCache<_type>::landscapeKey(ScenarioLandscape<_type> &landscape) const {
+	landscape.m_ll = start_ll();
+	landscape.m_resolution = resolution();
+	landscape.m_scaling = m_scenario->m_optionFlags & ((1ull << CWFGM_SCENARIO_OPTION_FALSE_ORIGIN) | (1ull << CWFGM_SCENARIO_OPTION_FALSE_SCALING));
+	landscape.m_vectorEngines.clear();
+	VectorEngineNode *ven = m_scenario->m_vectorEngineList.LH_Head();
+	while (ven->LN_Succ()) {
+		landscape.m_vectorEngines.push_back(ven->m_vectorEngine.get());
 		ven = ven->LN_Succ();
 	}
 }
 
 
+template<class _type>
+bool ScenarioCache<_type>::landscapeMatches(const ScenarioLandscape<_type> &landscape) const {
+	ScenarioLandscape<_type> key;
+	landscapeKey(key);
+	return (key.m_ll == landscape.m_ll) &&
+		(key.m_resolution == landscape.m_resolution) &&
+		(key.m_scaling == landscape.m_scaling) &&
+		(key.m_vectorEngines == landscape.m_vectorEngines);
+}
+
+
+template<class _type>
+std::shared_ptr<ScenarioLandscape<_type>> ScenarioCache<_type>::BuildLandscape() {
+	if (!m_landscape)
+		buildStaticVectorBreaks();
+	buildAssets();
+	return m_landscape;
+}
+
+
+template<class _type>
+bool ScenarioCache<_type>::ShareLandscape(const std::shared_ptr<ScenarioLandscape<_type>> &landscape) {
+	if ((m_landscape) || (m_assets))				// too late, this scenario has already built its own
+		return false;
+	if ((!landscape) || (!landscape->m_assetsBuilt))
+		return false;
+	if (!landscapeMatches(*landscape))
+		return false;
+
+	m_landscape = landscape;
+	m_staticVectorBreakUsed.assign(m_landscape->m_staticVectorBreakPolys, WTime((std::uint64_t)0, nullptr));
+	return true;
+}
+
+
+template<class _type>
+ScenarioLandscape<_type>::~ScenarioLandscape() {
+	for (auto vb : m_staticVectorBreaks)
+		delete vb;
+	for (auto& a : m_assets)
+		for (auto g : a.geometry)
+			delete g;
+}
+
+
+template<class _type>
+const typename ScenarioLandscape<_type>::AssetGeometry *ScenarioLandscape<_type>::Asset(const ICWFGM_Asset *asset) const {
+	for (auto& a : m_assets)
+		if (a.asset == asset)
+			return &a;
+	return nullptr;
+}
+
+
 template<class _type>
 bool ScenarioCache<_type>::CanBurn(const WTime &datetime, const XYPointType& centroid, const XYPointType &pt, const double rh, const double WindSpeed, const double fwi, const double isi) {
 	WTimeSpan dayportion = datetime.GetTimeOfDay(WTIME_FORMAT_AS_LOCAL | WTIME_FORMAT_WITHDST);
 	WTimeSpan start, end;
 
-	int _cb_exit = 0; /* track which gate fires */
+	auto gate = [&](int result) {			// > 0 means it can burn, the value identifies which test decided it
+		SCENARIO_TRACE_VERTEX(ScenarioTraceEvent::CAN_BURN, this, nullptr, (double)datetime.GetTotalSeconds(), (double)result, rh, fwi);
+		return result > 0;
+	};
 
-	if (!CanBurnTime(datetime, centroid, start, end)) {
-		_cb_exit = 1; /* no burn time defined → allow */
-		goto _cb_log;
-	}
+	if (!CanBurnTime(datetime, centroid, start, end))
+		return gate(1);
 
 	if (end > start) {
 		if (dayportion < start) {
@@ -987,33 +1454,24 @@ bool ScenarioCache<_type>::CanBurn(const WTime &datetime, const XYPointType& cen
 				if (p_end >= p_start) {
 					if (p_end >= WTimeSpan(1, 0, 0, 0)) {
 						p_end -= WTimeSpan(1, 0, 0, 0);
-						if (dayportion > p_end) {
-							_cb_exit = 2;
-							goto _cb_log;
-						}
+						if (dayportion > p_end)
+							return gate(2);
 					}
 				}
 			}
-			_cb_exit = -2; /* before start, no prev-day wrap */
-			goto _cb_log;
+			return gate(-2);
 		}
 
 		if ((dayportion.GetMinutes() == 59) && (dayportion.GetSeconds() == 59)) {
-			if (dayportion > end) {
-				_cb_exit = -3;
-				goto _cb_log;
-			}
+			if (dayportion > end)
+				return gate(-3);
 		} else {
-			if (dayportion >= end) {
-				_cb_exit = -3; /* past end of burn window */
-				goto _cb_log;
-			}
+			if (dayportion >= end)
+				return gate(-3);
 		}
 	}
-	else if (start != WTimeSpan(0L)) {
-		_cb_exit = -4; /* start!=0 but end<=start */
-		goto _cb_log;
-	}
+	else if (start != WTimeSpan(0L))
+		return gate(-4);
 
 	{
 		XY_Point _pt(pt);
@@ -1026,77 +1484,37 @@ bool ScenarioCache<_type>::CanBurn(const WTime &datetime, const XYPointType& cen
 			if (variantToDouble(value, &min_rh)) {
 				weak_assert(min_rh >= 0.0);
 				weak_assert(min_rh <= 1.0);
-				if (rh > min_rh) {
-					_cb_exit = -5; /* RH too high */
-					goto _cb_log;
-				}
+				if (rh > min_rh)
+					return gate(-5);
 			}
 		}
 
 		if (SUCCEEDED(hr = m_scenario->m_gridEngine->GetAttributeData(m_scenario->m_layerThread, _pt, datetime, WTimeSpan(0), CWFGM_GRID_ATTRIBUTE_BURNINGCONDITION_MAX_WS, 0, &value, &value_valid, nullptr)) && (value_valid != grid::AttributeValue::NOT_SET)) {
 			double max_ws;
 			if (variantToDouble(value, &max_ws)) {
-				if (WindSpeed < max_ws) {
-					_cb_exit = -6; /* wind too low */
-					goto _cb_log;
-				}
+				if (WindSpeed < max_ws)
+					return gate(-6);
 			}
 		}
 
 		if (SUCCEEDED(hr = m_scenario->m_gridEngine->GetAttributeData(m_scenario->m_layerThread, _pt, datetime, WTimeSpan(0), CWFGM_GRID_ATTRIBUTE_BURNINGCONDITION_MIN_FWI, 0, &value, &value_valid, nullptr)) && (value_valid != grid::AttributeValue::NOT_SET)) {
 			double min_fwi;
 			if (variantToDouble(value, &min_fwi)) {
-				if (fwi < min_fwi) {
-					_cb_exit = -7; /* FWI too low */
-					{ static int _ff=0; if(_ff<3){_ff++;
-					  fprintf(stderr,"[CB-FWI-FAIL] fwi=%.6f < min_fwi=%.6f\n",fwi,min_fwi);fflush(stderr);}}
-					goto _cb_log;
-				}
+				if (fwi < min_fwi)
+					return gate(-7);
 			}
 		}
 
 		if (SUCCEEDED(hr = m_scenario->m_gridEngine->GetAttributeData(m_scenario->m_layerThread, _pt, datetime, WTimeSpan(0), CWFGM_GRID_ATTRIBUTE_BURNINGCONDITION_MIN_ISI, 0, &value, &value_valid, nullptr)) && (value_valid != grid::AttributeValue::NOT_SET)) {
 			double min_isi;
 			if (variantToDouble(value, &min_isi)) {
-				if (isi < min_isi) {
-					_cb_exit = -8; /* ISI too low */
-					goto _cb_log;
-				}
+				if (isi < min_isi)
+					return gate(-8);
 			}
 		}
 	}
 
-	_cb_exit = 10; /* all checks passed */
-
-_cb_log:
-	{
-		/* Per-scenario logging: track 3 scenario pointers, log 5 per scenario */
-		void* _sid = (void*)this;
-		static void* _sid_log[3] = {};
-		static int _cb_yes_sc[3] = {}, _cb_no_sc[3] = {};
-		int _si = -1;
-		for (int i=0;i<3;i++) { if(_sid_log[i]==_sid){_si=i;break;} if(!_sid_log[i]){_sid_log[i]=_sid;_si=i;break;} }
-		bool result = (_cb_exit > 0);
-		if (_si >= 0 && result && _cb_yes_sc[_si] < 3) {
-			_cb_yes_sc[_si]++;
-			fprintf(stderr, "[CB-YES sc=%p] exit=%d t=%lld day=%lld rh=%.6f fwi=%.4f isi=%.4f\n",
-				_sid, _cb_exit,
-				(long long)datetime.GetTotalSeconds(),
-				(long long)dayportion.GetTotalSeconds(),
-				rh, fwi, isi);
-			fflush(stderr);
-		}
-		if (_si >= 0 && !result && _cb_no_sc[_si] < 3) {
-			_cb_no_sc[_si]++;
-			fprintf(stderr, "[CB-NO sc=%p] exit=%d t=%lld day=%lld rh=%.6f fwi=%.4f isi=%.4f\n",
-				_sid, _cb_exit,
-				(long long)datetime.GetTotalSeconds(),
-				(long long)dayportion.GetTotalSeconds(),
-				rh, fwi, isi);
-			fflush(stderr);
-		}
-		return result;
-	}
+	return gate(10);
 }
 
 
@@ -37,7 +37,9 @@
 #include "excel_tinv.h"
 #include "gdalclient.h"
 #include "CWFGM_Scenario_Internal.h"
-#include <omp.h>
+#include "ScenarioTrace.h"
+#include "ScenarioSpill.h"
+#include <algorithm>
 
 #ifdef __GNUC__
 #define BOOST_CHRONO_HEADER_ONLY
@@ -120,13 +122,28 @@ void ActiveFire<_type>::Detach() {
 template<class _type>
 Scenario<_type>::Scenario(CCWFGM_Scenario *scenario, const XY_Point &start_ll, const XY_Point &start_ur, const _type resolution, const double landscapeFMC, const double landscapeElev)
     : ScenarioCache<_type>(scenario, start_ll, start_ur, resolution, landscapeFMC, landscapeElev, scenario->m_threadingNumProcessors),
-    m_closestcache(scenario->m_threadingNumProcessors << 1) {
+    m_closestcache(scenario->m_closestCacheSize, (scenario->m_threadingNumProcessors + 1) >> 1) {	// a shard for every pair of threads
 	m_stepState = S_OK;
+	m_spillTail = nullptr;
+	m_spillHolds = 0;
+	m_spillPressure = false;
+	m_delaunayCache = nullptr;
 
 	m_omp_gvs_array = nullptr;
 	m_omp_gps_array = nullptr;
+	m_omp_terrain_array = nullptr;
+	m_omp_gts_array = nullptr;
 	m_omp_gvs_array_size = 0;
 	m_omp_gps_array_size = 0;
+	m_omp_terrain_array_size = 0;
+	m_omp_gts_array_size = 0;
+
+	std::uint32_t queue_up = scenario->m_queueUp;
+	if ((!(scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_SPATIAL))) && (queue_up > 1))
+		queue_up >>= 1;										// cheaper vertices without spatial interpolation
+	m_statsTuner.Reset(queue_up, queue_up, scenario->m_queueUpCalibrate);
+	m_gridTuner.Reset(scenario->m_queueUpGrid, scenario->m_queueUpGrid, scenario->m_queueUpCalibrate);
+	m_vectorTuner.Reset(scenario->m_queueUpVector, scenario->m_queueUpVector, scenario->m_queueUpCalibrate);
 
 	if (scenario->m_growthPercentile >= 0.0) {
 		m_tinv = tinv(scenario->m_growthPercentile / 100.0, 9999999);
@@ -147,6 +164,9 @@ Scenario<_type>::~Scenario() {
 
 	if (m_omp_gvs_array)	free(m_omp_gvs_array);
 	if (m_omp_gps_array)	free(m_omp_gps_array);
+	if (m_omp_terrain_array)	free(m_omp_terrain_array);
+	if (m_omp_gts_array)	free(m_omp_gts_array);
+	delaunayInvalidate(true);
 }
 
 
@@ -161,6 +181,8 @@ template<class _type>
 HRESULT Scenario<_type>::Step() {
 
 	CRWThreadSemaphoreEngage _semaphore_engageS(m_stepLock, SEM_TRUE);
+	m_llLock.Lock_Write();						// a query spilling steps again only does so when no step is running, so wait out one that
+	m_llLock.Unlock();							// saw m_stepLock free just before we took it
 
 	XYRectangleType bbox;
 
@@ -239,45 +261,26 @@ HRESULT Scenario<_type>::Step() {
 		step_completion = m_scenario->m_startTime;		// step_completion now has the time at which this step will be at when it's done
 	}
 
-	// https://stackoverflow.com/questions/24862488/thread-affinity-with-windows-msvc-and-openmp
-	//set the thread affinity and priority
-	if (m_timeSteps.IsEmpty()) {
-		if (ScenarioCache<_type>::m_multithread) {
-			int thread_id = (m_scenario->m_optionFlags & (1ull << (CWFGM_SCENARIO_OPTION_FORCE_AFFINITY))) ? -1 : -2;
-			#pragma omp parallel for num_threads(ScenarioGridCache<_type>::m_scenario->m_threadingNumProcessors) firstprivate(thread_id)
-			for (int i = 0; i < (m_scenario->m_threadingNumProcessors); i++)
-			{
-#ifdef _MSC_VER
-				if (thread_id == -1) {
-					thread_id = omp_get_thread_num();
-					CWorkerThread::native_handle_type thread = CWorkerThreadPool::GetCurrentThread();
-					CWorkerThreadPool::SetThreadAffinityToMask(thread, thread_id);
-					SetThreadPriority(thread, THREAD_PRIORITY_BELOW_NORMAL);
-				}
-#else
-				if (ScenarioGridCache<_type>::m_scenario->m_optionFlags & (1ull << (CWFGM_SCENARIO_OPTION_FORCE_AFFINITY)))
-				{
-					//set the affinity for the current thread
-					cpu_set_t cpuset;
-					CPU_ZERO(&cpuset);
-					CPU_SET(omp_get_thread_num(), &cpuset);
-					pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
-				}
-
-				//lookup the minimum possible priority for the current scheduling policy
-				pthread_attr_t attr;
-				int policy = 0;
-				pthread_attr_init(&attr);
-				pthread_attr_getschedpolicy(&attr, &policy);
-				int lowestPrio = sched_get_priority_min(policy);
-				pthread_attr_destroy(&attr);
-
-				//set the thread priority to the lowest possible value
-				pthread_setschedprio(pthread_self(), lowestPrio);
-#endif
-			}
-		}
-	}
+	ScenarioStepPhaseMetrics phaseMetrics;
+	std::uint64_t phaseTicks, phaseClips;
+	std::chrono::time_point<std::chrono::system_clock> phaseStart;
+
+	auto phase_begin = [&]() {
+		phaseClips = (std::uint64_t)sts->m_advanceMetrics.numInvocations + (std::uint64_t)sts->m_setMetrics.numInvocations;
+		phaseStart = std::chrono::system_clock::now();
+		phaseTicks = GetProcessTickCount();
+	};
+	auto phase_end = [&](ScenarioStepPhase phase) {
+		const std::uint16_t p = (std::uint16_t)phase;
+		phaseMetrics.ticks[p] += GetProcessTickCount() - phaseTicks;
+		phaseMetrics.realtime[p] += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - phaseStart).count();
+		std::uint64_t points, fronts, clips;
+		sts->PhaseCounts(points, fronts, clips);
+		phaseMetrics.points[p] += points;
+		phaseMetrics.fronts[p] += fronts;
+		phaseMetrics.clips[p] += clips - phaseClips;
+		SCENARIO_TRACE_STEP(ScenarioTraceEvent::PHASE, this, sts, p, (double)points, (double)fronts, (double)(clips - phaseClips));
+	};
 
 	sts = nullptr;
 	do {
@@ -323,117 +326,52 @@ HRESULT Scenario<_type>::Step() {
 		m_llLock.Lock_Write();
 		sts = new ScenarioTimeStep<_type>(this, step_completion, (step_completion == m_scenario->m_endTime));	// this appends itself to the list of time steps and calculates what it's time
 		m_llLock.Unlock();
+		StepArena::Scope arena(&sts->m_arena);	// fronts and vertices made through the rest of this iteration belong to this step
 
 #if (!defined(_NO_MFC)) || (!defined(_MSC_VER))
 		sts->m_memoryBegin = used;				// should be, all automatically
 #endif
 
-		/* ── Pipeline vertex count trace (per-fire, with transition detection) ── */
-		static int _pipe_step = 0;  /* timestep counter */
-		static std::uint32_t _prev_npts[16] = {};  /* previous npts per fire index */
-		auto _dump_npts = [&](const char* stage) {
-			static int _pipe_call = 0;
-			if (_pipe_call >= 1000) return;
-			ScenarioFire<_type> *_sf = sts->m_fires.LH_Head();
-			int _fi = 0;
-			while (_sf->LN_Succ()) {
-				FireFront<_type> *_ff = _sf->LH_Head();
-				std::uint32_t _total = 0;
-				int _nff = 0;
-				while (_ff->LN_Succ()) { _total += _ff->NumPoints(); _nff++; _ff = _ff->LN_Succ(); }
-				/* Always log for all fires — delta detection highlights changes */
-				int _delta = (int)_total - (int)_prev_npts[_fi < 16 ? _fi : 0];
-				fprintf(stderr, "[PIPE#%d step=%d sc=%p] %s fire=%d fronts=%d npts=%u delta=%+d\n",
-					_pipe_call, _pipe_step, (void*)ScenarioCache<_type>::m_scenario, stage, _fi, _nff, _total, _delta);
-				if (_fi < 16) _prev_npts[_fi] = _total;
-				_fi++;
-				_sf = _sf->LN_Succ();
-			}
-			_pipe_call++;
-			fflush(stderr);
-		};
-		_pipe_step++;
-
-		/* ── Per-step vertex coordinate dump with scenario ID ── */
-		void* _sc_ptr = (void*)ScenarioCache<_type>::m_scenario;
-		/* Per-scenario dump flags: index by scenario pointer */
-		static void* _dsc_id[3] = {};
-		static bool _dsc_adv[3] = {}, _dsc_trk[3] = {};
-		int _dsc_i = -1;
-		for(int i=0;i<3;i++){if(_dsc_id[i]==_sc_ptr){_dsc_i=i;break;}if(!_dsc_id[i]){_dsc_id[i]=_sc_ptr;_dsc_i=i;break;}}
-		auto _dump_coords = [&](const char* tag, const char* path, bool& flag) {
-			if (flag) return;
-			ScenarioFire<_type>* _sf = sts->m_fires.LH_Head();
-			while (_sf->LN_Succ()) {
-				FireFront<_type>* _ff = _sf->LH_Head();
-				if (_ff && _ff->LN_Succ()) {
-					std::uint32_t np = _ff->NumPoints();
-					if (np >= 860 && np <= 940) {
-						flag = true;
-						FILE* vf = fopen(path, "w");
-						if (vf) {
-							int vi = 0;
-							auto* n = _ff->LH_Head();
-							while (n->LN_Succ()) {
-								fprintf(vf, "%d %.17g %.17g\n", vi,
-									(double)static_cast<FirePoint<_type>*>(n)->x,
-									(double)static_cast<FirePoint<_type>*>(n)->y);
-								vi++;
-								n = n->LN_Succ();
-							}
-							fclose(vf);
-							fprintf(stderr, "[VTXDUMP sc=%p] %s wrote %d verts to %s\n", _sc_ptr, tag, vi, path);
-							fflush(stderr);
-						}
-						return;
-					}
-				}
-				_sf = _sf->LN_Succ();
-			}
-		};
-
-		/* Set scenario index for poly.cpp Unwind dumps (defined in poly.cpp) */
-		{ extern int g_wise_scenario_idx;
-		  g_wise_scenario_idx = (_dsc_i >= 0) ? _dsc_i : -1; }
-
-		_dump_npts("PRE-ADVANCE");
+		phase_begin();
 		bool advanced = sts->AdvanceFires();
-		_dump_npts("POST-ADVANCE");
-		if (_dsc_i>=0) { char _pa[64]; snprintf(_pa,64,"/tmp/post_advance_sc%d.txt",_dsc_i);
-		  _dump_coords("POST-ADVANCE", _pa, _dsc_adv[_dsc_i]); }
+		phase_end(ScenarioStepPhase::ADVANCE);
 
-		if ((advanced) && ((m_scenario->m_perimeterSpacing != 0.0)))
-			sts->SimplifyFires();
+		phase_begin();
+		if (advanced)
+			sts->SimplifyFires((m_scenario->m_perimeterSpacing != 0.0));	// the time for any fronts it also grid tracks is booked here
 		else
 			sts->SimplifyFiresNull();
-		_dump_npts("POST-SIMPLIFY");
+		phase_end(ScenarioStepPhase::SIMPLIFY);
 
+		phase_begin();
 		if (advanced)
 			sts->TrackFires();
 		else
 			sts->TrackFiresNull();
-		_dump_npts("POST-TRACK");
-		if (_dsc_i>=0) { char _pt[64]; snprintf(_pt,64,"/tmp/post_track_sc%d.txt",_dsc_i);
-		  _dump_coords("POST-TRACK", _pt, _dsc_trk[_dsc_i]); }
+		phase_end(ScenarioStepPhase::TRACK);
 
+		phase_begin();
 		sts->UnWindFires(advanced);
-		_dump_npts("POST-UNWIND");
+		phase_end(ScenarioStepPhase::UNWIND);
 
 		advanced |= sts->AddIgnitions();
-		_dump_npts("POST-IGNITIONS");
 
+		phase_begin();
 		if (advanced)
 			sts->UnOverlapFires();
 		else
 			sts->UnOverlapFiresNull();
-		_dump_npts("POST-UNOVERLAP");
+		phase_end(ScenarioStepPhase::UNOVERLAP);
 
+		phase_begin();
 		if (advanced)
 			sts->AddFirePoints();
-		_dump_npts("POST-ADDPTS");
+		phase_end(ScenarioStepPhase::ADDPOINTS);
 
+		phase_begin();
 		sts->StatsFires();					// this calculates FBP values, then Gwyn's equations for full statics on every
 											// (active) fire vertex
+		phase_end(ScenarioStepPhase::STATS);
 
 		ScenarioFire<_type> *sf = sts->m_fires.LH_Head();		// the other routines above may have actually completely eliminated all fire fronts from a given
 		while (sf->LN_Succ()) {					// ignition - this loop simply does some housekeeping to clean things up (and make sure that the
@@ -464,10 +402,11 @@ HRESULT Scenario<_type>::Step() {
 		sts->PostCalculation();
 		m_closestcache.Clear();
 
-		RecordTimeStep(sts);
-
 		bool make_displayable = false;
-		if (sts->CheckAssets(make_displayable)) {
+		phase_begin();
+		bool asset_done = sts->CheckAssets(make_displayable);
+		phase_end(ScenarioStepPhase::ASSETS);
+		if (asset_done) {
 			retval = SUCCESS_SCENARIO_SIMULATION_COMPLETE_ASSET;
 			sts->m_displayable = 1;
 			break;
@@ -476,7 +415,10 @@ HRESULT Scenario<_type>::Step() {
 			sts->m_displayable = 1;
 
 		HRESULT condition;
-		if (sts->CheckStops(condition)) {
+		phase_begin();
+		bool stopped = sts->CheckStops(condition);
+		phase_end(ScenarioStepPhase::STOPS);
+		if (stopped) {
 			retval = condition;
 			sts->m_displayable = 1;
 			break;
@@ -519,9 +461,21 @@ HRESULT Scenario<_type>::Step() {
 		m_llLock.Unlock();
 	}
 
+	if (sts) {
+		recordSteps();				// only once we know which of this step's steps survive the purge
+		delaunayAppend();
+	}
+
+	if ((sts) && (m_scenario->m_spillSteps)) {
+		m_llLock.Lock_Write();
+		spillSteps();
+		m_llLock.Unlock();
+	}
+
 	if (sts) {
 		weak_assert(sts->m_displayable == 1);				// the last one in a step is always the displayable one
 		sts->RecordActiveFires();
+		sts->m_phaseMetrics = phaseMetrics;
 		sts->m_tickCountStart = tickStart;
 		sts->m_realtimeStart = oleStart;
 		sts->m_realtimeEnd = std::chrono::system_clock::now();
@@ -724,9 +678,12 @@ ScenarioTimeStep<_type>* Scenario<_type>::Purge() {
 	ScenarioTimeStep<_type> *sts = m_timeSteps.LH_Tail();
 	ScenarioTimeStep<_type> *p = sts->LN_Pred(), *pp;
 	while (p->LN_Pred()) {
+		if (p->m_spilled)						// everything from here back was already purged before it was spilled
+			break;
 		p->m_lock.Lock_Write();
 
-		if (p->m_displayable) {
+		if ((p->m_displayable) || (m_spillTargets.find(p->m_time.GetTotalMicroSeconds()) != m_spillTargets.end())) {	// spilled steps link into it by time and number
+
 			pp = p->LN_Pred();
 			p->m_lock.Unlock();
 			p = pp;
@@ -767,6 +724,8 @@ ScenarioTimeStep<_type>* Scenario<_type>::Purge() {
 					sf = sf->LN_Succ();
 				}
 				pp = p->LN_Pred();
+				ForgetTimeStep(p, p->LN_Succ());
+				delaunayInvalidate();
 				m_timeSteps.Remove(p);
 				p->m_lock.Unlock();
 				delete p;
@@ -803,12 +762,18 @@ HRESULT Scenario<_type>::StepBack() {
 	CRWThreadSemaphoreEngage _semaphore_engageS(m_stepLock, SEM_TRUE);
 	CRWThreadSemaphoreEngage _semaphore_engage(m_llLock, SEM_TRUE);
 
+	HRESULT hr = pageIn(WTime((std::uint64_t)0, m_scenario->m_timeManager), 1);	// spilled points refer to the steps we're removing by their times, which will be reused
+	if (FAILED(hr))
+		return hr;
+
 	std::uint16_t remove_display = 0;
 	ScenarioTimeStep<_type> *sts = m_timeSteps.LH_Tail();
 	while (sts->LN_Pred()) {
 		if ((remove_display) || (sts->m_displayable)) {
 			if ((remove_display) && (sts->m_displayable))	// remove only one displayable time step when stepping backwards
 				break;
+			ForgetTimeStep(sts, nullptr);
+			delaunayInvalidate();
 			m_timeSteps.RemTail();
 			delete sts;
 			remove_display++;
@@ -826,6 +791,8 @@ HRESULT Scenario<_type>::StepBack() {
 			delete af;
 		}
 	}
+	if (m_scenario->m_spillSteps)
+		spillSteps();					// back down to what's kept in memory
 	return S_OK;
 }
 
@@ -917,6 +884,9 @@ ScenarioTimeStep<_type>* Scenario<_type>::GetPreviousDisplayStep(ScenarioTimeSte
 
 template<class _type>
 HRESULT Scenario<_type>::GetBurningBox(WTime *time, XYRectangleType &bbox) const {
+	spillHold paged(this, *time);
+	if (FAILED(paged.Result()))
+		return paged.Result();
 	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore *)&m_llLock, SEM_FALSE);
 	ScenarioTimeStep<_type> *sts;
 	HRESULT hr = GetStep(time, &sts, true);
@@ -933,6 +903,9 @@ HRESULT Scenario<_type>::GetBurningBox(WTime *time, XYRectangleType &bbox) const
 
 template<class _type>
 HRESULT Scenario<_type>::PointBurned(const XYPointType &pt, WTime *time, bool *status) const {
+	spillHold paged(this, *time);
+	if (FAILED(paged.Result()))
+		return paged.Result();
 	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore *)&m_llLock, SEM_FALSE);
 	ScenarioTimeStep<_type> *sts;
 	HRESULT hr = GetStep(time, &sts, true);
@@ -942,12 +915,72 @@ HRESULT Scenario<_type>::PointBurned(const XYPointType &pt, WTime *time, bool *s
 		return hr;
 	}
 
+	if (ArrivalBurned(pt, sts, *status))
+		return S_OK;
+
 	CRWThreadSemaphoreEngage _semaphore_engage2(sts->m_lock, SEM_FALSE);
 	*status = sts->PointInArea(pt) ? true : false;
 	return S_OK;
 }
 
 
+template<class _type>
+HRESULT Scenario<_type>::PointsBurned(const std::vector<XYPointType> &pts, WTime *time, std::vector<bool> &status) const {
+	spillHold paged(this, *time);
+	if (FAILED(paged.Result()))
+		return paged.Result();
+	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore *)&m_llLock, SEM_FALSE);
+	ScenarioTimeStep<_type> *sts;
+	HRESULT hr = GetStep(time, &sts, true);
+
+	status.assign(pts.size(), false);
+	if ((!sts) || (pts.empty()))
+		return sts ? S_OK : hr;
+
+	std::vector<std::uint32_t> order;				// the ones the arrival raster can't answer
+	order.reserve(pts.size());
+	for (std::uint32_t i = 0; i < pts.size(); i++) {
+		bool burned;
+		if (ArrivalBurned(pts[i], sts, burned))
+			status[i] = burned;
+		else
+			order.push_back(i);
+	}
+	if (order.empty())
+		return S_OK;
+
+	XYRectangleType bbox;
+	bbox.m_min = bbox.m_max = pts[order[0]];
+	for (auto i : order)
+		bbox.EncompassPoint(pts[i]);
+
+	std::vector<std::uint32_t> key(pts.size());		// Z-order, so neighbouring queries hit the same fires and edges together
+	XYPointType scale(bbox.m_max - bbox.m_min);
+	scale.x = (scale.x > 0.0) ? (65535.0 / scale.x) : 0.0;
+	scale.y = (scale.y > 0.0) ? (65535.0 / scale.y) : 0.0;
+	for (auto i : order) {
+		std::uint32_t x = (std::uint32_t)((pts[i].x - bbox.m_min.x) * scale.x),
+			y = (std::uint32_t)((pts[i].y - bbox.m_min.y) * scale.y), k = 0;
+		for (std::uint32_t b = 0; b < 16; b++)
+			k |= (((x >> b) & 1) << (2 * b)) | (((y >> b) & 1) << (2 * b + 1));
+		key[i] = k;
+	}
+	std::sort(order.begin(), order.end(), [&key](std::uint32_t a, std::uint32_t b) { return key[a] < key[b]; });
+
+	std::vector<XYPointType> sorted;
+	sorted.reserve(order.size());
+	for (auto i : order)
+		sorted.push_back(pts[i]);
+	std::vector<std::uint8_t> inside(order.size());
+
+	CRWThreadSemaphoreEngage _semaphore_engage2(sts->m_lock, SEM_FALSE);
+	sts->PointsInArea(sorted.data(), (std::uint32_t)sorted.size(), inside.data());
+	for (std::uint32_t i = 0; i < order.size(); i++)
+		status[order[i]] = inside[i] ? true : false;
+	return S_OK;
+}
+
+
 template<class _type>
 HRESULT Scenario<_type>::GetNumSteps(std::uint32_t *size) const {
 	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore *)&m_llLock, SEM_FALSE);
@@ -981,6 +1014,9 @@ HRESULT Scenario<_type>::GetStepsArray(std::uint32_t *size, std::vector<WTime> *
 
 template<class _type>
 HRESULT Scenario<_type>::GetNumFires(std::uint32_t *count, WTime *time) const {
+	spillHold paged(this, *time);
+	if (FAILED(paged.Result()))
+		return paged.Result();
 	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore *)&m_llLock, SEM_FALSE);
 	ScenarioTimeStep<_type> *sts;
 	HRESULT hr = GetStep(time, &sts, true);
@@ -997,6 +1033,9 @@ HRESULT Scenario<_type>::GetNumFires(std::uint32_t *count, WTime *time) const {
 
 template<class _type>
 HRESULT Scenario<_type>::GetIgnition(std::uint32_t fire, WTime *time, boost::intrusive_ptr<CCWFGM_Ignition> *ignition) const {
+	spillHold paged(this, *time);
+	if (FAILED(paged.Result()))
+		return paged.Result();
 	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore *)&m_llLock, SEM_FALSE);
 	ScenarioTimeStep<_type> *sts;
 	HRESULT hr = GetStep(time, &sts, true);
@@ -1380,6 +1419,9 @@ template<class _type>
 HRESULT Scenario<_type>::Export(const CCWFGM_Ignition *ignition, WTime *start_time, WTime *end_time, std::uint16_t flags,
 	std::string_view driver_name, const std::string &csProjection, const std::filesystem::path &file_path,
     const ScenarioExportRules &rules, ScenarioTimeStep<_type> *_sts) const {
+	spillHold paged(this, _sts ? _sts->m_time : *start_time);
+	if (FAILED(paged.Result()))
+		return paged.Result();
 	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore *)&m_llLock, SEM_FALSE);
 
 	HRESULT hr;
@@ -1420,21 +1462,6 @@ HRESULT Scenario<_type>::Export(const CCWFGM_Ignition *ignition, WTime *start_ti
 	if (!(m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_FALSE_SCALING)))
 		full_set.SetCacheScale(resolution());
 	full_set.m_rules = &rules;
-	/* Diagnostic: count displayable timesteps */
-	{
-		int _total = 0, _disp = 0, _inrange = 0;
-		for (auto* _s = m_timeSteps.LH_Head(); _s->LN_Succ(); _s = _s->LN_Succ()) {
-			_total++;
-			if (_s->m_displayable) _disp++;
-			if (_s->m_displayable && _s->m_time >= (*start_time) && _s->m_time <= requestedEndTime) _inrange++;
-		}
-		fprintf(stderr, "[EXPORT-DIAG] total_steps=%d displayable=%d in_range=%d "
-			"start=%lld end=%lld\n",
-			_total, _disp, _inrange,
-			(long long)start_time->GetTotalSeconds(),
-			(long long)requestedEndTime.GetTotalSeconds());
-		fflush(stderr);
-	}
 	bool first = true;
 	for (sts = m_timeSteps.LH_Head(); sts->LN_Succ(); sts = sts->LN_Succ()) {
 		if (_sts) {
@@ -1549,33 +1576,16 @@ HRESULT Scenario<_type>::Export(const CCWFGM_Ignition *ignition, WTime *start_ti
 			fromInternal2D(m_origArea);
 			fromInternal1D(m_origDistance);
 
-			{
-				int _fc = 0; auto* _ss = sts->m_fires.LH_Head();
-				while (_ss->LN_Succ()) {
-					int _ffcnt = 0; auto* _ff = _ss->LH_Head();
-					while (_ff->LN_Succ()) {
-						_ffcnt++;
-						bool _skip = ((flags & SCENARIO_EXPORT_SUBSET_EXTERIOR) && (_ff->m_publicFlags & XY_PolyLL_BaseTempl<_type>::Flags::INTERIOR_SPECIFIED));
-						fprintf(stderr, "[EXPORT-FF] t=%lld ff=%p npts=%u interior=%d subset_ext=%d skip=%d\n",
-							(long long)sts->m_time.GetTotalSeconds(), (void*)_ff, _ff->NumPoints(),
-							(int)!!(_ff->m_publicFlags & XY_PolyLL_BaseTempl<_type>::Flags::INTERIOR_SPECIFIED),
-							(int)!!(flags & SCENARIO_EXPORT_SUBSET_EXTERIOR), (int)_skip);
-						_ff = _ff->LN_Succ();
-					}
-					_fc++; _ss = _ss->LN_Succ();
+#if SCENARIO_TRACE_LEVEL >= SCENARIO_TRACE_LEVEL_FRONT
+			for (const ScenarioFire<_type> *sf = sts->m_fires.LH_Head(); sf->LN_Succ(); sf = sf->LN_Succ())
+				for (const FireFront<_type> *ff = sf->LH_Head(); ff->LN_Succ(); ff = ff->LN_Succ()) {
+					const bool interior = (ff->m_publicFlags & XY_PolyLL_BaseTempl<_type>::Flags::INTERIOR_SPECIFIED) ? true : false;
+					SCENARIO_TRACE_FRONT(ScenarioTraceEvent::EXPORT, this, sts, (double)sts->m_time.GetTotalSeconds(), (double)ff->NumPoints(),
+						interior ? 1.0 : 0.0, ((interior) && (flags & SCENARIO_EXPORT_SUBSET_EXTERIOR)) ? 1.0 : 0.0);
 				}
-				if (!_fc)
-					fprintf(stderr, "[EXPORT-STS] sts=%p t=%lld NO FIRES\n",
-						(void*)sts, (long long)sts->m_time.GetTotalSeconds());
-				fflush(stderr);
-			}
-			if (flags & SCENARIO_EXPORT_COMBINE_SET) {
-				int _pre_cnt = 0; for (auto* _p = set.LH_Head(); _p->LN_Succ(); _p = _p->LN_Succ()) _pre_cnt++;
+#endif
+			if (flags & SCENARIO_EXPORT_COMBINE_SET)
 				set.Unwind(false, ScenarioCache<_type>::m_multithread ? true : false, nullptr, nullptr);
-				int _post_cnt = 0; for (auto* _p = set.LH_Head(); _p->LN_Succ(); _p = _p->LN_Succ()) _post_cnt++;
-				fprintf(stderr, "[EXPORT-UW] pre=%d post=%d time=%lld\n", _pre_cnt, _post_cnt, (long long)sts->m_time.GetTotalSeconds());
-				fflush(stderr);
-			}
 
 			if (m_scenario->m_optionFlags & (1ull << CWFGM_SCENARIO_OPTION_FALSE_SCALING))
 				set.SetCacheScale(resolution());
@@ -1743,6 +1753,10 @@ HRESULT Scenario<_type>::BuildCriticalPath(const AssetNode<_type>* node, const A
 	if (!g->m_arrived)
 		return ERROR_SCENARIO_ASSET_NOT_ARRIVED;
 
+	spillHold paged(this, WTime((std::uint64_t)0, m_scenario->m_timeManager));	// the path follows points back to the start of the simulation
+	if (FAILED(paged.Result()))
+		return paged.Result();
+	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore *)&m_llLock, SEM_FALSE);
 	g->BuildCriticalPath(m_scenario->m_timeManager, *polyset, rules);
 
 	CriticalPathPoint *poly = (CriticalPathPoint*)polyset->LH_Head();
@@ -1787,6 +1801,9 @@ HRESULT Scenario<_type>::ExportCriticalPath(const AssetNode<_type>* node, const
 	if (!g->m_arrived)
 		return ERROR_SCENARIO_ASSET_NOT_ARRIVED;
 	}
+	spillHold paged(this, WTime((std::uint64_t)0, m_scenario->m_timeManager));	// once for every path we build
+	if (FAILED(paged.Result()))
+		return paged.Result();
 	PolymorphicAttribute var;
 	HRESULT hr;
 	if (FAILED(hr = m_scenario->m_gridEngine->GetAttribute(nullptr, CWFGM_GRID_ATTRIBUTE_SPATIALREFERENCE, &var)))
@@ -37,6 +37,10 @@
 
 #include <boost/cstdint.hpp>
 #include <boost/multi_array.hpp>
+#include <algorithm>
+#include <future>
+#include <list>
+#include <memory>
 
 
 template<class _type>
@@ -527,6 +531,46 @@ HRESULT Scenario<_type>::getStatsClosestVertex(const XYPointType& pt, WTime *min
 		}
 	}
 
+	if ((!test) && (!only_displayable)) {
+		std::uint16_t i;
+		for (i = 0; i < stat_cnt; i++)
+			if ((stats_array[i] != CWFGM_FIRE_STAT_TIME) && (stats_array[i] != CWFGM_FIRE_STAT_BURNED) && (stats_array[i] != CWFGM_FIRE_STAT_BURNED_CHANGE) &&
+				(stats_array[i] != CWFGM_FIRE_STAT_ROS) && (stats_array[i] != CWFGM_FIRE_STAT_FI) && (stats_array[i] != CWFGM_FIRE_STAT_RAZ))
+				break;
+
+		const ScenarioTimeStep<_type>* closest;
+		_type ros, fi, raz;
+		if ((i == stat_cnt) && (ArrivalClosest(pt, *mintime, *time, closest, ros, fi, raz))) {	// everything asked for is in the arrival raster
+			if (!closest) {
+				for (i = 0; i < stat_cnt; i++)
+					vstats[i] = 0.0;
+				return ERROR_POINT_NOT_IN_FIRE;
+			}
+
+			bool valid;
+			ICWFGM_Fuel* fuel = GetFuel_NotCached(*time, pt, valid);
+			bool result = false;
+			HRESULT hr;
+			if ((!valid) || (!fuel) || (FAILED(hr = fuel->IsNonFuel(&result))) || (result)) {
+				for (i = 0; i < stat_cnt; i++)
+					vstats[i] = 0.0;
+				return S_OK;
+			}
+
+			*time = closest->m_time;
+			for (i = 0; i < stat_cnt; i++) {
+				switch (stats_array[i]) {
+					case CWFGM_FIRE_STAT_TIME:	vstats[i] = closest->m_time.GetDayFractionOfYear(WTIME_FORMAT_AS_LOCAL | WTIME_FORMAT_WITHDST); break;
+					case CWFGM_FIRE_STAT_ROS:	vstats[i] = (double)ros; break;
+					case CWFGM_FIRE_STAT_FI:	vstats[i] = (double)fi; break;
+					case CWFGM_FIRE_STAT_RAZ:	vstats[i] = (double)raz; break;
+					default:					vstats[i] = 1.0; break;		// burned
+				}
+			}
+			return S_OK;
+		}
+	}
+
 	ScenarioTimeStep<_type>* sts = m_timeSteps.LH_Head(), * sts_prev;
 	while (sts->LN_Succ()) {
 		if (((!time->GetTime(0)) || (sts->m_time <= (*time))) && ((!mintime->GetTime(0)) || (sts->m_time > (*mintime)))) {
@@ -877,7 +921,7 @@ RESTART:
 
 
 template<class _type>
-HRESULT Scenario<_type>::getStatsInterpolate(const XY_Point& utmpt, const XYPointType& pt, WTime *mintime, WTime* time, std::uint16_t stat_cnt, USHORT* stats_array, NumericVariant* vstats, const bool only_displayable, const std::uint32_t technique) {
+HRESULT Scenario<_type>::getStatsInterpolate(const XY_Point& utmpt, const XYPointType& pt, WTime *mintime, WTime* time, std::uint16_t stat_cnt, USHORT* stats_array, NumericVariant* vstats, const bool only_displayable, const std::uint32_t technique, const std::vector<delaunayFront> *fronts) {
 	_type stats;
 	bool inside = false;
 
@@ -938,7 +982,7 @@ HRESULT Scenario<_type>::getStatsInterpolate(const XY_Point& utmpt, const XYPoin
 		scale /= 10.0;
 	_del.setScale(scale);
 	
-	buildDelaunay2(*mintime, *time, pt, only_displayable, m_delaunay);
+	buildDelaunay2(*mintime, *time, pt, only_displayable, m_delaunay, fronts);
 
 	if (technique == SCENARIO_XYSTAT_TECHNIQUE_IDW) {
 		interpolate<_type> int_p(stat_cnt);
@@ -1283,6 +1327,15 @@ HRESULT Scenario<_type>::getStatsInterpolate(const XY_Point& utmpt, const XYPoin
 
 template<class _type>
 HRESULT Scenario<_type>::GetStats(const XY_Point& min_utmpt, const XY_Point& max_utmpt, const XYPointType& pt1, const XYPointType& pt2, WTime* mintime, WTime* time, std::uint16_t stat_cnt, std::uint16_t* stats_array, NumericVariant* vstats, bool only_displayable, std::uint32_t technique, std::uint16_t discretize, bool test) {
+	spillHold paged(this, (time->GetTime(0)) ? *mintime : WTime((std::uint64_t)0, m_scenario->m_timeManager));	// the steps after mintime, and the one each of them follows
+	if (FAILED(paged.Result()))
+		return paged.Result();
+	return getStats(min_utmpt, max_utmpt, pt1, pt2, mintime, time, stat_cnt, stats_array, vstats, only_displayable, technique, discretize, test, nullptr);
+}
+
+
+template<class _type>
+HRESULT Scenario<_type>::getStats(const XY_Point& min_utmpt, const XY_Point& max_utmpt, const XYPointType& pt1, const XYPointType& pt2, WTime* mintime, WTime* time, std::uint16_t stat_cnt, std::uint16_t* stats_array, NumericVariant* vstats, bool only_displayable, std::uint32_t technique, std::uint16_t discretize, bool test, const std::vector<delaunayFront> *fronts) {
 	if ((technique & 0x0fffffff) == SCENARIO_XYSTAT_TECHNIQUE_CALCULATE) {
 		XYPointType pt(pt1.PointBetween(pt2));
 		return getStatsCalculate(pt, time, stat_cnt, stats_array, vstats, technique, only_displayable);
@@ -1297,75 +1350,577 @@ HRESULT Scenario<_type>::GetStats(const XY_Point& min_utmpt, const XY_Point& max
 	else {
 		XY_Point utmpt(min_utmpt.PointBetween(max_utmpt));
 		XYPointType pt(pt1.PointBetween(pt2));
-		return getStatsInterpolate(utmpt, pt, mintime, time, stat_cnt, stats_array, vstats, only_displayable, technique);
+		return getStatsInterpolate(utmpt, pt, mintime, time, stat_cnt, stats_array, vstats, only_displayable, technique, fronts);
 	}
 }
 
 
+#define RASTER_BLOCK	16		// cells per side of the blocks handed to each thread, that share one list of nearby fronts
+
+
 template<class _type>
-void Scenario<_type>::buildDelaunay2(const WTime &mintime, const WTime &t, const XYPointType &pt, bool only_displayable, DelaunayType *m_delaunay) {
-	// determine the "radius" of area of interest around our point
+HRESULT Scenario<_type>::GetStatsRaster(const XY_Point &ll, double resolution, std::uint16_t cols, std::uint16_t rows, WTime *mintime, WTime *time, std::uint16_t stat_cnt, std::uint16_t *stats_array, NumericVariant *vstats, std::uint32_t technique, std::uint16_t discretize) {
+	const std::uint32_t t = technique & 0x0fffffff;
+	const bool interpolated = (t != SCENARIO_XYSTAT_TECHNIQUE_CALCULATE) && (t != SCENARIO_XYSTAT_TECHNIQUE_CLOSEST_VERTEX) && (t != SCENARIO_XYSTAT_TECHNIQUE_DISCRETIZE);
+	const std::uint16_t blocks_x = (cols + RASTER_BLOCK - 1) / RASTER_BLOCK, blocks_y = (rows + RASTER_BLOCK - 1) / RASTER_BLOCK;
+	HRESULT hr = S_OK;
+
+	spillHold paged(this, (time->GetTime(0)) ? *mintime : WTime((std::uint64_t)0, m_scenario->m_timeManager));	// once, rather than from every cell
+	if (FAILED(paged.Result()))
+		return paged.Result();
+
+	std::mutex hr_lock;
+	ScenarioCache<_type>::ParallelFor((std::uint32_t)blocks_x * blocks_y, 1, [&](std::uint32_t begin, std::uint32_t end) {
+		for (std::uint32_t block = begin; block < end; block++) {
+			const std::uint16_t c1 = (block % blocks_x) * RASTER_BLOCK, r1 = (block / blocks_x) * RASTER_BLOCK;
+			const std::uint16_t c2 = std::min((std::uint16_t)(c1 + RASTER_BLOCK), cols), r2 = std::min((std::uint16_t)(r1 + RASTER_BLOCK), rows);
+
+			std::vector<delaunayFront> fronts, *pfronts = nullptr;
+			if (interpolated) {
+				XY_Point bmin(ll.x + c1 * resolution, ll.y + r1 * resolution), bmax(ll.x + c2 * resolution, ll.y + r2 * resolution);
+				toInternal(bmin);
+				toInternal(bmax);
+				XYRectangleType area;
+				area.m_min = bmin;
+				area.m_max = bmax;
+				try {
+					delaunayFronts(*mintime, *time, area, false, fronts);
+					pfronts = &fronts;
+				} catch (std::bad_alloc &) {
+				}
+			}
+
+			for (std::uint16_t r = r1; r < r2; r++)
+				for (std::uint16_t c = c1; c < c2; c++) {
+					XY_Point min_utmpt(ll.x + c * resolution, ll.y + r * resolution), max_utmpt(min_utmpt.x + resolution, min_utmpt.y + resolution);
+					XY_Point pt1(min_utmpt), pt2(max_utmpt);
+					toInternal(pt1);
+					toInternal(pt2);
+					WTime mt(*mintime), tt(*time);
+					HRESULT h = getStats(min_utmpt, max_utmpt, pt1, pt2, &mt, &tt, stat_cnt, stats_array, vstats + ((std::size_t)r * cols + c) * stat_cnt, false, technique, discretize, false, pfronts);
+					if ((FAILED(h)) && (h != ERROR_POINT_NOT_IN_FIRE)) {
+						std::lock_guard<std::mutex> guard(hr_lock);
+						if (SUCCEEDED(hr))
+							hr = h;
+					}
+				}
+		}
+	});
+	return hr;
+}
+
+
+#define DELAUNAY_GROW		1.25
+#define DELAUNAY_LOOPS		20
+
+
+#define DELAUNAY_CACHE_BYTES	(128ull * 1024 * 1024)
+#define DELAUNAY_CACHE_CELLS	(4u * 1024 * 1024)
+
+
+template<class _type>
+struct delaunayWindow {								// every vertex buildDelaunay2() could find for one time window, bucketed on a grid so each query
+	using XYPointType = XY_PointTempl<_type>;		// only visits its own neighbourhood instead of every point of every step
+
+	struct vertex {
+		XYPointType pt;
+		FirePoint<_type> *fp;
+		FireFront<_type> *ff;
+		std::uint32_t seq;							// step / fire / front / point order, the order walking the steps finds them in
+		bool use;									// else it only tells buildDelaunay2() that the neighbourhood isn't empty
+	};
+
+	std::uint64_t mintime, time;					// 0 for either is unbounded
+	bool only_displayable;
+	const ScenarioTimeStep<_type> *last;			// newest step gathered
+	std::uint32_t seq;								// for the next vertex gathered
+	std::vector<vertex> vertices;					// sorted by cell
+	std::vector<std::uint32_t> cells;				// first vertex of each cell, plus one past the last
+	XYPointType ll;
+	_type cell, size;
+	std::uint32_t nx, ny;
+
+	bool Contains(const ScenarioTimeStep<_type> *sts) const {
+		std::uint64_t t = sts->m_time.GetTotalMicroSeconds();
+		if ((time) && (t > time))
+			return false;
+		if ((mintime) && (t <= mintime))
+			return false;
+		return (!only_displayable) || (sts->m_displayable);
+	}
+
+	static size_t Count(const ScenarioTimeStep<_type> *sts) {	// the vertices Gather() will add
+		size_t count = 0;
+		const ScenarioFire<_type> *sf = sts->m_fires.LH_Head();
+		while (sf->LN_Succ()) {
+			const FireFront<_type> *ff = sf->LH_Head();
+			while (ff->LN_Succ()) {
+				count += ff->NumPoints();
+				ff = ff->LN_Succ();
+			}
+			sf = sf->LN_Succ();
+		}
+		return count;
+	}
+
+	void Gather(const ScenarioTimeStep<_type> *sts) {
+		const ScenarioFire<_type> *sf = sts->m_fires.LH_Head();
+		while (sf->LN_Succ()) {
+			FireFront<_type> *ff = sf->LH_Head();
+			while (ff->LN_Succ()) {
+				FirePoint<_type> *fp = ff->LH_Head();
+				while (fp->LN_Succ()) {
+					bool use = ((fp->m_prevPoint) && (!fp->Equals(*fp->m_prevPoint))) || ((!fp->m_prevPoint) && (!fp->m_status));
+					vertices.push_back({ *fp, fp, ff, seq++, use });
+					fp = fp->LN_Succ();
+				}
+				ff = ff->LN_Succ();
+			}
+			sf = sf->LN_Succ();
+		}
+		last = sts;
+	}
+
+	void Index() {
+		nx = ny = 0;
+		cells.assign(1, 0);
+		if (vertices.empty())
+			return;
+
+		XYPointType ur(vertices[0].pt);
+		ll = ur;
+		for (const auto &v : vertices) {
+			if (ll.x > v.pt.x)	ll.x = v.pt.x;
+			if (ll.y > v.pt.y)	ll.y = v.pt.y;
+			if (ur.x < v.pt.x)	ur.x = v.pt.x;
+			if (ur.y < v.pt.y)	ur.y = v.pt.y;
+		}
+		cell = size;
+		while (true) {
+			nx = (std::uint32_t)((ur.x - ll.x) / cell) + 1;
+			ny = (std::uint32_t)((ur.y - ll.y) / cell) + 1;
+			if ((std::uint64_t)nx * ny <= DELAUNAY_CACHE_CELLS)
+				break;
+			cell *= 2.0;
+		}
+
+		cells.assign((size_t)nx * ny + 1, 0);
+		for (const auto &v : vertices)
+			cells[cellOf(v.pt) + 1]++;
+		for (size_t i = 1; i < cells.size(); i++)
+			cells[i] += cells[i - 1];
+
+		std::vector<vertex> sorted(vertices.size());
+		std::vector<std::uint32_t> next(cells.begin(), cells.end() - 1);
+		for (const auto &v : vertices)				// stable, so each cell keeps seq order
+			sorted[next[cellOf(v.pt)]++] = v;
+		vertices.swap(sorted);
+	}
+
+	void Query(const XYPointType &pt, _type d, std::vector<const vertex*> &found) const {
+		found.clear();
+		if (!nx)
+			return;
+		std::int64_t x0 = (std::int64_t)floor((pt.x - d - ll.x) / cell), x1 = (std::int64_t)floor((pt.x + d - ll.x) / cell);
+		std::int64_t y0 = (std::int64_t)floor((pt.y - d - ll.y) / cell), y1 = (std::int64_t)floor((pt.y + d - ll.y) / cell);
+		if ((x1 < 0) || (y1 < 0) || (x0 >= nx) || (y0 >= ny))
+			return;
+		if (x0 < 0)		x0 = 0;
+		if (y0 < 0)		y0 = 0;
+		if (x1 >= nx)	x1 = nx - 1;
+		if (y1 >= ny)	y1 = ny - 1;
+
+		_type d2 = d * d;
+		for (std::int64_t y = y0; y <= y1; y++)
+			for (std::int64_t x = x0; x <= x1; x++) {
+				size_t k = (size_t)y * nx + x;
+				for (std::uint32_t i = cells[k]; i < cells[k + 1]; i++)
+					if (vertices[i].pt.DistanceToSquared(pt) <= d2)
+						found.push_back(&vertices[i]);
+			}
+		std::sort(found.begin(), found.end(), [](const vertex *a, const vertex *b) { return a->seq < b->seq; });
+	}
+
+	size_t Bytes() const {
+		return sizeof(*this) + vertices.capacity() * sizeof(vertex) + cells.capacity() * sizeof(std::uint32_t);
+	}
+
+	static size_t Bytes(size_t count) {							// the least a window of count vertices takes
+		return sizeof(delaunayWindow) + count * sizeof(vertex) + 2 * sizeof(std::uint32_t);
+	}
+
+private:
+	size_t cellOf(const XYPointType &pt) const {
+		std::uint32_t x = (std::uint32_t)((pt.x - ll.x) / cell), y = (std::uint32_t)((pt.y - ll.y) / cell);
+		if (x >= nx)	x = nx - 1;
+		if (y >= ny)	y = ny - 1;
+		return (size_t)y * nx + x;
+	}
+};
+
+
+template<class _type>
+class delaunayCache {								// most recently used windows first, bounded by DELAUNAY_CACHE_BYTES
+public:
+	using windowPtr = std::shared_ptr<const delaunayWindow<_type>>;
+
+	delaunayCache() { m_bytes = 0; m_generation = 0; };
+
+	windowPtr Find(std::uint64_t mintime, std::uint64_t time, bool only_displayable, std::uint64_t *generation, std::shared_future<windowPtr> *pending) {
+		CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE);	// on a miss, pending is valid if another thread is already building it, else the caller
+		*generation = m_generation;							// is to, and has to call Built() however that turns out
+		for (auto it = m_windows.begin(); it != m_windows.end(); it++)
+			if (((*it)->mintime == mintime) && ((*it)->time == time) && ((*it)->only_displayable == only_displayable)) {
+				if (it != m_windows.begin())
+					m_windows.splice(m_windows.begin(), m_windows, it);
+				return m_windows.front();
+			}
+		for (auto &b : m_building)
+			if ((b.mintime == mintime) && (b.time == time) && (b.only_displayable == only_displayable)) {
+				*pending = b.result;
+				return nullptr;
+			}
+		m_building.emplace_back();
+		building &b = m_building.back();
+		b.mintime = mintime;
+		b.time = time;
+		b.only_displayable = only_displayable;
+		b.result = b.promise.get_future().share();
+		*pending = std::shared_future<windowPtr>();
+		return nullptr;
+	}
+
+	void Built(std::uint64_t mintime, std::uint64_t time, bool only_displayable, const windowPtr &w) {	// w may be nullptr, for the threads waiting on it to walk the steps
+		CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE);
+		for (auto it = m_building.begin(); it != m_building.end(); it++)
+			if ((it->mintime == mintime) && (it->time == time) && (it->only_displayable == only_displayable)) {
+				it->promise.set_value(w);
+				m_building.erase(it);
+				return;
+			}
+	}
+
+	bool Current(std::uint64_t generation) {
+		CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE);
+		return generation == m_generation;
+	}
+
+	void Store(const std::shared_ptr<delaunayWindow<_type>> &w, std::uint64_t generation) {
+		size_t bytes = w->Bytes();
+		if (bytes > DELAUNAY_CACHE_BYTES)
+			return;
+		CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE);
+		if (generation != m_generation)				// steps were paged in or changed while it was being built
+			return;
+		for (auto &o : m_windows)
+			if ((o->mintime == w->mintime) && (o->time == w->time) && (o->only_displayable == w->only_displayable))
+				return;								// another thread beat us to it
+		m_windows.push_front(w);
+		m_bytes += bytes;
+		evict();
+	}
+
+	void Append(const MinListTempl<ScenarioTimeStep<_type>> &steps) {
+		CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE);
+		m_generation++;
+		for (auto &w : m_windows) {
+			const ScenarioTimeStep<_type> *sts = w->last ? w->last->LN_Succ() : steps.LH_Head();
+			bool grow = false;
+			for (const ScenarioTimeStep<_type> *s = sts; s->LN_Succ(); s = s->LN_Succ())
+				if (w->Contains(s)) {
+					grow = true;
+					break;
+				}
+			if (!grow)
+				continue;
+
+			try {
+				auto n = std::make_shared<delaunayWindow<_type>>(*w);	// queries may still hold the old one
+				for (; sts->LN_Succ(); sts = sts->LN_Succ())
+					if (n->Contains(sts))
+						n->Gather(sts);
+				n->Index();
+				m_bytes += n->Bytes();
+				m_bytes -= w->Bytes();
+				w = n;
+			} catch (std::bad_alloc &) {
+				m_bytes -= w->Bytes();
+				w.reset();
+			}
+		}
+		m_windows.remove(nullptr);
+		evict();
+	}
+
+	void Clear() {
+		CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE);
+		m_generation++;
+		m_windows.clear();
+		m_bytes = 0;
+	}
+
+	void Invalidate(std::uint64_t from, std::uint64_t to) {		// just the windows that may hold a step from 'from' to 'to'
+		CThreadSemaphoreEngage engage(&m_lock, SEM_TRUE);
+		m_generation++;												// a window being built now can't tell which steps it saw
+		for (auto &w : m_windows)
+			if (((!w->time) || (from <= w->time)) && ((!w->mintime) || (to > w->mintime))) {
+				m_bytes -= w->Bytes();
+				w.reset();
+			}
+		m_windows.remove(nullptr);
+	}
+
+private:
+	struct building {
+		std::uint64_t mintime, time;
+		bool only_displayable;
+		std::promise<windowPtr> promise;
+		std::shared_future<windowPtr> result;
+	};
+
+	void evict() {
+		while ((m_bytes > DELAUNAY_CACHE_BYTES) && (m_windows.size())) {
+			m_bytes -= m_windows.back()->Bytes();
+			m_windows.pop_back();
+		}
+	}
+
+	CThreadSemaphore										m_lock;
+	std::list<std::shared_ptr<delaunayWindow<_type>>>		m_windows;
+	std::list<building>										m_building;		// windows a thread is building, for others wanting them to wait on rather than build again
+	size_t													m_bytes;
+	std::uint64_t											m_generation;	// bumped whenever the steps change under the windows
+};
+
+
+template<class _type>
+std::shared_ptr<const delaunayWindow<_type>> Scenario<_type>::delaunayNeighbourhood(const WTime &mintime, const WTime &t, bool only_displayable) const {
+	delaunayCache<_type> *cache = m_delaunayCache.load(std::memory_order_acquire);
+	try {
+		if (!cache) {
+			delaunayCache<_type> *c = new delaunayCache<_type>(), *expected = nullptr;
+			if (m_delaunayCache.compare_exchange_strong(expected, c))
+				cache = c;
+			else {
+				delete c;
+				cache = expected;
+			}
+		}
+
+		std::uint64_t generation;
+		std::uint64_t mt = mintime.GetTime(0) ? mintime.GetTotalMicroSeconds() : 0, tt = t.GetTime(0) ? t.GetTotalMicroSeconds() : 0;
+		std::shared_future<typename delaunayCache<_type>::windowPtr> pending;
+		std::shared_ptr<const delaunayWindow<_type>> found = cache->Find(mt, tt, only_displayable, &generation, &pending);
+		if (found)
+			return found;
+		if (pending.valid())
+			return pending.get();					// the same as the thread building it gets
+
+		struct builder {							// so the threads waiting on us always hear back
+			delaunayCache<_type> *cache;
+			std::uint64_t mt, tt;
+			bool only_displayable;
+			std::shared_ptr<const delaunayWindow<_type>> w;
+			~builder() { cache->Built(mt, tt, only_displayable, w); };
+		} built{ cache, mt, tt, only_displayable, nullptr };
+
+		CRWThreadSemaphore *stepLock = (CRWThreadSemaphore*)&m_stepLock;
+		if (stepLock->CurrentState() < 0)			// a step is part way through, its perimeters may still change
+			return nullptr;
+
+		auto w = std::make_shared<delaunayWindow<_type>>();
+		w->mintime = mt;
+		w->time = tt;
+		w->only_displayable = only_displayable;
+		w->last = nullptr;
+		w->seq = 0;
+		w->size = delaunayRadius() * DELAUNAY_GROW * 2.0;	// most queries are answered on the first pass
+
+		size_t count = 0;
+		ScenarioTimeStep<_type> *sts = m_timeSteps.LH_Head();
+		while (sts->LN_Succ()) {
+			CRWThreadSemaphoreEngage _semaphore_engageT(sts->m_lock, SEM_FALSE);
+			if (w->Contains(sts))
+				count += delaunayWindow<_type>::Count(sts);
+			sts = sts->LN_Succ();
+		}
+		if (delaunayWindow<_type>::Bytes(count) > DELAUNAY_CACHE_BYTES)
+			return nullptr;							// it could never be kept, so walking the steps is cheaper than building it
+		if (!cache->Current(generation))
+			return nullptr;							// and it couldn't be kept either
+
+		w->vertices.reserve(count);
+		sts = m_timeSteps.LH_Head();
+		while (sts->LN_Succ()) {
+			CRWThreadSemaphoreEngage _semaphore_engageT(sts->m_lock, SEM_FALSE);
+			if (w->Contains(sts))
+				w->Gather(sts);
+			sts = sts->LN_Succ();
+		}
+		w->Index();
+		if (stepLock->CurrentState() >= 0)
+			cache->Store(w, generation);
+		built.w = w;
+		return w;
+	} catch (std::bad_alloc &) {
+		return nullptr;								// just walk the steps
+	}
+}
+
+
+template<class _type>
+void Scenario<_type>::delaunayAppend() {
+	delaunayCache<_type> *cache = m_delaunayCache.load(std::memory_order_acquire);
+	if (cache)
+		cache->Append(m_timeSteps);
+}
+
+
+template<class _type>
+void Scenario<_type>::delaunayInvalidate(bool destroy) const {
+	if (destroy) {
+		delaunayCache<_type> *cache = m_delaunayCache.exchange(nullptr);
+		if (cache)
+			delete cache;
+	} else {
+		delaunayCache<_type> *cache = m_delaunayCache.load(std::memory_order_acquire);
+		if (cache)
+			cache->Clear();
+	}
+}
+
+
+template<class _type>
+void Scenario<_type>::delaunayInvalidate(std::uint64_t from, std::uint64_t to) const {
+	delaunayCache<_type> *cache = m_delaunayCache.load(std::memory_order_acquire);
+	if (cache)
+		cache->Invalidate(from, to);
+}
+
+
+template<class _type>
+_type Scenario<_type>::delaunayRadius() const {
 	_type d = max(ScenarioGridCache<_type>::m_scenario->perimeterResolution(0.0), ScenarioGridCache<_type>::m_scenario->spatialThreshold(0.0)) * 2.0;
 	gridToInternal1D(d);
+	return d;
+}
+
+
+template<class _type>
+void Scenario<_type>::delaunayFronts(const WTime &mintime, const WTime &t, const XYRectangleType &area, bool only_displayable, std::vector<delaunayFront> &fronts) const {
+	_type d = delaunayRadius() * pow(DELAUNAY_GROW, DELAUNAY_LOOPS + 1);		// as far as buildDelaunay2() will ever look
+	XYPointType center(area.m_min.PointBetween(area.m_max));
+	d += area.m_min.DistanceTo(area.m_max);
+
+	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore*)&m_llLock, SEM_FALSE);
+	ScenarioTimeStep<_type> *sts = m_timeSteps.LH_Head();
+	while (sts->LN_Succ()) {
+		if (((!t.GetTime(0)) || (sts->m_time <= t)) && ((!mintime.GetTime(0)) || (sts->m_time > mintime))) {
+			CRWThreadSemaphoreEngage _semaphore_engageT(sts->m_lock, SEM_FALSE);
+			if ((!only_displayable) || (sts->m_displayable)) {
+				ScenarioFire<_type> *sf = sts->m_fires.LH_Head();
+				while (sf->LN_Succ()) {
+					FireFront<_type> *fs = sf->LH_Head();
+					while (fs->LN_Succ()) {
+						if (fs->FastCollisionTest(center, d))
+							fronts.push_back({ sts, fs });
+						fs = fs->LN_Succ();
+					}
+					sf = sf->LN_Succ();
+				}
+			}
+		}
+		sts = sts->LN_Succ();
+	}
+}
+
+
+template<class _type>
+void Scenario<_type>::buildDelaunay2(const WTime &mintime, const WTime &t, const XYPointType &pt, bool only_displayable, DelaunayType *m_delaunay, const std::vector<delaunayFront> *fronts) {
+	// determine the "radius" of area of interest around our point
+	_type d = delaunayRadius();
 	std::uint32_t loop_cnt = 0;
 	bool b = false;
 	RefList<XYPolyNodeType, XYPolyRefType> list;
+	std::shared_ptr<const delaunayWindow<_type>> window = delaunayNeighbourhood(mintime, t, only_displayable);
+	std::vector<const typename delaunayWindow<_type>::vertex*> found;
 
 	std::uint32_t vertex_cnt;
 
+	auto corners = [&]() {
+		if (!b) {
+			_type d2 = d*3;
+			XYPointType p1(pt.x-d2, pt.y-d2); FirePoint<_type> f1(p1);
+			XYPointType p2(pt.x+d2, pt.y-d2); FirePoint<_type> f2(p2);
+			XYPointType p3(pt.x-d2, pt.y+d2); FirePoint<_type> f3(p3);
+			XYPointType p4(pt.x+d2, pt.y+d2); FirePoint<_type> f4(p4);
+
+			m_delaunay->InsertPoint(f1, NULL, NULL); // top left
+			m_delaunay->InsertPoint(f2, NULL, NULL); // top right
+			m_delaunay->InsertPoint(f3, NULL, NULL); // bottom left
+			m_delaunay->InsertPoint(f4, NULL, NULL); // bottom right
+			b = true;
+		}
+	};
+
+	auto gather = [&](FireFront<_type> *fs) {
+	//according to tests, this pointSet method gives us optimal results
+		if (fs->FastCollisionTest(pt, d))
+			fs->PointSet(pt, d, true, list, nullptr);
+
+		XYPolyRefType *node;
+		while (node = list.RemHead()) {
+			corners();
+			FirePoint<_type> *fp = (FirePoint<_type>*)node->LN_Ptr();
+			if (((fp->m_prevPoint) && (!fp->Equals(*fp->m_prevPoint))) || ((!fp->m_prevPoint) && (!fp->m_status))) {
+				if (!m_delaunay->GetPoint(*fp)) {
+					m_delaunay->InsertPoint(*fp, fp, fs);
+
+				}
+			}
+			delete node;
+		}
+	};
+
 	do {
 		vertex_cnt = m_delaunay->NumPoints();
-		d *= 1.25;
+		d *= DELAUNAY_GROW;
 		loop_cnt++;
 		m_delaunay->DeletePoints();
 		b = false;
-		ScenarioTimeStep<_type> *sts = m_timeSteps.LH_Head();
-		while (sts->LN_Succ()) {
-			if (((!t.GetTime(0)) || (sts->m_time <= t)) && ((!mintime.GetTime(0)) || (sts->m_time > mintime))) {
-				CRWThreadSemaphoreEngage _semaphore_engageT(sts->m_lock, SEM_FALSE);
-				if ((!only_displayable) || (sts->m_displayable)) {
-					ScenarioFire<_type> *sf = sts->m_fires.LH_Head();
-					while (sf->LN_Succ()) {
-						FireFront<_type> *fs = sf->LH_Head();
-						while (fs->LN_Succ()) {
-						//according to tests, this pointSet method gives us optimal results
-							if (fs->FastCollisionTest(pt, d))
-								fs->PointSet(pt, d, true, list, nullptr);
-
-							XYPolyRefType *node;
-							while (node = list.RemHead()) {
-
-								if (!b) {
-									_type d2 = d*3;
-									XYPointType p1(pt.x-d2, pt.y-d2); FirePoint<_type> f1(p1);
-									XYPointType p2(pt.x+d2, pt.y-d2); FirePoint<_type> f2(p2);
-									XYPointType p3(pt.x-d2, pt.y+d2); FirePoint<_type> f3(p3);
-									XYPointType p4(pt.x+d2, pt.y+d2); FirePoint<_type> f4(p4);
-
-									m_delaunay->InsertPoint(f1, NULL, NULL); // top left
-									m_delaunay->InsertPoint(f2, NULL, NULL); // top right
-									m_delaunay->InsertPoint(f3, NULL, NULL); // bottom left
-									m_delaunay->InsertPoint(f4, NULL, NULL); // bottom right
-									b = true;
-								}
-								FirePoint<_type> *fp = (FirePoint<_type>*)node->LN_Ptr();
-								if (((fp->m_prevPoint) && (!fp->Equals(*fp->m_prevPoint))) || ((!fp->m_prevPoint) && (!fp->m_status))) {
-									if (!m_delaunay->GetPoint(*fp)) {
-										m_delaunay->InsertPoint(*fp, fp, fs);
-
-									}
-								}
-								delete node;
+		if (window) {
+			window->Query(pt, d, found);
+			for (auto v : found) {
+				corners();
+				if ((v->use) && (!m_delaunay->GetPoint(*v->fp)))
+					m_delaunay->InsertPoint(*v->fp, v->fp, v->ff);
+			}
+		} else if (fronts) {						// already narrowed down to this neighbourhood, in the same order as walking the steps
+			for (const auto &f : *fronts) {
+				CRWThreadSemaphoreEngage _semaphore_engageT(f.sts->m_lock, SEM_FALSE);
+				gather(f.ff);
+			}
+		} else {
+			ScenarioTimeStep<_type> *sts = m_timeSteps.LH_Head();
+			while (sts->LN_Succ()) {
+				if (((!t.GetTime(0)) || (sts->m_time <= t)) && ((!mintime.GetTime(0)) || (sts->m_time > mintime))) {
+					CRWThreadSemaphoreEngage _semaphore_engageT(sts->m_lock, SEM_FALSE);
+					if ((!only_displayable) || (sts->m_displayable)) {
+						ScenarioFire<_type> *sf = sts->m_fires.LH_Head();
+						while (sf->LN_Succ()) {
+							FireFront<_type> *fs = sf->LH_Head();
+							while (fs->LN_Succ()) {
+								gather(fs);
+								fs = fs->LN_Succ();
 							}
-							fs = fs->LN_Succ();
+							sf = sf->LN_Succ();
 						}
-						sf = sf->LN_Succ();
 					}
 				}
+				sts = sts->LN_Succ();
 			}
-			sts = sts->LN_Succ();
 		}
-	} while ((loop_cnt <= 20) && ((m_delaunay->NumPoints() < 20) || (m_delaunay->NumPoints() == vertex_cnt)));
+	} while ((loop_cnt <= DELAUNAY_LOOPS) && ((m_delaunay->NumPoints() < 20) || (m_delaunay->NumPoints() == vertex_cnt)));
 }
 
 
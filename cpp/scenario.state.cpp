@@ -0,0 +1,1045 @@
+/**
+ * WISE_Scenario_Growth_Module: scenario.state.cpp
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "google/protobuf/message.h"
+#include "scenario.h"
+#include "ScenarioTimeStep.h"
+#include "ScenarioIgnition.h"
+#include "results.h"
+#include "CWFGM_Scenario_Internal.h"
+#include "ScenarioSpill.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+
+using ProtoState = WISE::FireEngineProto::CwfgmScenarioState;
+using ProtoSpill = WISE::FireEngineProto::CwfgmScenarioSpill;
+
+
+template<class _type>
+static void checkpointPoint(const FirePoint<_type> *fp, ProtoState::FirePoint *p, const std::unordered_map<const void*, std::uint32_t> &points) {
+	p->set_x(fp->x);
+	p->set_y(fp->y);
+	auto it = points.find(fp->m_prevPoint);			// links are only kept to points still in the simulation
+	if (it != points.end())
+		p->set_prevpoint(it->second);
+	it = points.find(fp->m_succPoint);
+	if (it != points.end())
+		p->set_succpoint(it->second);
+	p->set_ellipserosx(fp->m_ellipse_ros.x);
+	p->set_ellipserosy(fp->m_ellipse_ros.y);
+	p->set_raz(fp->m_fbp_raz);
+	p->set_status(fp->m_status);
+	p->set_successfulbreach(fp->m_successful_breach ? true : false);
+	p->set_rsi(fp->m_fbp_rsi);
+	p->set_roseq(fp->m_fbp_roseq);
+	p->set_ros(fp->m_fbp_ros);
+	p->set_bros(fp->m_fbp_bros);
+	p->set_fros(fp->m_fbp_fros);
+	p->set_vectorros(fp->m_vector_ros);
+	p->set_vectorcfb(fp->m_vector_cfb);
+	p->set_vectorcfc(fp->m_vector_cfc);
+	p->set_vectorsfc(fp->m_vector_sfc);
+	p->set_vectortfc(fp->m_vector_tfc);
+	p->set_vectorfi(fp->m_vector_fi);
+	p->set_fi(fp->m_fbp_fi);
+	p->set_cfb(fp->m_fbp_cfb);
+	p->set_rosratio(fp->m_fbp_ros_ratio);
+	p->set_flamelength(fp->m_flameLength);
+}
+
+
+template<class _type>
+static void resumePoint(const ProtoState::FirePoint &p, FirePoint<_type> *fp) {
+	fp->x = static_cast<_type>(p.x());
+	fp->y = static_cast<_type>(p.y());
+	fp->m_ellipse_ros.x = static_cast<_type>(p.ellipserosx());
+	fp->m_ellipse_ros.y = static_cast<_type>(p.ellipserosy());
+	fp->m_fbp_raz = static_cast<_type>(p.raz());
+	fp->m_status = p.status();
+	fp->m_successful_breach = p.successfulbreach() ? 1 : 0;
+	fp->m_fbp_rsi = p.rsi();
+	fp->m_fbp_roseq = p.roseq();
+	fp->m_fbp_ros = p.ros();
+	fp->m_fbp_bros = p.bros();
+	fp->m_fbp_fros = p.fros();
+	fp->m_vector_ros = p.vectorros();
+	fp->m_vector_cfb = p.vectorcfb();
+	fp->m_vector_cfc = p.vectorcfc();
+	fp->m_vector_sfc = p.vectorsfc();
+	fp->m_vector_tfc = p.vectortfc();
+	fp->m_vector_fi = p.vectorfi();
+	fp->m_fbp_fi = p.fi();
+	fp->m_fbp_cfb = p.cfb();
+	fp->m_fbp_ros_ratio = p.rosratio();
+	fp->m_flameLength = p.flamelength();
+}
+
+
+template<class _type>
+static void checkpointActiveFire(const ActiveFire<_type> *af, ProtoState::ActiveFire *a, const std::unordered_map<const void*, std::uint32_t> &fires,
+    const std::unordered_map<const void*, std::uint32_t> &activeFires, std::int32_t fileVersion) {
+	auto it = fires.find(af->LN_Ptr());
+	if (it != fires.end())
+		a->set_fire(it->second);
+	if (af->m_mate_next != af)
+		a->set_mate(activeFires.at(af->m_mate_next));
+	if (af->m_startTime.GetTotalMicroSeconds())
+		a->set_allocated_starttime(HSS_Time::Serialization::TimeSerializer().serializeTime(af->m_startTime, fileVersion));
+	if (af->m_endTime.GetTotalMicroSeconds())
+		a->set_allocated_endtime(HSS_Time::Serialization::TimeSerializer().serializeTime(af->m_endTime, fileVersion));
+	a->set_minx(af->m_boundingBox.m_min.x);
+	a->set_miny(af->m_boundingBox.m_min.y);
+	a->set_maxx(af->m_boundingBox.m_max.x);
+	a->set_maxy(af->m_boundingBox.m_max.y);
+	a->set_advanced(af->m_advanced ? true : false);
+	a->set_calcst(af->m_calc_st);
+}
+
+
+template<class _type>
+HRESULT Scenario<_type>::Checkpoint(std::int32_t fileVersion, const WTime *until, ProtoState *state) const {
+	spillHold paged(this, WTime((std::uint64_t)0, m_scenario->m_timeManager));
+	if (FAILED(paged.Result()))
+		return paged.Result();
+	CRWThreadSemaphoreEngage _semaphore_engageS(*(CRWThreadSemaphore *)&m_stepLock, SEM_FALSE);		// no step is part way through
+	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore *)&m_llLock, SEM_FALSE);
+
+	const ScenarioTimeStep<_type> *last = m_timeSteps.LH_Tail(), *stop = nullptr;
+	if (until) {											// forking, so only up to the display step at that time, and the active fires as
+		while (last->LN_Pred()) {							// they were recorded on it - like RestoreActiveFires() does in StepBack()
+			if ((last->m_displayable) && (last->m_time <= *until))
+				break;
+			last = last->LN_Pred();
+		}
+		if (!last->LN_Pred())
+			return ERROR_FIRE_INVALID_TIME;
+		stop = last->LN_Succ();
+	}
+	const bool forked = (stop) && (stop->LN_Succ());
+
+	std::unordered_map<const void*, std::uint32_t> ignitions, fires, fronts, points, activeFires;
+	std::uint32_t index = 0;
+	const IgnitionNode<_type> *in = m_scenario->m_impl->m_ignitionList.LH_Head();
+	while (in->LN_Succ()) {
+		ignitions[in] = index++;
+		in = in->LN_Succ();
+	}
+
+	ScenarioTimeStep<_type> *sts = m_timeSteps.LH_Head();			// number everything first, points can refer to later steps
+	while ((sts->LN_Succ()) && (sts != stop)) {
+		ScenarioFire<_type> *sf = sts->m_fires.LH_Head();
+		while (sf->LN_Succ()) {
+			fires.emplace(sf, (std::uint32_t)fires.size() + 1);
+			FireFront<_type> *ff = sf->LH_Head();
+			while (ff->LN_Succ()) {
+				fronts.emplace(ff, (std::uint32_t)fronts.size() + 1);
+				FirePoint<_type> *fp = ff->LH_Head();
+				while (fp->LN_Succ()) {
+					points.emplace(fp, (std::uint32_t)points.size() + 1);
+					fp = fp->LN_Succ();
+				}
+				ff = ff->LN_Succ();
+			}
+			sf = sf->LN_Succ();
+		}
+		sts = sts->LN_Succ();
+	}
+	const ActiveFire<_type> *af;
+	if (forked) {											// the fires refer to the live active fires, number them as they were recorded on the step
+		std::unordered_set<const void*> live;
+		af = m_activeFires.LH_Head();
+		while (af->LN_Succ()) {
+			live.insert(af);
+			af = af->LN_Succ();
+		}
+		af = last->m_activeFiresState.LH_Head();
+		while (af->LN_Succ()) {
+			if ((!af->m_master) || (!live.count(af->m_master)) || (!activeFires.emplace(af->m_master, (std::uint32_t)activeFires.size() + 1).second))
+				return ERROR_SCENARIO_BAD_STATE;			// the recording doesn't match the active fires, so we can't tell which fire is which
+			af = af->LN_Succ();
+		}
+	} else {
+		af = m_activeFires.LH_Head();
+		while (af->LN_Succ()) {
+			activeFires.emplace(af, (std::uint32_t)activeFires.size() + 1);
+			af = af->LN_Succ();
+		}
+	}
+
+	try {
+		state->Clear();
+		state->set_version(1);
+		state->set_allocated_starttime(HSS_Time::Serialization::TimeSerializer().serializeTime(m_scenario->m_startTime, fileVersion));
+		state->set_allocated_endtime(HSS_Time::Serialization::TimeSerializer().serializeTime(m_scenario->m_endTime, fileVersion));
+		state->set_ignitioncount((std::uint32_t)ignitions.size());
+		state->set_staticbreakcount(ScenarioCache<_type>::m_landscape ? ScenarioCache<_type>::m_landscape->m_staticVectorBreakPolys : 0);
+		state->set_stepstate(forked ? S_OK : m_stepState);
+
+		sts = m_timeSteps.LH_Head();
+		while ((sts->LN_Succ()) && (sts != stop)) {
+			ProtoState::TimeStep *ts = state->add_timesteps();
+			ts->set_allocated_time(HSS_Time::Serialization::TimeSerializer().serializeTime(sts->m_time, fileVersion));
+			ts->set_displayable(sts->m_displayable ? true : false);
+			ts->set_evented(sts->m_evented ? true : false);
+			ts->set_ignitioned(sts->m_ignitioned ? true : false);
+			ts->set_assetcount(sts->m_assetCount);
+
+			ProtoState::StopConditions *sc = ts->mutable_stopconditions();
+			sc->set_fi90(sts->m_stopConditions.fi90);
+			sc->set_fi95(sts->m_stopConditions.fi95);
+			sc->set_fi100(sts->m_stopConditions.fi100);
+			sc->set_rh(sts->m_stopConditions.RH);
+			sc->set_precip(sts->m_stopConditions.precip);
+			sc->set_area(sts->m_stopConditions.area);
+			sc->set_burndistance(sts->m_stopConditions.burnDistance);
+
+			ScenarioFire<_type> *sf = sts->m_fires.LH_Head();
+			while (sf->LN_Succ()) {
+				ProtoState::Fire *f = ts->add_fires();
+				f->set_ignition(ignitions.at(sf->Ignition()));
+				if (sf->LN_CalcPred()) {
+					auto it = fires.find(sf->LN_CalcPred());
+					if (it != fires.end())
+						f->set_calcpred(it->second);
+				}
+				if (sf->LN_CalcSucc()) {
+					auto it = fires.find(sf->LN_CalcSucc());
+					if (it != fires.end())
+						f->set_calcsucc(it->second);
+				}
+				if (sf->m_activeFire)
+					f->set_activefire(activeFires.at(sf->m_activeFire));
+				f->set_initarea(sf->InitArea());
+				f->set_firearea(sf->m_fireArea);
+				f->set_newvertexstatus(sf->m_newVertexStatus);
+				f->set_canburn(sf->m_canBurn ? true : false);
+				f->set_bits(sf->m_bits);
+				f->set_gusting(sf->m_gusting);
+
+				FireFront<_type> *ff = sf->LH_Head();
+				while (ff->LN_Succ()) {
+					ProtoState::FireFront *front = f->add_fronts();
+					front->set_flags(ff->m_publicFlags);
+					FirePoint<_type> *fp = ff->LH_Head();
+					while (fp->LN_Succ()) {
+						checkpointPoint(fp, front->add_points(), points);
+						fp = fp->LN_Succ();
+					}
+					ff = ff->LN_Succ();
+				}
+				sf = sf->LN_Succ();
+			}
+
+			const ActiveFire<_type> *caf = sts->m_activeFiresState.LH_Head();
+			std::unordered_map<const void*, std::uint32_t> stateFires;
+			while (caf->LN_Succ()) {
+				stateFires.emplace(caf, (std::uint32_t)stateFires.size() + 1);
+				caf = caf->LN_Succ();
+			}
+			caf = sts->m_activeFiresState.LH_Head();
+			while (caf->LN_Succ()) {
+				checkpointActiveFire(caf, ts->add_activefiresstate(), fires, stateFires, fileVersion);
+				caf = caf->LN_Succ();
+			}
+
+			const XY_PolyLLPolyRef<_type> *r = sts->m_staticVectorBreaksLL.LH_Head();
+			while (r->LN_Succ()) {
+				ts->add_staticbreaks(static_cast<const XY_PolyLLTimed<_type>*>(r->LN_Ptr())->m_index);
+				r = r->LN_Succ();
+			}
+
+			ts->set_tickcountstart(sts->m_tickCountStart);
+			ts->set_tickcountend(sts->m_tickCountEnd);
+			ts->set_realtimestart(std::chrono::duration_cast<std::chrono::microseconds>(sts->m_realtimeStart.time_since_epoch()).count());
+			ts->set_realtimeend(std::chrono::duration_cast<std::chrono::microseconds>(sts->m_realtimeEnd.time_since_epoch()).count());
+			ts->set_memorybegin(sts->m_memoryBegin);
+			ts->set_memoryend(sts->m_memoryEnd);
+
+			ProtoState::PhaseMetrics *pm = ts->mutable_phasemetrics();
+			for (std::uint16_t p = 0; p < ScenarioStepPhaseMetrics::NUM_PHASES; p++) {
+				pm->add_ticks(sts->m_phaseMetrics.ticks[p]);
+				pm->add_realtime(sts->m_phaseMetrics.realtime[p]);
+				pm->add_points(sts->m_phaseMetrics.points[p]);
+				pm->add_fronts(sts->m_phaseMetrics.fronts[p]);
+				pm->add_clips(sts->m_phaseMetrics.clips[p]);
+			}
+			sts = sts->LN_Succ();
+		}
+
+		if (forked) {
+			std::unordered_map<const void*, std::uint32_t> recorded;
+			af = last->m_activeFiresState.LH_Head();
+			while (af->LN_Succ()) {
+				recorded.emplace(af, (std::uint32_t)recorded.size() + 1);
+				af = af->LN_Succ();
+			}
+			af = last->m_activeFiresState.LH_Head();
+			while (af->LN_Succ()) {
+				checkpointActiveFire(af, state->add_activefires(), fires, recorded, fileVersion);
+				af = af->LN_Succ();
+			}
+		} else {
+			af = m_activeFires.LH_Head();
+			while (af->LN_Succ()) {
+				checkpointActiveFire(af, state->add_activefires(), fires, activeFires, fileVersion);
+				af = af->LN_Succ();
+			}
+		}
+
+		const std::uint32_t cnt = (std::uint32_t)ScenarioCache<_type>::m_staticVectorBreakUsed.size();
+		for (std::uint32_t i = 0; i < cnt; i++) {
+			const WTime &used = ScenarioCache<_type>::m_staticVectorBreakUsed[i];
+			if ((used.GetTotalMicroSeconds()) && ((!forked) || (used <= last->m_time))) {
+				ProtoState::StaticBreak *sb = state->add_staticbreaks();
+				sb->set_index(i);
+				sb->set_allocated_used(HSS_Time::Serialization::TimeSerializer().serializeTime(used, fileVersion));
+			}
+		}
+
+		const AssetNode<_type> *an = m_scenario->m_impl->m_assetList.LH_Head();
+		while (an->LN_Succ()) {
+			const AssetGeometryNode<_type> *g = an->m_geometry.LH_Head();
+			while (g->LN_Succ()) {
+				ProtoState::AssetGeometry *ag = state->add_assetgeometry();
+				if ((g->m_arrived) && ((!forked) || (g->m_arrivalTime <= last->m_time))) {
+					ag->set_arrived(true);
+					ag->set_allocated_arrivaltime(HSS_Time::Serialization::TimeSerializer().serializeTime(g->m_arrivalTime, fileVersion));
+					auto it = points.find(g->m_closestFirePoint);
+					if (it != points.end()) {
+						checkpointPoint(&g->m_closestPoint, ag->mutable_closestpoint(), points);
+						ag->set_closestfirepoint(it->second);
+						it = fronts.find(g->m_closestFireFront);
+						if (it != fronts.end())
+							ag->set_closestfirefront(it->second);
+					}
+				}
+				g = g->LN_Succ();
+			}
+			an = an->LN_Succ();
+		}
+	} catch (std::bad_alloc &) {
+		state->Clear();
+		return E_OUTOFMEMORY;
+	} catch (std::out_of_range &) {
+		weak_assert(false);							// something refers to an object that isn't in the simulation
+		state->Clear();
+		return ERROR_SCENARIO_BAD_STATE;
+	}
+	return S_OK;
+}
+
+
+template<class _type>
+void Scenario<_type>::clearSteps() {
+	ScenarioTimeStep<_type> *sts;
+	while (sts = m_timeSteps.RemHead())
+		delete sts;
+	ActiveFire<_type> *af;
+	while (af = m_activeFires.RemHead()) {
+		af->Detach();
+		delete af;
+	}
+	for (auto &used : ScenarioCache<_type>::m_staticVectorBreakUsed)
+		used = WTime((std::uint64_t)0, nullptr);
+	m_spill.reset();
+	m_spillTail = nullptr;
+	m_spillPressure = false;
+	m_spillTargets.clear();
+	ClearArrivals();
+	delaunayInvalidate();
+	ClearWeather();
+	m_stepState = S_OK;
+}
+
+
+template<class _type>
+void Scenario<_type>::recordSteps() {
+	ScenarioTimeStep<_type> *sts = const_cast<ScenarioTimeStep<_type>*>(ArrivalTail());
+	sts = sts ? sts->LN_Succ() : m_timeSteps.LH_Head();
+	while (sts->LN_Succ()) {
+		RecordTimeStep(sts);
+		sts = sts->LN_Succ();
+	}
+}
+
+
+template<class _type>
+HRESULT Scenario<_type>::Resume(const ProtoState &state, std::shared_ptr<validation::validation_object> valid, const std::string &name) {
+	CRWThreadSemaphoreEngage _semaphore_engageS(m_stepLock, SEM_TRUE);
+	CRWThreadSemaphoreEngage _semaphore_engage(m_llLock, SEM_TRUE);
+
+	if (m_timeSteps.GetCount())
+		return ERROR_SCENARIO_BAD_STATE;
+
+	auto vt = validation::conditional_make_object(valid, "WISE.FireEngineProto.CwfgmScenarioState", name);
+	auto v = vt.lock();
+
+	if (state.version() != 1) {
+		if (v)
+			/// <summary>
+			/// The object version is not supported. The simulation state is not supported by this version of Prometheus.
+			/// </summary>
+			/// <type>user</type>
+			v->add_child_validation("WISE.FireEngineProto.CwfgmScenarioState", "version", validation::error_level::SEVERE, validation::id::version_mismatch, std::to_string(state.version()));
+		return ERROR_PROTOBUF_OBJECT_VERSION_INVALID;
+	}
+
+	auto invalid = [&](const char *field) {
+		if (v)
+			/// <summary>
+			/// The simulation state doesn't match this scenario, or refers to something that isn't in the state.
+			/// </summary>
+			/// <type>user</type>
+			v->add_child_validation("WISE.FireEngineProto.CwfgmScenarioState", field, validation::error_level::SEVERE, validation::id::object_invalid, "");
+		return ERROR_PROTOBUF_OBJECT_INVALID;
+	};
+	auto toTime = [&](const HSS::Times::WTime &t, const char *field) {
+		auto time = HSS_Time::Serialization::TimeSerializer().deserializeTime(t, m_scenario->m_timeManager, valid, field);
+		WTime result(*time);
+		delete time;
+		return result;
+	};
+
+	if ((!state.has_starttime()) || (toTime(state.starttime(), "startTime") != m_scenario->m_startTime))
+		return invalid("startTime");
+	if ((state.timesteps_size()) && (state.timesteps(state.timesteps_size() - 1).has_time()) &&
+	    (toTime(state.timesteps(state.timesteps_size() - 1).time(), "timeSteps.time") > m_scenario->m_endTime))
+		return invalid("endTime");						// the end time may change, so long as the state doesn't go past it
+
+	std::vector<IgnitionNode<_type>*> ignitions;
+	IgnitionNode<_type> *in = m_scenario->m_impl->m_ignitionList.LH_Head();
+	while (in->LN_Succ()) {
+		ignitions.push_back(in);
+		in = in->LN_Succ();
+	}
+	if (state.ignitioncount() != ignitions.size())
+		return invalid("ignitionCount");
+
+	if (!ScenarioCache<_type>::StaticVectorBreak())
+		ScenarioCache<_type>::buildStaticVectorBreaks();
+	ScenarioCache<_type>::buildAssets();
+	const std::uint32_t numBreaks = ScenarioCache<_type>::m_landscape->m_staticVectorBreakPolys;
+	if (state.staticbreakcount() != numBreaks)
+		return invalid("staticBreakCount");
+
+	std::uint32_t numGeometry = 0;
+	AssetNode<_type> *an = m_scenario->m_impl->m_assetList.LH_Head();
+	while (an->LN_Succ()) {
+		numGeometry += an->m_geometry.GetCount();
+		an = an->LN_Succ();
+	}
+	if ((std::uint32_t)state.assetgeometry_size() != numGeometry)
+		return invalid("assetGeometry");
+
+	std::uint32_t numFires = 0, numFronts = 0, numPoints = 0;	// check every reference before building anything, so a bad state doesn't leave
+	const std::uint32_t numActive = (std::uint32_t)state.activefires_size();	// partial results behind in the grid cache
+	auto validActiveFires = [&](const google::protobuf::RepeatedPtrField<ProtoState::ActiveFire> &list, std::uint32_t numFires) {
+		for (const auto &a : list)
+			if ((a.fire() > numFires) || (a.mate() > (std::uint32_t)list.size()))
+				return false;
+		return true;
+	};
+
+	for (const auto &ts : state.timesteps()) {
+		if (!ts.has_time())
+			return invalid("timeSteps.time");
+		if ((std::uint32_t)ts.activefiresstate_size() > numActive)
+			return invalid("timeSteps.activeFiresState");
+		for (auto index : ts.staticbreaks())
+			if (index >= numBreaks)
+				return invalid("timeSteps.staticBreaks");
+		for (const auto &f : ts.fires()) {
+			if (f.ignition() >= ignitions.size())
+				return invalid("fires.ignition");
+			if (f.calcpred() > numFires)							// always an earlier fire
+				return invalid("fires.calcPred");
+			if (f.activefire() > numActive)
+				return invalid("fires.activeFire");
+			numFires++;
+			for (const auto &front : f.fronts()) {
+				numFronts++;
+				for (const auto &p : front.points()) {
+					if (p.prevpoint() > numPoints)					// always an earlier point
+						return invalid("points.prevPoint");
+					numPoints++;
+				}
+			}
+		}
+	}
+	for (const auto &ts : state.timesteps()) {
+		if (!validActiveFires(ts.activefiresstate(), numFires))
+			return invalid("timeSteps.activeFiresState");
+		for (const auto &f : ts.fires()) {
+			if (f.calcsucc() > numFires)
+				return invalid("fires.calcSucc");
+			for (const auto &front : f.fronts())
+				for (const auto &p : front.points())
+					if (p.succpoint() > numPoints)
+						return invalid("points.succPoint");
+		}
+	}
+	if (!validActiveFires(state.activefires(), numFires))
+		return invalid("activeFires");
+	for (const auto &sb : state.staticbreaks())
+		if ((sb.index() >= numBreaks) || (!sb.has_used()))
+			return invalid("staticBreaks");
+	for (const auto &ag : state.assetgeometry())
+		if ((ag.closestfirepoint() > numPoints) || (ag.closestfirefront() > numFronts))
+			return invalid("assetGeometry");
+
+	std::vector<XY_PolyLLTimed<_type>*> breaks(numBreaks, nullptr);
+	for (auto vb : ScenarioCache<_type>::m_landscape->m_staticVectorBreaks) {
+		XY_PolyLLTimed<_type> *p = vb->LH_Head();
+		while (p->LN_Succ()) {
+			breaks[p->m_index] = p;
+			p = p->LN_Succ();
+		}
+	}
+
+	auto resumeActiveFire = [&](const ProtoState::ActiveFire &a, ActiveFire<_type> *af, const std::vector<ScenarioFire<_type>*> &fires) {
+		af->LN_Ptr(a.fire() ? fires[a.fire() - 1] : nullptr);
+		af->m_startTime = a.has_starttime() ? toTime(a.starttime(), "activeFires.startTime") : WTime((std::uint64_t)0, m_scenario->m_timeManager);
+		af->m_endTime = a.has_endtime() ? toTime(a.endtime(), "activeFires.endTime") : WTime((std::uint64_t)0, m_scenario->m_timeManager);
+		af->m_boundingBox.m_min.x = static_cast<_type>(a.minx());
+		af->m_boundingBox.m_min.y = static_cast<_type>(a.miny());
+		af->m_boundingBox.m_max.x = static_cast<_type>(a.maxx());
+		af->m_boundingBox.m_max.y = static_cast<_type>(a.maxy());
+		af->m_advanced = a.advanced() ? 1 : 0;
+		af->m_calc_st = a.calcst();
+	};
+	auto resumeMates = [](const google::protobuf::RepeatedPtrField<ProtoState::ActiveFire> &saved, const std::vector<ActiveFire<_type>*> &list) {
+		for (std::size_t i = 0; i < list.size(); i++) {
+			std::uint32_t mate = saved.Get((int)i).mate();
+			if (mate) {
+				list[i]->m_mate_next = list[mate - 1];
+				list[mate - 1]->m_mate_prev = list[i];
+			}
+		}
+	};
+
+	try {
+		std::vector<ScenarioFire<_type>*> fires;
+		std::vector<FireFront<_type>*> fronts;
+		std::vector<FirePoint<_type>*> points;
+		fires.reserve(numFires);
+		fronts.reserve(numFronts);
+		points.reserve(numPoints);
+
+		for (const auto &ts : state.timesteps()) {				// first the perimeters, and anything that only refers backwards in time
+			ScenarioTimeStep<_type> *sts = new ScenarioTimeStep<_type>(this, toTime(ts.time(), "timeSteps.time"));
+			StepArena::Scope arena(&sts->m_arena);
+			sts->m_displayable = ts.displayable() ? 1 : 0;
+			sts->m_evented = ts.evented() ? 1 : 0;
+			sts->m_ignitioned = ts.ignitioned() ? 1 : 0;
+			sts->m_assetCount = ts.assetcount();
+			sts->m_stopConditions.fi90 = ts.stopconditions().fi90();
+			sts->m_stopConditions.fi95 = ts.stopconditions().fi95();
+			sts->m_stopConditions.fi100 = ts.stopconditions().fi100();
+			sts->m_stopConditions.RH = ts.stopconditions().rh();
+			sts->m_stopConditions.precip = ts.stopconditions().precip();
+			sts->m_stopConditions.area = ts.stopconditions().area();
+			sts->m_stopConditions.burnDistance = ts.stopconditions().burndistance();
+
+			for (const auto &f : ts.fires()) {
+				ScenarioFire<_type> *sf = new ScenarioFire<_type>(sts, ignitions[f.ignition()], f.calcpred() ? fires[f.calcpred() - 1] : nullptr);
+				sts->m_fires.AddTail(sf);
+				fires.push_back(sf);
+				sf->InitArea(static_cast<_type>(f.initarea()));
+				sf->m_fireArea = static_cast<_type>(f.firearea());
+				sf->m_newVertexStatus = f.newvertexstatus();
+				sf->m_canBurn = f.canburn() ? 1 : 0;
+				sf->m_bits = f.bits();
+				sf->m_gusting = f.gusting();
+				sf->m_activeFire = nullptr;
+
+				for (const auto &front : f.fronts()) {
+					FireFront<_type> *ff = new FireFront<_type>(sf);
+					ff->m_publicFlags = front.flags();
+					sf->AddPoly(ff);
+					fronts.push_back(ff);
+					for (const auto &p : front.points()) {
+						FirePoint<_type> *fp = new FirePoint<_type>();
+						resumePoint(p, fp);
+						fp->m_prevPoint = p.prevpoint() ? points[p.prevpoint() - 1] : nullptr;
+						ff->AddPoint(fp);
+						points.push_back(fp);
+					}
+				}
+				if (sf->NumPolys())
+					sf->RescanRanges(false, ScenarioCache<_type>::m_multithread ? true : false);
+			}
+
+			for (auto index : ts.staticbreaks()) {
+				XY_PolyLLPolyRef<_type> *r = new XY_PolyLLPolyRef<_type>();
+				r->LN_Ptr(breaks[index]);
+				sts->m_staticVectorBreaksLL.AddTail(r);
+			}
+
+			sts->m_tickCountStart = ts.tickcountstart();
+			sts->m_tickCountEnd = ts.tickcountend();
+			sts->m_realtimeStart = std::chrono::time_point<std::chrono::system_clock>(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::microseconds(ts.realtimestart())));
+			sts->m_realtimeEnd = std::chrono::time_point<std::chrono::system_clock>(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::microseconds(ts.realtimeend())));
+			sts->m_memoryBegin = ts.memorybegin();
+			sts->m_memoryEnd = ts.memoryend();
+			for (std::uint16_t p = 0; p < ScenarioStepPhaseMetrics::NUM_PHASES; p++) {
+				if (p < ts.phasemetrics().ticks_size())		sts->m_phaseMetrics.ticks[p] = ts.phasemetrics().ticks(p);
+				if (p < ts.phasemetrics().realtime_size())	sts->m_phaseMetrics.realtime[p] = ts.phasemetrics().realtime(p);
+				if (p < ts.phasemetrics().points_size())	sts->m_phaseMetrics.points[p] = ts.phasemetrics().points(p);
+				if (p < ts.phasemetrics().fronts_size())	sts->m_phaseMetrics.fronts[p] = ts.phasemetrics().fronts(p);
+				if (p < ts.phasemetrics().clips_size())		sts->m_phaseMetrics.clips[p] = ts.phasemetrics().clips(p);
+			}
+
+			sts->PostCalculation();
+		}
+
+		std::vector<ActiveFire<_type>*> activeFires;
+		for (const auto &a : state.activefires()) {
+			ActiveFire<_type> *af = new ActiveFire<_type>();
+			m_activeFires.AddTail(af);
+			activeFires.push_back(af);
+			resumeActiveFire(a, af, fires);
+		}
+		resumeMates(state.activefires(), activeFires);
+
+		std::uint32_t fire = 0, point = 0;
+		ScenarioTimeStep<_type> *sts = m_timeSteps.LH_Head();
+		for (const auto &ts : state.timesteps()) {				// now the references that may point forward in time
+			std::vector<ActiveFire<_type>*> stateFires;
+			for (const auto &a : ts.activefiresstate()) {
+				ActiveFire<_type> *caf = new ActiveFire<_type>(activeFires[stateFires.size()]);	// the active fire list only grows, so the masters line up
+				sts->m_activeFiresState.AddTail(caf);
+				stateFires.push_back(caf);
+				resumeActiveFire(a, caf, fires);
+			}
+			resumeMates(ts.activefiresstate(), stateFires);
+
+			for (const auto &f : ts.fires()) {
+				ScenarioFire<_type> *sf = fires[fire++];
+				sf->m_activeFire = f.activefire() ? activeFires[f.activefire() - 1] : nullptr;
+				sf->setCalcSucc(f.calcsucc() ? fires[f.calcsucc() - 1] : nullptr);
+				for (const auto &front : f.fronts())
+					for (const auto &p : front.points())
+						points[point++]->m_succPoint = p.succpoint() ? points[p.succpoint() - 1] : nullptr;
+			}
+			sts = sts->LN_Succ();
+		}
+
+		for (const auto &sb : state.staticbreaks())
+			ScenarioCache<_type>::m_staticVectorBreakUsed[sb.index()] = toTime(sb.used(), "staticBreaks.used");
+
+		auto ag = state.assetgeometry().begin();
+		an = m_scenario->m_impl->m_assetList.LH_Head();
+		while (an->LN_Succ()) {
+			AssetGeometryNode<_type> *g = an->m_geometry.LH_Head();
+			while (g->LN_Succ()) {
+				g->m_arrived = ag->arrived();
+				g->m_arrivalTime = ag->has_arrivaltime() ? toTime(ag->arrivaltime(), "assetGeometry.arrivalTime") : WTime((std::uint64_t)0, m_scenario->m_timeManager);
+				resumePoint(ag->closestpoint(), &g->m_closestPoint);
+				g->m_closestFirePoint = ag->closestfirepoint() ? points[ag->closestfirepoint() - 1] : nullptr;
+				g->m_closestFireFront = ag->closestfirefront() ? fronts[ag->closestfirefront() - 1] : nullptr;
+				g = g->LN_Succ();
+				ag++;
+			}
+			an = an->LN_Succ();
+		}
+	} catch (std::bad_alloc &) {
+		clearSteps();
+		return E_OUTOFMEMORY;
+	}
+
+	recordSteps();
+	m_closestcache.Clear();
+	delaunayInvalidate();
+	m_stepState = state.stepstate();
+	return S_OK;
+}
+
+
+template<class _type>
+static void spillGeometry(const MinListTempl<AssetNode<_type>> &assets, std::vector<AssetGeometryNode<_type>*> &geometry) {
+	const AssetNode<_type> *an = assets.LH_Head();		// same order as ProtoState::assetGeometry
+	while (an->LN_Succ()) {
+		AssetGeometryNode<_type> *g = an->m_geometry.LH_Head();
+		while (g->LN_Succ()) {
+			geometry.push_back(g);
+			g = g->LN_Succ();
+		}
+		an = an->LN_Succ();
+	}
+}
+
+
+template<class _type>
+ScenarioTimeStep<_type> *Scenario<_type>::spillKeep(std::uint64_t &budget, std::uint64_t &resident) const {
+	budget = resident = 0;
+	ScenarioTimeStep<_type> *keep = m_timeSteps.LH_Tail();
+	std::uint32_t display = 0;
+	while (keep->LN_Pred()) {
+		budget += keep->m_arena.Reserved();
+		if ((keep->m_displayable) && (++display == m_scenario->m_spillSteps))
+			break;
+		keep = keep->LN_Pred();
+	}
+	if (!keep->LN_Pred())
+		return nullptr;
+
+	ScenarioTimeStep<_type> *sts = m_spillTail.load();
+	for (sts = sts ? sts->LN_Succ() : m_timeSteps.LH_Head(); sts != keep; sts = sts->LN_Succ())
+		resident += sts->m_arena.Reserved();
+	return keep;
+}
+
+
+template<class _type>
+ScenarioTimeStep<_type> *Scenario<_type>::spillOldest(const WTime &time, std::uint32_t display) const {
+	ScenarioTimeStep<_type> *s = m_timeSteps.LH_Tail();
+	std::uint32_t found = 0;
+	while (s->LN_Pred()) {
+		if ((s->m_lock.CurrentState() >= 0) && (s->m_displayable) && (s->m_time <= time) && (++found == display))	// as GetStep() picks them
+			return s;
+		s = s->LN_Pred();
+	}
+	return m_timeSteps.LH_Head();
+}
+
+
+template<class _type>
+void Scenario<_type>::spillSteps() {
+	if (m_spillHolds.load())											// a query is still walking steps that were paged in for it
+		return;
+
+	std::uint64_t budget, resident;										// as many bytes again as the kept steps may stay in memory before them, so steps
+	ScenarioTimeStep<_type> *keep = spillKeep(budget, resident);		// a query just paged in aren't written straight back out
+	m_spillPressure = false;
+	if (!keep)
+		return;
+	if ((budget) && (resident <= budget))
+		return;
+
+	ScenarioTimeStep<_type> *sts = m_spillTail.load();
+	sts = sts ? sts->LN_Succ() : m_timeSteps.LH_Head();
+	if (sts == keep)
+		return;
+
+	try {
+		if (!m_spill)
+			m_spill = std::make_unique<ScenarioSpillStore>();
+
+		std::unordered_set<const ScenarioFire<_type>*> growing;			// fires are grown from these, so their steps have to stay
+		const ActiveFire<_type> *af = m_activeFires.LH_Head();
+		while (af->LN_Succ()) {
+			if (af->LN_Ptr())
+				growing.insert(af->LN_Ptr());
+			af = af->LN_Succ();
+		}
+		std::vector<AssetGeometryNode<_type>*> geometry;
+		spillGeometry(m_scenario->m_impl->m_assetList, geometry);
+
+		const std::unordered_map<const void*, std::uint32_t> noLinks;		// links are kept separately, by step and number
+		std::unordered_map<const void*, std::pair<std::uint64_t, std::uint32_t>> later;	// points on later steps, to their step's time and number
+		ScenarioTimeStep<_type> *numbered = sts;
+		auto numberNext = [&]() {
+			if (!numbered->LN_Succ()->LN_Succ())
+				return false;
+			numbered = numbered->LN_Succ();
+			const std::uint64_t time = numbered->m_time.GetTotalMicroSeconds();
+			std::uint32_t index = 0;
+			const ScenarioFire<_type> *sf = numbered->m_fires.LH_Head();
+			while (sf->LN_Succ()) {
+				const FireFront<_type> *ff = sf->LH_Head();
+				while (ff->LN_Succ()) {
+					const FirePoint<_type> *fp = ff->LH_Head();
+					while (fp->LN_Succ()) {
+						later.emplace(fp, std::make_pair(time, ++index));
+						fp = fp->LN_Succ();
+					}
+					ff = ff->LN_Succ();
+				}
+				sf = sf->LN_Succ();
+			}
+			return true;
+		};
+
+		std::uint64_t from = sts->m_time.GetTotalMicroSeconds(), to = from;	// the steps spilled, and the later ones their links are cut from
+		bool spilled = false;
+		while ((sts != keep) && ((!budget) || (resident > budget / 2))) {	// oldest first, down to half, so it's not back at the next step
+			bool can_spill = true;
+			ScenarioFire<_type> *sf = sts->m_fires.LH_Head();
+			while (sf->LN_Succ()) {
+				if (growing.find(sf) != growing.end()) {
+					can_spill = false;
+					break;
+				}
+				sf = sf->LN_Succ();
+			}
+			if (!can_spill)
+				break;
+
+			sts->m_lock.Lock_Write();
+			ProtoSpill record;
+			std::unordered_map<const void*, std::uint32_t> points, fronts;
+			sf = sts->m_fires.LH_Head();
+			while (sf->LN_Succ()) {
+				sf->InitArea();											// cache it while we still have the perimeters
+				ProtoSpill::Fire *f = record.add_fires();
+				FireFront<_type> *ff = sf->LH_Head();
+				while (ff->LN_Succ()) {
+					fronts.emplace(ff, (std::uint32_t)fronts.size() + 1);
+					ProtoState::FireFront *front = f->add_fronts();
+					front->set_flags(ff->m_publicFlags);
+					FirePoint<_type> *fp = ff->LH_Head();
+					while (fp->LN_Succ()) {
+						std::uint32_t index = (std::uint32_t)points.size() + 1;
+						points.emplace(fp, index);
+						checkpointPoint(fp, front->add_points(), noLinks);
+						if (fp->m_succPoint) {
+							auto it = later.find(fp->m_succPoint);
+							while ((it == later.end()) && (numberNext()))
+								it = later.find(fp->m_succPoint);
+							if (it != later.end()) {
+								ProtoSpill::Link *l = record.add_links();
+								l->set_point(index);
+								l->set_step(it->second.first);
+								l->set_target(it->second.second);
+							} else
+								weak_assert(false);
+						}
+						fp = fp->LN_Succ();
+					}
+					ff = ff->LN_Succ();
+				}
+				sf = sf->LN_Succ();
+			}
+			for (std::uint32_t i = 0; i < geometry.size(); i++) {
+				auto it = fronts.find(geometry[i]->m_closestFireFront);
+				if (it != fronts.end()) {
+					ProtoSpill::Asset *a = record.add_assets();
+					a->set_geometry(i);
+					a->set_front(it->second);
+					auto it2 = points.find(geometry[i]->m_closestFirePoint);
+					if (it2 != points.end())
+						a->set_point(it2->second);
+				}
+			}
+
+			if (!m_spill->Push(record)) {								// out of disk, so it just stays in memory
+				sts->m_lock.Unlock();
+				break;
+			}
+			for (const auto &l : record.links()) {
+				m_spillTargets[l.step()]++;
+				if (to < l.step())
+					to = l.step();
+			}
+			if (to < sts->m_time.GetTotalMicroSeconds())
+				to = sts->m_time.GetTotalMicroSeconds();
+			resident -= sts->m_arena.Reserved();
+
+			for (auto &p : points) {
+				FirePoint<_type> *fp = (FirePoint<_type>*)p.first;
+				if (fp->m_succPoint)	fp->m_succPoint->m_prevPoint = nullptr;
+				if (fp->m_prevPoint)	fp->m_prevPoint->m_succPoint = nullptr;
+				later.erase(fp);
+			}
+			for (auto g : geometry)
+				if (fronts.find(g->m_closestFireFront) != fronts.end()) {
+					g->m_closestFirePoint = nullptr;
+					g->m_closestFireFront = nullptr;
+				}
+			sts->ClearNearest();
+			sf = sts->m_fires.LH_Head();
+			while (sf->LN_Succ()) {
+				FireFront<_type> *ff;
+				while ((ff = sf->LH_Head())->LN_Succ()) {
+					sf->RemovePoly(ff);
+					delete ff;
+				}
+				sf = sf->LN_Succ();
+			}
+			if (!sts->m_arena.Live())
+				sts->m_arena.Release();									// the perimeters' blocks go back in one go
+			sts->m_spilled = 1;
+			sts->m_lock.Unlock();
+			m_spillTail = sts;
+			spilled = true;
+
+			sts = sts->LN_Succ();
+		}
+		if (spilled) {
+			m_closestcache.Clear();
+			delaunayInvalidate(from, to);
+		}
+	} catch (std::bad_alloc &) {
+		weak_assert(false);												// stop spilling, everything we haven't written out is still in memory
+	}
+}
+
+
+template<class _type>
+HRESULT Scenario<_type>::pageIn(const WTime &time, std::uint32_t display) {
+	ScenarioTimeStep<_type> *sts = m_spillTail.load();
+	if (!sts)
+		return S_OK;
+
+	ScenarioTimeStep<_type> *oldest = spillOldest(time, display);
+	if (sts->m_time < oldest->m_time)
+		return S_OK;
+	std::uint64_t from = sts->m_time.GetTotalMicroSeconds(), to = from;	// the steps paged in, and the later ones their links go back into
+
+	std::vector<AssetGeometryNode<_type>*> geometry;
+	spillGeometry(m_scenario->m_impl->m_assetList, geometry);
+	std::unordered_map<std::uint64_t, std::vector<FirePoint<_type>*>> later;
+
+	HRESULT hr = S_OK;
+	bool paged = false;
+	while ((sts = m_spillTail.load()) && (sts->m_time >= oldest->m_time)) {
+		ProtoSpill record;
+		if (!m_spill->Pop(record)) {									// it's left in the store and the step stays spilled, so the query fails rather
+			weak_assert(false);											// than see a step without perimeters
+			hr = ERROR_INVALID_DATA;
+			break;
+		}
+		paged = true;
+
+		sts->m_lock.Lock_Write();
+		StepArena::Scope arena(&sts->m_arena);
+		std::vector<FireFront<_type>*> fronts;
+		std::vector<FirePoint<_type>*> points;
+		ScenarioFire<_type> *sf = sts->m_fires.LH_Head();
+		for (const auto &f : record.fires()) {
+			if (!sf->LN_Succ()) {
+				weak_assert(false);
+				break;
+			}
+			for (const auto &front : f.fronts()) {
+				FireFront<_type> *ff = new FireFront<_type>(sf);
+				ff->m_publicFlags = front.flags();
+				sf->AddPoly(ff);
+				fronts.push_back(ff);
+				for (const auto &p : front.points()) {
+					FirePoint<_type> *fp = new FirePoint<_type>();
+					resumePoint(p, fp);
+					ff->AddPoint(fp);
+					points.push_back(fp);
+				}
+			}
+			if (sf->NumPolys())
+				sf->RescanRanges(false, ScenarioCache<_type>::m_multithread ? true : false);
+			sf = sf->LN_Succ();
+		}
+
+		for (const auto &l : record.links()) {
+			auto target = m_spillTargets.find(l.step());
+			if ((target != m_spillTargets.end()) && (!--target->second))
+				m_spillTargets.erase(target);
+			if (to < l.step())
+				to = l.step();
+
+			auto it = later.find(l.step());
+			if (it == later.end()) {
+				std::vector<FirePoint<_type>*> &targets = later[l.step()];
+				const ScenarioTimeStep<_type> *t = sts->LN_Succ();
+				while ((t->LN_Succ()) && (t->m_time.GetTotalMicroSeconds() < l.step()))
+					t = t->LN_Succ();
+				weak_assert((t->LN_Succ()) && (t->m_time.GetTotalMicroSeconds() == l.step()));	// Purge() keeps every step that spilled steps link into
+				if ((t->LN_Succ()) && (t->m_time.GetTotalMicroSeconds() == l.step())) {
+					const ScenarioFire<_type> *tsf = t->m_fires.LH_Head();
+					while (tsf->LN_Succ()) {
+						FireFront<_type> *ff = tsf->LH_Head();
+						while (ff->LN_Succ()) {
+							FirePoint<_type> *fp = ff->LH_Head();
+							while (fp->LN_Succ()) {
+								targets.push_back(fp);
+								fp = fp->LN_Succ();
+							}
+							ff = ff->LN_Succ();
+						}
+						tsf = tsf->LN_Succ();
+					}
+				}
+				it = later.find(l.step());
+			}
+			if ((l.point()) && (l.point() <= points.size()) && (l.target()) && (l.target() <= it->second.size())) {
+				FirePoint<_type> *fp = points[l.point() - 1], *succ = it->second[l.target() - 1];
+				fp->m_succPoint = succ;
+				succ->m_prevPoint = fp;
+			}
+		}
+
+		for (const auto &a : record.assets()) {
+			if (a.geometry() >= geometry.size())
+				continue;
+			AssetGeometryNode<_type> *g = geometry[a.geometry()];
+			g->m_closestFirePoint = ((a.point()) && (a.point() <= points.size())) ? points[a.point() - 1] : nullptr;
+			g->m_closestFireFront = ((a.front()) && (a.front() <= fronts.size())) ? fronts[a.front() - 1] : nullptr;
+		}
+
+		sts->ClearNearest();
+		sts->m_spilled = 0;
+		sts->m_lock.Unlock();
+		from = sts->m_time.GetTotalMicroSeconds();
+		ScenarioTimeStep<_type> *pred = sts->LN_Pred();
+		m_spillTail = ((pred->LN_Pred()) && (pred->m_spilled)) ? pred : nullptr;
+	}
+	if (paged) {
+		delaunayInvalidate(from, to);		// the windows that were built without these perimeters
+		std::uint64_t budget, resident;
+		if ((m_scenario->m_spillSteps) && (spillKeep(budget, resident)) && ((!budget) || (resident > budget)))
+			m_spillPressure = true;			// for the last query out to spill some again
+	}
+	return hr;
+}
+
+
+template<class _type>
+Scenario<_type>::spillHold::spillHold(const Scenario<_type> *scenario, const WTime &time, std::uint32_t display) {
+	m_hr = S_OK;
+	if ((!scenario->m_scenario->m_spillSteps) && (!scenario->m_spillTail.load())) {
+		m_scenario = nullptr;										// nothing spilled, and nothing will be while the query runs
+		return;
+	}
+	m_scenario = const_cast<Scenario<_type> *>(scenario);			// queries are const, paging only changes which perimeters are in memory
+
+	m_scenario->m_spillHolds++;										// before locking, so a query finishing now can't spill again what we're about to use
+	{
+		CRWThreadSemaphoreEngage _semaphore_engage(m_scenario->m_llLock, SEM_FALSE);
+		ScenarioTimeStep<_type> *tail = m_scenario->m_spillTail.load();
+		if ((!tail) || (tail->m_time < m_scenario->spillOldest(time, display)->m_time))
+			return;													// everything it will walk is in memory, and stays there while we hold it
+	}
+	CRWThreadSemaphoreEngage _semaphore_engage(m_scenario->m_llLock, SEM_TRUE);
+	m_hr = m_scenario->pageIn(time, display);
+}
+
+
+template<class _type>
+Scenario<_type>::spillHold::~spillHold() {
+	if (!m_scenario)
+		return;
+
+	if ((--m_scenario->m_spillHolds) || (!m_scenario->m_spillPressure.load()) || (!m_scenario->m_scenario->m_spillSteps))
+		return;														// what was paged in stays until there's too much of it
+
+	CRWThreadSemaphoreEngage _semaphore_engage(m_scenario->m_llLock, SEM_TRUE);
+	if ((!m_scenario->m_spillHolds.load()) && (m_scenario->m_stepLock.CurrentState() >= 0))
+		m_scenario->spillSteps();									// else Step() spills them when it's done
+}
+
+#include "InstantiateClasses.cpp"
@@ -27,6 +27,9 @@
 
 template<class _type>
 HRESULT Scenario<_type>::GetVectorSize(std::uint32_t fire, WTime *time, std::uint32_t *size) const {
+	spillHold paged(this, *time);
+	if (FAILED(paged.Result()))
+		return paged.Result();
 	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore *)&m_llLock, SEM_FALSE);
 	ScenarioTimeStep<_type> *sts;
 	HRESULT hr = GetStep(time, &sts, true);
@@ -64,6 +67,9 @@ HRESULT Scenario<_type>::GetVectorSize(std::uint32_t fire, WTime *time, std::uin
 
 template<class _type>
 HRESULT Scenario<_type>::GetVectorArray(std::uint32_t fire, WTime *time, std::uint32_t *size, XY_Poly &xy_pairs) const {
+	spillHold paged(this, *time);
+	if (FAILED(paged.Result()))
+		return paged.Result();
 	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore *)&m_llLock, SEM_FALSE);
 	ScenarioTimeStep<_type> *sts;
 	HRESULT hr = GetStep(time, &sts, true);
@@ -92,8 +98,41 @@ HRESULT Scenario<_type>::GetVectorArray(std::uint32_t fire, WTime *time, std::ui
 }
 
 
+template<class _type>
+void Scenario<_type>::accumulatePhaseMetrics(const ScenarioTimeStep<_type> *sts, ScenarioStepPhaseMetrics &summary) const {
+	summary.Clear();
+	const ScenarioTimeStep<_type> *s = m_timeSteps.LH_Head();
+	while (s->LN_Succ()) {
+		if ((s->m_displayable) || (s == sts))		// same rules as CWFGM_FIRE_STAT_TIMESTEP_CUMULATIVE_TICKS, only the last step of each Step() has metrics
+			summary += s->m_phaseMetrics;
+		if (s == sts)
+			break;
+		s = s->LN_Succ();
+	}
+}
+
+
+template<class _type>
+HRESULT Scenario<_type>::GetPhaseSummary(WTime *time, ScenarioStepPhaseMetrics *summary) const {
+	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore *)&m_llLock, SEM_FALSE);
+	ScenarioTimeStep<_type> *sts;
+	HRESULT hr = GetStep(time, &sts, true);
+
+	if (!sts) {
+		summary->Clear();
+		return hr;
+	}
+	CRWThreadSemaphoreEngage _semaphore_engage2(sts->m_lock, SEM_FALSE);
+	accumulatePhaseMetrics(sts, *summary);
+	return S_OK;
+}
+
+
 template<class _type>
 HRESULT Scenario<_type>::GetStatsArray(const std::uint32_t fire, WTime *time, const std::uint16_t stat, std::uint32_t *size, std::vector<double> &stats) const {
+	spillHold paged(this, *time);
+	if (FAILED(paged.Result()))
+		return paged.Result();
 	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore *)&m_llLock, SEM_FALSE);
 	ScenarioTimeStep<_type> *sts;
 	HRESULT hr = GetStep(time, &sts, true);
@@ -126,6 +165,10 @@ HRESULT Scenario<_type>::GetStatsArray(const std::uint32_t fire, WTime *time, co
 
 template<class _type>
 HRESULT Scenario<_type>::GetStats(const std::uint32_t fire, ICWFGM_Fuel *fuel, WTime *time, const std::uint16_t stat, const std::uint16_t discretization, PolymorphicAttribute *stats) const {
+	const bool history = (stat == CWFGM_FIRE_STAT_TIMESTEP_CUMULATIVE_BURNING_SECS) || (stat == CWFGM_FIRE_STAT_CUMULATIVE_NUM_POINTS) || (stat == CWFGM_FIRE_STAT_CUMULATIVE_NUM_ACTIVE_POINTS);
+	spillHold paged(this, history ? WTime((std::uint64_t)0, m_scenario->m_timeManager) : *time, 2);	// this step and the one before it, or every step
+	if (FAILED(paged.Result()))
+		return paged.Result();
 	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore *)&m_llLock, SEM_FALSE);
 	double tmp1, tmp2;
 	WTimeSpan seconds;
@@ -227,6 +270,23 @@ HRESULT Scenario<_type>::GetStats(const std::uint32_t fire, ICWFGM_Fuel *fuel, W
 		}
 		*stats = cumulative;
 		return S_OK;
+	} else if ((stat >= CWFGM_FIRE_STAT_PHASE_FIRST) && (stat <= CWFGM_FIRE_STAT_PHASE_LAST)) {
+		const std::uint16_t phase = (stat - CWFGM_FIRE_STAT_PHASE_FIRST) / CWFGM_FIRE_STAT_PHASE_STRIDE;
+		const std::uint16_t metric = (stat - CWFGM_FIRE_STAT_PHASE_FIRST) % CWFGM_FIRE_STAT_PHASE_STRIDE;
+		switch (metric) {
+			case 0:		*stats = (std::uint64_t)(sts->m_phaseMetrics.ticks[phase] / 10000); return S_OK;
+			case 1:		*stats = sts->m_phaseMetrics.realtime[phase]; return S_OK;
+			case 2:		*stats = sts->m_phaseMetrics.points[phase]; return S_OK;
+			case 3:		*stats = sts->m_phaseMetrics.fronts[phase]; return S_OK;
+			case 4:		*stats = sts->m_phaseMetrics.clips[phase]; return S_OK;
+		}
+		ScenarioStepPhaseMetrics summary;
+		accumulatePhaseMetrics(sts, summary);
+		if (metric == 5)
+			*stats = (std::uint64_t)(summary.ticks[phase] / 10000);
+		else
+			*stats = summary.realtime[phase];
+		return S_OK;
 	} else if (stat == CWFGM_FIRE_STAT_NUM_TIMESTEPS) {
 		*stats = m_timeSteps.NodeIndex(sts) + 1;
 		return S_OK;
@@ -532,6 +592,9 @@ HRESULT Scenario<_type>::GetStats(const std::uint32_t fire, ICWFGM_Fuel *fuel, W
 
 template<class _type>
 HRESULT Scenario<_type>::GetStats(const std::uint32_t fire, WTime *time, const std::uint16_t stat, const bool only_displayable, const double greater_equal, const double less_than, double *stats) const {
+	spillHold paged(this, *time);
+	if (FAILED(paged.Result()))
+		return paged.Result();
 	CRWThreadSemaphoreEngage _semaphore_engage(*(CRWThreadSemaphore *)&m_llLock, SEM_FALSE);
 	WTimeSpan seconds;
 	ScenarioTimeStep<_type> *sts;
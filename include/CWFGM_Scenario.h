@@ -146,6 +146,7 @@ class Scenario;
 class FIRECOM_API CCWFGM_Scenario : public ICWFGM_CommonBase, public ICWFGM_PercentileAttribute, public ISerializeProto {
 public:
 	friend class CWFGM_ScenarioHelper;
+	friend class CCWFGM_ScenarioEnsemble;
 	template<typename T> friend class ScenarioTimeStep;
 	template<typename T> friend class ScenarioCache;
 	template<typename T> friend class Scenario;
@@ -414,6 +415,15 @@ public:
 		<li><code>CWFGM_SCENARIO_OPTION_TEMPORAL_THRESHOLD_ACCEL</code> 64-bit signed integer.  Units are in seconds.  Maximum time allowed between two adjacent simulation time steps when any ignition is in its acceleration phase (when ROSt is less than 90% of ROSeq).
 		<li><code>CWFGM_SCENARIO_OPTION_DISPLAY_INTERVAL</code> 64-bit signed integer.  Units are in seconds.  Time interval for output fire perimeters, or 0 if every time step is to be outputted.
 		<li><code>CWFGM_SCENARIO_OPTION_PURGE_NONDISPLAYABLE</code> Boolean.  When true, non-displayable time steps will not be retained, to save on memory overhead.
+		<li><code>CWFGM_SCENARIO_OPTION_SPILL_STEPS</code> 32-bit unsigned integer.  Number of the most recent display time steps whose perimeters are kept in memory.  Perimeters of older time steps are written to a temporary memory mapped file and read back when they are next asked for.  Older perimeters taking up to as much memory again as the kept ones stay in memory, once stepped past or read back, before the oldest of them are written out again.  0 (the default) keeps everything in memory.
+		<li><code>CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_SIZE</code> 32-bit unsigned integer.  Number of entries in the cache of closest vertices used by statistics queries, rounded up to fill every shard.  Default is 4096.
+		<li><code>CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_HITS</code> 64-bit unsigned integer.  Read only.  Closest vertex cache hits since the simulation was reset, 0 if it hasn't been.
+		<li><code>CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_MISSES</code> 64-bit unsigned integer.  Read only.  Closest vertex cache misses.
+		<li><code>CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_EVICTIONS</code> 64-bit unsigned integer.  Read only.  Closest vertex cache entries replaced by other points, grow CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_SIZE if this is near the misses.
+		<li><code>CWFGM_SCENARIO_OPTION_QUEUE_UP</code> 32-bit unsigned integer.  Number of active vertices in a time step needed before growth calculations are done by the worker threads, and the number each worker takes at a time.  Default is 64 (halved when weather isn't spatially interpolated).
+		<li><code>CWFGM_SCENARIO_OPTION_QUEUE_UP_GRID</code> 32-bit unsigned integer.  Number of vertices in a fire front needed before tracking against the grid is done in parallel.  Default is 64.
+		<li><code>CWFGM_SCENARIO_OPTION_QUEUE_UP_VECTOR</code> 32-bit unsigned integer.  Number of vertices in a fire front needed before tracking against vector breaks and other fires is done in parallel.  Default is 64.
+		<li><code>CWFGM_SCENARIO_OPTION_QUEUE_UP_CALIBRATE</code> Boolean.  When true, the first time steps alternate serial and parallel runs of each of the above phases and time them, then pick the thresholds and work sizes that suit this machine.  Once calibration has finished, the three values above read back as the ones it picked, until then they read back as set.  Default is false.
 		<li><code>CWFGM_SCENARIO_OPTION_IGNITIONS_DX</code> 64-bit floating point.  Units are in meters. How much to nudge ignitions to perform probabilistic analyses on ignition location. Primarily used when ignition information is not 100% reliable.
 		<li><code>CWFGM_SCENARIO_OPTION_IGNITIONS_DY</code> 64-bit floating point.  Units are in meters. How much to nudge ignitions to perform probabilistic analyses on ignition location. Primarily used when ignition information is not 100% reliable.
 		<li><code>CWFGM_SCENARIO_OPTION_IGNITIONS_DT</code> 64-bit signed integer.  Units are in seconds. How much to nudge ignitions to perform probabilistic analyses on ignition location and start time. Primarily used when ignition information is not 100% reliable.
@@ -427,7 +437,7 @@ public:
 		<li><code>CWFGM_GRID_ATTRIBUTE_DST_START</code>	64-bit unsigned integer.  Units are in seconds.  Julian date determining when daylight savings starts within the calendar year.
 		<li><code>CWFGM_GRID_ATTRIBUTE_DST_END</code>	64-bit unsigned integer.  Units are in seconds.  Julian date determining when daylight savings ends within the calendar year.
 		<li><code>CWFGM_ATTRIBUTE_LOAD_WARNING</code>	BSTR.  Any warnings generated by the COM object when deserializating.
-		<li><code>CWFGM_SCENARIO_OPTION_CACHE_GRID_POINTS</code> Boolean.  When true, caches will be calculated to determine the closest points (for statistics purposes) to the center of each grid cell.
+		<li><code>CWFGM_SCENARIO_OPTION_CACHE_GRID_POINTS</code> Boolean.  When true, caches will be calculated to determine the closest points (for statistics purposes) to the center of each grid cell.  ROS, FI and RAZ queries by closest vertex at the center of a grid cell are then answered from this cache.
 		<li><code>CWFGM_SCENARIO_OPTION_SUPPRESS_TIGHT_CONCAVE_ADDPOINT</code> Boolean.  When TRUE, then we limit the sine curve to '1' when considering adding points to a convex portion of the hull
 		<li><code>CWFGM_SCENARIO_OPTION_GRID_DECIMATION</code> 64-bit floating point.  If 0, then all accuracy is retained in calculations.  If not 0, then specifies the grid resolution to pull all values to
 		<li><code>CWFGM_SCENARIO_OPTION_FALSE_ORIGIN</code>	Boolean. Whether or not to apply the grid's (original) false origin to FireEngine calc's
@@ -478,6 +488,12 @@ public:
 		<li><code>CWFGM_SCENARIO_OPTION_TEMPORAL_THRESHOLD_ACCEL</code> 64-bit signed integer.  Units are in seconds.  Maximum time allowed between two adjacent simulation time steps when any ignition is in its acceleration phase (when ROSt is less than 90% of ROSeq).
 		<li><code>CWFGM_SCENARIO_OPTION_DISPLAY_INTERVAL</code> 64-bit signed integer.  Units are in seconds.  Time interval for output fire perimeters, or 0 if every time step is to be outputted.
 		<li><code>CWFGM_SCENARIO_OPTION_PURGE_NONDISPLAYABLE</code> Boolean.  When true, non-displayable time steps will not be retained, to save on memory overhead.
+		<li><code>CWFGM_SCENARIO_OPTION_SPILL_STEPS</code> 32-bit unsigned integer.  Number of the most recent display time steps whose perimeters are kept in memory.  Perimeters of older time steps are written to a temporary memory mapped file and read back when they are next asked for.  Older perimeters taking up to as much memory again as the kept ones stay in memory, once stepped past or read back, before the oldest of them are written out again.  0 (the default) keeps everything in memory.
+		<li><code>CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_SIZE</code> 32-bit unsigned integer.  Number of entries in the cache of closest vertices used by statistics queries, rounded up to fill every shard.  Default is 4096.
+		<li><code>CWFGM_SCENARIO_OPTION_QUEUE_UP</code> 32-bit unsigned integer.  Number of active vertices in a time step needed before growth calculations are done by the worker threads, and the number each worker takes at a time.  Default is 64 (halved when weather isn't spatially interpolated).
+		<li><code>CWFGM_SCENARIO_OPTION_QUEUE_UP_GRID</code> 32-bit unsigned integer.  Number of vertices in a fire front needed before tracking against the grid is done in parallel.  Default is 64.
+		<li><code>CWFGM_SCENARIO_OPTION_QUEUE_UP_VECTOR</code> 32-bit unsigned integer.  Number of vertices in a fire front needed before tracking against vector breaks and other fires is done in parallel.  Default is 64.
+		<li><code>CWFGM_SCENARIO_OPTION_QUEUE_UP_CALIBRATE</code> Boolean.  When true, the first time steps alternate serial and parallel runs of each of the above phases and time them, then pick the thresholds and work sizes that suit this machine.  Default is false.
 		<li><code>CWFGM_SCENARIO_OPTION_IGNITIONS_DX</code> 64-bit floating point.  Units are in meters. How much to nudge ignitions to perform probabilistic analyses on ignition location. Primarily used when ignition information is not 100% reliable.
 		<li><code>CWFGM_SCENARIO_OPTION_IGNITIONS_DY</code> 64-bit floating point.  Units are in meters. How much to nudge ignitions to perform probabilistic analyses on ignition location. Primarily used when ignition information is not 100% reliable.
 		<li><code>CWFGM_SCENARIO_OPTION_IGNITIONS_DT</code> 64-bit signed integer.  Units are in seconds. How much to nudge ignitions to perform probabilistic analyses on ignition location and start time. Primarily used when ignition information is not 100% reliable.
@@ -490,7 +506,7 @@ public:
 		<li><code>CWFGM_GRID_ATTRIBUTE_DAYLIGHT_SAVINGS</code>	64-bit signed integer.  Units are in seconds.  Amount of correction to apply for daylight savings time.
 		<li><code>CWFGM_GRID_ATTRIBUTE_DST_START</code>	64-bit unsigned integer.  Units are in seconds.  Julian date determining when daylight savings starts within the calendar year.
 		<li><code>CWFGM_GRID_ATTRIBUTE_DST_END</code>	64-bit unsigned integer.  Units are in seconds.  Julian date determining when daylight savings ends within the calendar year.
-		<li><code>CWFGM_SCENARIO_OPTION_CACHE_GRID_POINTS</code> Boolean.  When true, caches will be calculated to determine the closest points (for statistics purposes) to the center of each grid cell.
+		<li><code>CWFGM_SCENARIO_OPTION_CACHE_GRID_POINTS</code> Boolean.  When true, caches will be calculated to determine the closest points (for statistics purposes) to the center of each grid cell.  ROS, FI and RAZ queries by closest vertex at the center of a grid cell are then answered from this cache.
 		<li><code>CWFGM_SCENARIO_OPTION_SUPPRESS_TIGHT_CONCAVE_ADDPOINT</code> Boolean.  When TRUE, then we limit the sine curve to '1' when considering adding points to a convex portion of the hull
 		<li><code>CWFGM_SCENARIO_OPTION_GRID_DECIMATION</code> 64-bit floating point.  If 0, then all accuracy is retained in calculations.  If not 0, then specifies the grid resolution to pull all values to
 		<li><code>CWFGM_SCENARIO_OPTION_FALSE_ORIGIN</code>	Boolean. Whether or not to apply the grid's (original) false origin to FireEngine calc's
@@ -535,6 +551,20 @@ public:
 		\retval SUCCESS_FINE_NOT_STARTED Either no fires or the request predates the start time of the simulation
 	*/
 	virtual NO_THROW HRESULT IsXYBurned(const XY_Point &pt, const HSS_Time::WTime &time, bool *burned) const;
+	/** Retrieves whether each of a set of locations was burned before or during time.  Equivalent to calling IsXYBurned() for each location, but
+		the simulation is only locked and searched once, and the locations are tested together, so this is much faster for large sets.
+		\param pts Locations to test
+		\param time A GMT time provided as seconds since Midnight January 1, 1600
+		\param burned Resized to match pts, each entry is set to true if the location has been burned, otherwise false.
+
+		\retval E_POINTER The address provided for burned is invalid
+		\retval E_OUTOFMEMORY Insufficient memory
+		\retval S_OK Successful
+		\retval ERROR_SCENARIO_BAD_STATE If the function is run while a scenario is running
+		\retval ERROR_NODATA|ERROR_SEVERITY WARNING Nothing initialized yet
+		\retval SUCCESS_FINE_NOT_STARTED Either no fires or the request predates the start time of the simulation
+	*/
+	virtual NO_THROW HRESULT IsXYBurnedSet(const std::vector<XY_Point> &pts, const HSS_Time::WTime &time, std::vector<bool> *burned) const;
 	/** Removes one displayable step during a simulation.
 		\sa ICWFGM_Scenario::Simulation_StepBack
 		\retval S_OK Successful
@@ -542,6 +572,46 @@ public:
 		\retval ERR0R_GRID_UNINTIALIZED No ICWFGM_GridEngine object has been specified, or that object doesn't have an initialized latitude, longitude, or time zone.
 	*/
 	virtual NO_THROW HRESULT Simulation_StepBack();
+	/** Saves the calculated state of a running simulation (every time step, fire perimeter, and the bookkeeping needed to continue from the last
+		step) so that it can be continued later, or on another machine, with Simulation_Resume().
+		\param options Serialization options, used for the times in the state
+		\param state Returned state of the simulation
+		\retval S_OK Successful
+		\retval E_POINTER state is NULL
+		\retval ERROR_SCENARIO_BAD_STATE Scenario is not running
+		\retval E_OUTOFMEMORY Insufficient memory
+	*/
+	virtual NO_THROW HRESULT Simulation_Checkpoint(const SerializeProtoOptions& options, WISE::FireEngineProto::CwfgmScenarioState *state) const;
+	/** Loads the state saved by Simulation_Checkpoint() into this scenario, so that Simulation_Step() continues where the original simulation
+		left off.  Simulation_Reset() must be called first.  The scenario must have the same start time, ignitions, assets, and vector breaks as the one
+		the state was taken from.  Other inputs (weather, end time) may change, so long as the end time isn't before the last saved step.
+		\param state State of the simulation to continue
+		\param valid Optional validation object, to report why a state can't be used
+		\param name Name of the state for validation
+		\retval S_OK Successful, the simulation can be stepped
+		\retval ERROR_SCENARIO_BAD_STATE Scenario is not running, or has already been stepped
+		\retval ERROR_PROTOBUF_OBJECT_VERSION_INVALID The state was saved by a newer version
+		\retval ERROR_PROTOBUF_OBJECT_INVALID The state doesn't match this scenario, or is corrupt
+		\retval E_OUTOFMEMORY Insufficient memory
+	*/
+	virtual NO_THROW HRESULT Simulation_Resume(const WISE::FireEngineProto::CwfgmScenarioState &state, std::shared_ptr<validation::validation_object> valid, const std::string& name);
+	/** Starts another scenario part way through this one's simulation, for what-if runs such as an updated weather forecast.  The other scenario
+		is given this simulation's history up to (and including) the last displayable step at or before time, with the fires as they were at that
+		step, and then continues on from there with its own inputs when it is stepped.  Simulation_Reset() must be called on the other scenario first.
+		This scenario is left as it is.
+		\param time Time to fork the simulation at
+		\param scenario Scenario to continue the simulation, with the same ignitions, assets, and vector breaks as this one
+		\param valid Optional validation object, to report why the scenario can't continue this simulation
+		\param name Name of the scenario for validation
+		\retval S_OK Successful, scenario can be stepped
+		\retval E_POINTER scenario is NULL
+		\retval E_INVALIDARG scenario is this scenario
+		\retval ERROR_SCENARIO_BAD_STATE Either scenario isn't running, or the other scenario has already been stepped
+		\retval ERROR_FIRE_INVALID_TIME There is no displayable step at or before time
+		\retval ERROR_PROTOBUF_OBJECT_INVALID The other scenario doesn't match this one
+		\retval E_OUTOFMEMORY Insufficient memory
+	*/
+	virtual NO_THROW HRESULT Simulation_Fork(const HSS_Time::WTime &time, CCWFGM_Scenario *scenario, std::shared_ptr<validation::validation_object> valid, const std::string& name) const;
 
 	/** Given a scenario, this method returns the number of output time steps that have been calculated in the simulation for this fire.  A fire can simultaneously contain statistical information for a variety of scenarios.
 		\param steps Number of output times steps
@@ -688,6 +758,9 @@ public:
 		<li><code>CWFGM_FIRE_STAT_TIMESTEP_REALTIME</code> 64-bit integer.  Number of real-time (clock) seconds to calculate the current display time step
 		<li><code>CWFGM_FIRE_STAT_TIMESTEP_CUMULATIVE_REALTIME</code> 64-bit integer.  Number of real-time (clock) seconds to calculate all display time steps
 		<li><code>CWFGM_FIRE_STAT_TIMESTEP_CUMULATIVE_BURNING_SECS</code> 64-bit integer.  Number of simulated seconds that burning was allowed since the start of the simulation
+		<li><code>CWFGM_FIRE_STAT_PHASE_*_TICKS</code>, <code>CWFGM_FIRE_STAT_PHASE_*_REALTIME</code> 64-bit integer.  Process ticks and real-time (clock) microseconds spent in one phase (advance, simplify, track, unwind, unoverlap, addpoints, stats, assets, stops) of the current display time step
+		<li><code>CWFGM_FIRE_STAT_PHASE_*_NUM_POINTS</code>, <code>CWFGM_FIRE_STAT_PHASE_*_NUM_FRONTS</code>, <code>CWFGM_FIRE_STAT_PHASE_*_NUM_CLIPS</code> 64-bit integer.  Vertices and fire fronts present after the phase, and untangle/clip operations performed during it, summed over the current display time step
+		<li><code>CWFGM_FIRE_STAT_PHASE_*_CUMULATIVE_TICKS</code>, <code>CWFGM_FIRE_STAT_PHASE_*_CUMULATIVE_REALTIME</code> 64-bit integer.  As above, for all display time steps
 		</ul>
 		\param stats Calculated statistic value
 		\sa ICWFGM_Scenario::GetStats
@@ -701,6 +774,17 @@ public:
 		\retval ERROR_FIRE_STAT_UNKNOWN If the stat does not resolve to a known statistic
 	*/
 	virtual NO_THROW HRESULT GetStats(std::uint32_t fire, ICWFGM_Fuel *fuel, HSS_Time::WTime *time, std::uint16_t stat, std::uint16_t discretization, PolymorphicAttribute *stats) const;
+	/** Returns the per-phase timing and counter breakdown (see the CWFGM_FIRE_STAT_PHASE_* statistics) summed over all display time steps up to the requested time.  Requesting the simulation's end time gives a summary of the entire run.
+		\param time Specified GMT time since Midnight January 1, 1600 (on return, time is set to the actual time the summary relates to)
+		\param summary Receives the summed metrics
+
+		\retval E_POINTER The address provided for time or summary is invalid
+		\retval S_OK Successful
+		\retval ERROR_FIRE_INVALID_TIME If the time is invalid
+		\retval ERROR_SCENARIO_BAD_STATE If the function is run without a running scenario
+		\retval SUCCESS_FIRE_NOT_STARTED Fire not yet started (summary is cleared)
+	*/
+	virtual NO_THROW HRESULT GetPhaseSummary(HSS_Time::WTime *time, struct ScenarioStepPhaseMetrics *summary) const;
 	/** This method returns a particular statistic for a specific location in the fire/grid, for a specific simulation at a specific time.  stat must be a valid statistic, as defined in FireEngine_ext.h. time is passed in as a requested time and returned as the actual time that the data is for.
 		\param pt The coordinate
 		\param time Specified GMT time since January 1, 1600
@@ -778,6 +862,25 @@ public:
 		\retval E_OUTOFMEMORY Insufficient memory
 	*/
 	virtual NO_THROW HRESULT GetXYStatsSet(const XY_Point& min_pt, const XY_Point& max_pt, XYStatOptions *options, std::vector<XYStat> *stats);
+	/** Fills a raster of statistics, equivalent to calling GetXYStatsSet() for each of its cells but with the cells calculated in parallel, and with the work
+		to find the fire perimeters near a cell shared between neighbouring cells.
+		\param ll Lower left corner of the raster
+		\param resolution Size of each (square) cell
+		\param cols Number of columns in the raster
+		\param rows Number of rows in the raster
+		\param options Time, interpolation method, etc. as for GetXYStatsSet(), the returned time is not updated
+		\param stats Statistics to calculate for each cell, check GetXYStats for acceptable values.
+		\param values Resized to cols * rows * stats.size().  The values for the cell at column c and row r (counted up from ll) start at index (r * cols + c) * stats.size(), in the order of stats.  Cells outside the fire are 0.
+
+		\retval E_POINTER The address provided for options or values is invalid
+		\retval E_INVALIDARG The raster is empty or the resolution is invalid
+		\retval S_OK Successful
+		\retval ERROR_FIRE_INVALID_TIME If the time is invalid
+		\retval ERROR_FIRE_STAT_UNKNOWN If a stat does not resolve to a known statistic
+		\retval ERROR_SCENARIO_BAD_STATE If the function is run without a running scenario
+		\retval E_OUTOFMEMORY Insufficient memory
+	*/
+	virtual NO_THROW HRESULT GetXYStatsRaster(const XY_Point &ll, double resolution, std::uint16_t cols, std::uint16_t rows, XYStatOptions *options, const std::vector<std::uint16_t> &stats, std::vector<NumericVariant> *values);
 	/** This method returns a count of occurence particular statistic for a specific range of values, given a fire and time.  stat must be a valid statistic, as defined in FireEngine.h 
 		\param fire Index of the fire
 		\param time Specified GMT time since Midnight January 1, 1600
@@ -924,6 +1027,12 @@ public:
 	std::uint16_t		m_initialVertexCount;
 
 	std::uint32_t		m_threadingNumProcessors;	// NOT saved in the FGM as it should be a machine-dependent setting
+	std::uint32_t		m_spillSteps;				// NOT saved in the FGM either, display steps to keep in memory, 0 for all of them
+	std::uint32_t		m_closestCacheSize;			// NOT saved in the FGM either, entries in the closest vertex cache
+	std::uint32_t		m_queueUp,					// NOT saved in the FGM either, parallel thresholds for growth, grid tracking, vector tracking
+						m_queueUpGrid,
+						m_queueUpVector;
+	bool				m_queueUpCalibrate;			// NOT saved in the FGM either, time the first steps to pick the thresholds
 	CRWThreadSemaphore	m_lock;				// This grants access to this CWFGM_Scenario object.
 											// If it's write-only then that means an option or parameter is being changed, or the objects associated
 											// with the scenario are being locked or unlocked, or the m_scenario object is being created/destroyed.
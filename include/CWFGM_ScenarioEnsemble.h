@@ -0,0 +1,146 @@
+/**
+ * WISE_Scenario_Growth_Module: CWFGM_ScenarioEnsemble.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "CWFGM_Scenario.h"
+#include <memory>
+#include <vector>
+
+#ifdef HSS_SHOULD_PRAGMA_PACK
+#pragma pack(push, 8)
+#endif
+
+template<class _type>
+class ScenarioLandscape;
+
+
+/** Results for one member of an ensemble, after CCWFGM_ScenarioEnsemble::Simulation_Run()
+*/
+struct ScenarioEnsembleResult {
+	HRESULT				state;				/* result of the member's last Simulation_Step(), or S_OK if it hasn't been stepped */
+	std::uint32_t		steps;				/* number of calls made to the member's Simulation_Step() */
+	std::uint64_t		realtime;			/* time spent stepping the member, in microseconds */
+	bool				sharedLandscape;	/* true if the member used the ensemble's static vector breaks and asset geometry rather than building its own */
+};
+
+
+/** Runs many variants of a scenario together
+
+	Burn probability and other stochastic work runs many copies of one scenario, changing only the weather stream, ignition, percentile, etc.  Each member
+	is a fully configured CCWFGM_Scenario, and can be queried through its own interface once it has been run.  The ensemble adds two things:
+		- the static vector breaks and asset geometry are built once, by the first member, and shared (read-only) by every other member that uses the
+		  same vector engines, grid origin, resolution, and scaling options; and
+		- the members are stepped concurrently on one thread budget, rather than each member sizing its thread pool for the whole machine.
+
+	Members with FORCE_AFFINITY set take their CPUs from one process-wide table, so they're spread over the machine's cores and NUMA nodes rather
+	than pinned on top of each other, but each is still placed for its own thread count and not for the ensemble's budget.
+*/
+class FIRECOM_API CCWFGM_ScenarioEnsemble {
+public:
+	CCWFGM_ScenarioEnsemble();
+	~CCWFGM_ScenarioEnsemble();
+
+	/** Adds a scenario to the ensemble.
+		\param scenario Scenario to add, it must not currently be running
+		\retval S_OK Successful
+		\retval E_POINTER scenario is NULL
+		\retval ERROR_SCENARIO_BAD_STATE The ensemble or the scenario is running
+		\retval ERROR_SCENARIO_FIRE_ALREADY_ADDED The scenario is already a member of this ensemble
+	*/
+	NO_THROW HRESULT AddMember(CCWFGM_Scenario *scenario);
+	/** Removes a scenario from the ensemble.
+		\param scenario Scenario to remove
+		\retval S_OK Successful
+		\retval E_POINTER scenario is NULL
+		\retval ERROR_SCENARIO_BAD_STATE The ensemble is running
+		\retval ERROR_SCENARIO_FIRE_UNKNOWN The scenario is not a member of this ensemble
+	*/
+	NO_THROW HRESULT RemoveMember(CCWFGM_Scenario *scenario);
+	/** Returns the number of scenarios in the ensemble.
+		\param count Number of members
+		\retval S_OK Successful
+		\retval E_POINTER count is NULL
+	*/
+	NO_THROW HRESULT GetMemberCount(std::uint32_t *count) const;
+	/** Returns the member at the given index.
+		\param index Index of the member
+		\param scenario Returned member
+		\retval S_OK Successful
+		\retval E_POINTER scenario is NULL
+		\retval ERROR_SCENARIO_FIRE_UNKNOWN index is out of range
+	*/
+	NO_THROW HRESULT MemberAtIndex(std::uint32_t index, boost::intrusive_ptr<CCWFGM_Scenario> *scenario) const;
+
+	/** Calls Simulation_Reset() on every member, then builds the shared landscape from the first member and hands it to the others.  Up to
+		numThreads members will run at the same time, and if there are fewer members than threads then the remaining threads are divided between
+		the members' own thread pools.  Each member's MULTITHREADING option is replaced by its share until Simulation_Clear().
+		\param valid Optional validation object, each member's results are named after the ensemble and the member's index
+		\param name Name of the ensemble for validation
+		\param numThreads Thread budget for the whole ensemble, 0 to use every processor
+		\retval S_OK All members are ready to run
+		\retval ERROR_SCENARIO_BAD_STATE The ensemble is already running
+		\retval ERROR_SCENARIO_NO_FIRES The ensemble has no members
+		\retval other Any error from a member's Simulation_Reset(), in which case no member is left running
+	*/
+	NO_THROW HRESULT Simulation_Reset(std::shared_ptr<validation::validation_object> valid, const std::string& name, std::uint32_t numThreads = 0);
+	/** Steps every member to completion, on the thread budget given to Simulation_Reset().
+		\retval S_OK Every member ran to completion
+		\retval ERROR_SCENARIO_BAD_STATE Simulation_Reset() hasn't been called
+		\retval S_FALSE One or more members failed, see GetMemberResult()
+	*/
+	NO_THROW HRESULT Simulation_Run();
+	/** Returns the results for one member from the last Simulation_Run().
+		\param index Index of the member
+		\param result Returned results
+		\retval S_OK Successful
+		\retval E_POINTER result is NULL
+		\retval ERROR_SCENARIO_FIRE_UNKNOWN index is out of range
+	*/
+	NO_THROW HRESULT GetMemberResult(std::uint32_t index, ScenarioEnsembleResult *result) const;
+	/** Calls Simulation_Clear() on every member, restores their MULTITHREADING options, and releases the shared landscape.
+		\retval S_OK Successful
+		\retval ERROR_SCENARIO_BAD_STATE The ensemble isn't running
+	*/
+	NO_THROW HRESULT Simulation_Clear();
+
+#ifndef DOXYGEN_IGNORE_CODE
+private:
+	struct Member {
+		boost::intrusive_ptr<CCWFGM_Scenario>	m_scenario;
+		ScenarioEnsembleResult					m_result;
+		std::uint32_t							m_threads;		// the member's own m_threadingNumProcessors while ours replaces it, else 0
+	};
+
+	struct Iterator;
+
+	std::vector<Member>										m_members;
+	std::shared_ptr<ScenarioLandscape<fireengine_float_type>>	m_landscape;
+	bool													m_reset;
+	std::uint32_t											m_workers;		// members run at the same time
+	CRWThreadSemaphore										m_lock;
+
+	static void budgetMember(Member &member, std::uint32_t numThreads);
+	static void runMember(Member &member);
+	static std::uint32_t AFX_CDECL runMembers(APTR parameter);
+#endif
+};
+
+#ifdef HSS_SHOULD_PRAGMA_PACK
+#pragma pack(pop)
+#endif
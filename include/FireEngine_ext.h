@@ -135,6 +135,75 @@
 #define CWFGM_FIRE_STAT_CUMULATIVE_POLYSET_POLYGON_RETAINED					142
 #define CWFGM_FIRE_STAT_CUMULATIVE_POLYSET_TICKS							143
 
+//	per-phase breakdown of each time step: for each phase, (ticks, realtime (microseconds), vertices, fronts, untangle/clip invocations,
+//	cumulative ticks, cumulative realtime) occupy 7 consecutive ids
+#define CWFGM_FIRE_STAT_PHASE_ADVANCE_TICKS									144
+#define CWFGM_FIRE_STAT_PHASE_ADVANCE_REALTIME								145
+#define CWFGM_FIRE_STAT_PHASE_ADVANCE_NUM_POINTS							146
+#define CWFGM_FIRE_STAT_PHASE_ADVANCE_NUM_FRONTS							147
+#define CWFGM_FIRE_STAT_PHASE_ADVANCE_NUM_CLIPS								148
+#define CWFGM_FIRE_STAT_PHASE_ADVANCE_CUMULATIVE_TICKS						149
+#define CWFGM_FIRE_STAT_PHASE_ADVANCE_CUMULATIVE_REALTIME					150
+#define CWFGM_FIRE_STAT_PHASE_SIMPLIFY_TICKS								151
+#define CWFGM_FIRE_STAT_PHASE_SIMPLIFY_REALTIME								152
+#define CWFGM_FIRE_STAT_PHASE_SIMPLIFY_NUM_POINTS							153
+#define CWFGM_FIRE_STAT_PHASE_SIMPLIFY_NUM_FRONTS							154
+#define CWFGM_FIRE_STAT_PHASE_SIMPLIFY_NUM_CLIPS							155
+#define CWFGM_FIRE_STAT_PHASE_SIMPLIFY_CUMULATIVE_TICKS						156
+#define CWFGM_FIRE_STAT_PHASE_SIMPLIFY_CUMULATIVE_REALTIME					157
+#define CWFGM_FIRE_STAT_PHASE_TRACK_TICKS									158
+#define CWFGM_FIRE_STAT_PHASE_TRACK_REALTIME								159
+#define CWFGM_FIRE_STAT_PHASE_TRACK_NUM_POINTS								160
+#define CWFGM_FIRE_STAT_PHASE_TRACK_NUM_FRONTS								161
+#define CWFGM_FIRE_STAT_PHASE_TRACK_NUM_CLIPS								162
+#define CWFGM_FIRE_STAT_PHASE_TRACK_CUMULATIVE_TICKS						163
+#define CWFGM_FIRE_STAT_PHASE_TRACK_CUMULATIVE_REALTIME						164
+#define CWFGM_FIRE_STAT_PHASE_UNWIND_TICKS									165
+#define CWFGM_FIRE_STAT_PHASE_UNWIND_REALTIME								166
+#define CWFGM_FIRE_STAT_PHASE_UNWIND_NUM_POINTS								167
+#define CWFGM_FIRE_STAT_PHASE_UNWIND_NUM_FRONTS								168
+#define CWFGM_FIRE_STAT_PHASE_UNWIND_NUM_CLIPS								169
+#define CWFGM_FIRE_STAT_PHASE_UNWIND_CUMULATIVE_TICKS						170
+#define CWFGM_FIRE_STAT_PHASE_UNWIND_CUMULATIVE_REALTIME					171
+#define CWFGM_FIRE_STAT_PHASE_UNOVERLAP_TICKS								172
+#define CWFGM_FIRE_STAT_PHASE_UNOVERLAP_REALTIME							173
+#define CWFGM_FIRE_STAT_PHASE_UNOVERLAP_NUM_POINTS							174
+#define CWFGM_FIRE_STAT_PHASE_UNOVERLAP_NUM_FRONTS							175
+#define CWFGM_FIRE_STAT_PHASE_UNOVERLAP_NUM_CLIPS							176
+#define CWFGM_FIRE_STAT_PHASE_UNOVERLAP_CUMULATIVE_TICKS					177
+#define CWFGM_FIRE_STAT_PHASE_UNOVERLAP_CUMULATIVE_REALTIME					178
+#define CWFGM_FIRE_STAT_PHASE_ADDPOINTS_TICKS								179
+#define CWFGM_FIRE_STAT_PHASE_ADDPOINTS_REALTIME							180
+#define CWFGM_FIRE_STAT_PHASE_ADDPOINTS_NUM_POINTS							181
+#define CWFGM_FIRE_STAT_PHASE_ADDPOINTS_NUM_FRONTS							182
+#define CWFGM_FIRE_STAT_PHASE_ADDPOINTS_NUM_CLIPS							183
+#define CWFGM_FIRE_STAT_PHASE_ADDPOINTS_CUMULATIVE_TICKS					184
+#define CWFGM_FIRE_STAT_PHASE_ADDPOINTS_CUMULATIVE_REALTIME					185
+#define CWFGM_FIRE_STAT_PHASE_STATS_TICKS									186
+#define CWFGM_FIRE_STAT_PHASE_STATS_REALTIME								187
+#define CWFGM_FIRE_STAT_PHASE_STATS_NUM_POINTS								188
+#define CWFGM_FIRE_STAT_PHASE_STATS_NUM_FRONTS								189
+#define CWFGM_FIRE_STAT_PHASE_STATS_NUM_CLIPS								190
+#define CWFGM_FIRE_STAT_PHASE_STATS_CUMULATIVE_TICKS						191
+#define CWFGM_FIRE_STAT_PHASE_STATS_CUMULATIVE_REALTIME						192
+#define CWFGM_FIRE_STAT_PHASE_ASSETS_TICKS									193
+#define CWFGM_FIRE_STAT_PHASE_ASSETS_REALTIME								194
+#define CWFGM_FIRE_STAT_PHASE_ASSETS_NUM_POINTS								195
+#define CWFGM_FIRE_STAT_PHASE_ASSETS_NUM_FRONTS								196
+#define CWFGM_FIRE_STAT_PHASE_ASSETS_NUM_CLIPS								197
+#define CWFGM_FIRE_STAT_PHASE_ASSETS_CUMULATIVE_TICKS						198
+#define CWFGM_FIRE_STAT_PHASE_ASSETS_CUMULATIVE_REALTIME					199
+#define CWFGM_FIRE_STAT_PHASE_STOPS_TICKS									200
+#define CWFGM_FIRE_STAT_PHASE_STOPS_REALTIME								201
+#define CWFGM_FIRE_STAT_PHASE_STOPS_NUM_POINTS								202
+#define CWFGM_FIRE_STAT_PHASE_STOPS_NUM_FRONTS								203
+#define CWFGM_FIRE_STAT_PHASE_STOPS_NUM_CLIPS								204
+#define CWFGM_FIRE_STAT_PHASE_STOPS_CUMULATIVE_TICKS						205
+#define CWFGM_FIRE_STAT_PHASE_STOPS_CUMULATIVE_REALTIME						206
+#define CWFGM_FIRE_STAT_PHASE_FIRST											CWFGM_FIRE_STAT_PHASE_ADVANCE_TICKS
+#define CWFGM_FIRE_STAT_PHASE_LAST											CWFGM_FIRE_STAT_PHASE_STOPS_CUMULATIVE_REALTIME
+#define CWFGM_FIRE_STAT_PHASE_STRIDE										7
+
 
 //	***** defines to set and get the type of fire ignition
 #define CWFGM_FIRE_IGNITION_UNDEFINED		0
@@ -183,7 +252,7 @@
 #define CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_WIND	22	// whether to apply voronoi regions to weather stations to determine wind data
 #define CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_WIND_VECTOR	27	// if CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_WIND is on, then if this bit is on, then the approach defined in http://colaweb.gmu.edu/dev/clim301/lectures/wind/wind-uv.html will be used
 #define CWFGM_SCENARIO_OPTION_SUPPRESS_TIGHT_CONCAVE_ADDPOINT	26	// if this bit is set, then we limit the sine curve to '1' when considering adding points to a convex portion of the hull
-#define CWFGM_SCENARIO_OPTION_FORCE_AFFINITY 31				// force threads to specific affinities
+#define CWFGM_SCENARIO_OPTION_FORCE_AFFINITY 31				// force threads to specific affinities, grouped by NUMA node and avoiding CPUs other scenarios have pinned
 #define CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_TEMP_RH 29	// whether to calculate spatially explicit temp, dew point, and RH values
 #define CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_CALCFWI 24	// whether to apply spatial calc's to FWI (TRUE) or simply apply IDW to FWI values
 #define CWFGM_SCENARIO_OPTION_WEATHER_INTERPOLATE_HISTORY 23	// whether to apply cumulative effects of weather patches, etc. to FWI values (only valid with
@@ -193,6 +262,15 @@
 #define CWFGM_SCENARIO_OPTION_WEATHER_ALTERNATE_CACHE	31	// whether to use the simulation (std) or interactive (alternate) cache for spatial interp. calc's
 #define CWFGM_SCENARIO_OPTION_WEATHER_IGNORE_CACHE		30 // if we're just exporting a full grid of exports, we'll never get a cache hit so no point in trying
 #define CWFGM_SCENARIO_OPTION_PURGE_NONDISPLAYABLE	16	// whether to clear non-displayable time steps, to save on memory overhead
+#define CWFGM_SCENARIO_OPTION_SPILL_STEPS			91	// number of recent display steps to keep in memory, older perimeters are spilled to a memory mapped file (0 keeps everything)
+#define CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_SIZE	92	// entries in the closest vertex cache used by statistics queries
+#define CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_HITS	93	// read only, closest vertex cache hits since the simulation was reset
+#define CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_MISSES	94	// read only, closest vertex cache misses
+#define CWFGM_SCENARIO_OPTION_CLOSEST_CACHE_EVICTIONS	95	// read only, closest vertex cache entries replaced by other points
+#define CWFGM_SCENARIO_OPTION_QUEUE_UP				96	// vertices needed before growth (FBP) calculations are handed to the worker threads, also how many each worker claims at a time
+#define CWFGM_SCENARIO_OPTION_QUEUE_UP_GRID			97	// vertices in a fire front needed before tracking against the grid is done in parallel
+#define CWFGM_SCENARIO_OPTION_QUEUE_UP_VECTOR		98	// vertices in a fire front needed before tracking against vector breaks and other fires is done in parallel
+#define CWFGM_SCENARIO_OPTION_QUEUE_UP_CALIBRATE	99	// whether to replace the above by timing the first steps of the simulation
 #define CWFGM_SCENARIO_OPTION_GRID_DECIMATION		88	// whether to pull grid points to a specific grid
 #define CWFGM_SCENARIO_OPTION_FALSE_ORIGIN			33	// whether or not to apply the grid's (original) false origin to FireEngine calc's
 #define CWFGM_SCENARIO_OPTION_FALSE_SCALING			34	// whether or not to apply the grid's fuel scaling to FireEngine calc's
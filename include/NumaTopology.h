@@ -0,0 +1,64 @@
+/**
+ * WISE_Scenario_Growth_Module: NumaTopology.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __NUMATOPOLOGY_H
+#define __NUMATOPOLOGY_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Where worker threads go when CWFGM_SCENARIO_OPTION_FORCE_AFFINITY is set.  The machine's NUMA nodes, and which logical CPUs are SMT
+// siblings of each other, are read once from /sys (elsewhere the machine is treated as one node with no siblings).  Every scenario in
+// the process takes its CPUs from the one table, so two scenarios aren't pinned on top of each other: a placement goes to the least used
+// CPUs, whole cores before their siblings, starting on the least used node and spilling onto the next only once that one's full.  The
+// CPUs handed back are grouped by node, so workers 0..n-1 (and the runs of work they start on) stay together on a node.
+
+class NumaTopology {
+public:
+	struct placement {
+		std::vector<std::uint32_t>	cpu, node;		// per worker
+	};
+
+	static NumaTopology &Instance();
+
+	std::uint32_t NumNodes() const					{ return m_numNodes; };
+	std::uint32_t NumCPUs() const					{ return (std::uint32_t)m_cpus.size(); };
+
+	placement Acquire(std::uint32_t threads);		// hand back to Release() when the workers go away
+	void Release(const placement &p);
+
+	static bool Pin(std::uint32_t cpu);				// the calling thread
+	static void SetWorkerSlot(std::uint32_t slot);	// the calling worker's index into its pool's placement, set when it's pinned
+	static std::uint32_t WorkerSlot();				// ~0 for a thread that hasn't been placed
+
+private:
+	struct cpuEntry {
+		std::uint32_t	id, node;
+		bool			sibling;					// another logical CPU on the same core comes before this one
+		std::uint32_t	used;						// workers currently pinned here, from every scenario
+	};
+
+	NumaTopology();
+
+	std::vector<cpuEntry>	m_cpus;					// grouped by node
+	std::uint32_t			m_numNodes;
+	std::mutex				m_lock;					// guards the use counts
+};
+
+#endif
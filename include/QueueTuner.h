@@ -0,0 +1,113 @@
+/**
+ * WISE_Scenario_Growth_Module: QueueTuner.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QUEUETUNER_H
+#define __QUEUETUNER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+// Decides when a per-vertex phase is worth handing to the worker threads, and how many vertices each worker claims at a time.  The
+// values are either fixed, or calibrated over the first steps of a simulation: runs of the phase alternate between serial and parallel,
+// the serial runs give the cost of a vertex and the parallel runs the fixed cost of waking the workers, and the threshold is where the
+// two break even.  Chunks are sized so each one is a few tens of microseconds of work.
+
+class QueueTuner {
+public:
+	QueueTuner()													{ Reset(64, 64, false); };
+
+	void Reset(std::uint32_t threshold, std::uint32_t chunk, bool calibrate) {
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_threshold = (std::max)(threshold, 1u);
+		m_chunk = (std::max)(chunk, 1u);
+		m_calibrating = calibrate;
+		m_toggle = 0;
+		m_serialSamples = m_parallelSamples = 0;
+		m_serialItems = m_serialNanos = 0.0;
+		m_parallelItems = m_parallelNanos = 0.0;
+		m_threads = 1;
+	}
+
+	bool Parallel(std::uint32_t n) {								// whether a run over n vertices should go to the workers
+		if (m_calibrating.load(std::memory_order_relaxed) && (n >= CALIBRATE_MIN))
+			return (m_toggle.fetch_add(1, std::memory_order_relaxed) & 1) ? true : false;
+		return n > m_threshold.load(std::memory_order_relaxed);
+	}
+
+	void Record(std::uint32_t n, bool parallel, std::uint32_t threads, std::chrono::steady_clock::time_point start) {
+		if ((!m_calibrating.load(std::memory_order_relaxed)) || (n < CALIBRATE_MIN))
+			return;
+		double nanos = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+		std::lock_guard<std::mutex> guard(m_lock);
+		if (!m_calibrating)
+			return;
+		if (parallel) {
+			m_parallelItems += n;
+			m_parallelNanos += nanos;
+			m_threads = (std::max)(threads, 1u);
+			m_parallelSamples++;
+		} else {
+			m_serialItems += n;
+			m_serialNanos += nanos;
+			m_serialSamples++;
+		}
+		if ((m_serialSamples >= CALIBRATE_SAMPLES) && (m_parallelSamples >= CALIBRATE_SAMPLES))
+			calibrate();
+	}
+
+	std::uint32_t Threshold() const									{ return m_threshold.load(std::memory_order_relaxed); };
+	std::uint32_t Chunk() const										{ return m_chunk.load(std::memory_order_relaxed); };
+	bool Calibrating() const										{ return m_calibrating.load(std::memory_order_relaxed); };
+
+private:
+	static constexpr std::uint32_t CALIBRATE_MIN = 32;				// smaller runs are too short to time
+	static constexpr std::uint32_t CALIBRATE_SAMPLES = 4;			// of each kind before deciding
+	static constexpr std::uint32_t THRESHOLD_MAX = 0x100000;
+	static constexpr double CHUNK_NANOS = 25000.0;
+
+	void calibrate() {
+		double cost = m_serialNanos / m_serialItems;				// per vertex
+		if (cost <= 0.0)
+			cost = 1.0;
+		double share = 1.0 - 1.0 / m_threads,
+			overhead = (m_parallelNanos - m_parallelItems * cost / m_threads) / m_parallelSamples;
+		if (overhead < 0.0)
+			overhead = 0.0;
+
+		double threshold = (share > 0.0) ? (overhead / (cost * share)) : (double)THRESHOLD_MAX;
+		double chunk = CHUNK_NANOS / cost;
+		m_threshold = (std::uint32_t)std::clamp(threshold, (double)CALIBRATE_MIN, (double)THRESHOLD_MAX);
+		m_chunk = (std::uint32_t)std::clamp(chunk, 8.0, 1024.0);
+		m_calibrating = false;
+	}
+
+	std::atomic<std::uint32_t>	m_threshold, m_chunk;
+	std::atomic<bool>			m_calibrating;
+	std::atomic<std::uint32_t>	m_toggle;							// alternates serial and parallel runs while calibrating
+
+	std::mutex					m_lock;								// guards the samples
+	std::uint32_t				m_serialSamples, m_parallelSamples, m_threads;
+	double						m_serialItems, m_serialNanos,
+								m_parallelItems, m_parallelNanos;
+};
+
+#endif
@@ -23,7 +23,9 @@
 #include "scenario.h"
 #include "StopCondition.h"
 #include <boost/multi_array.hpp>
+#include <atomic>
 #include <chrono>
+#include <cstring>
 
 #ifdef HSS_SHOULD_PRAGMA_PACK
 #pragma pack(push, 8)
@@ -31,6 +33,8 @@
 
 template<class _type>
 class Scenario;
+template<class _type>
+class nearestPointTree;
 
 template<class _type>
 class ScenarioFire : public MinNode, public XY_PolyLL_Set<FireFront<_type>, _type> {		// this class only exists (now) so we can keep a set of each fire front on a list, where each fire front
@@ -75,7 +79,7 @@ public:									// one polygon defining (part of) a specific fire - so all fire
 	virtual FireFront<_type>*New() const override;
 	virtual FireFront<_type>*NewCopy(const XYPolyLLType&toCopy) const override;
 
-	bool AdvanceFire(const _type scale);
+	bool AdvanceFire(const _type scale, bool alone);
 	void StatsFires();
 
 	void AddFireFront(FireFront<_type> *ff);
@@ -141,6 +145,45 @@ public:
 };
 
 
+enum class ScenarioStepPhase : std::uint16_t {		// order matches the CWFGM_FIRE_STAT_PHASE_* blocks in FireEngine_ext.h
+	ADVANCE = 0,
+	SIMPLIFY,
+	TRACK,
+	UNWIND,
+	UNOVERLAP,
+	ADDPOINTS,
+	STATS,
+	ASSETS,
+	STOPS,
+	COUNT
+};
+
+
+struct ScenarioStepPhaseMetrics {
+	static constexpr std::uint16_t NUM_PHASES = (std::uint16_t)ScenarioStepPhase::COUNT;
+
+	std::uint64_t	ticks[NUM_PHASES],				// process ticks, same clock as m_tickCountStart/m_tickCountEnd
+					realtime[NUM_PHASES],			// wall clock, in microseconds
+					points[NUM_PHASES],				// vertices present when the phase completed
+					fronts[NUM_PHASES],				// fire fronts present when the phase completed
+					clips[NUM_PHASES];				// untangler and polyset invocations made during the phase
+
+	ScenarioStepPhaseMetrics()						{ Clear(); }
+	void Clear()									{ memset(this, 0, sizeof(*this)); }
+
+	ScenarioStepPhaseMetrics &operator+=(const ScenarioStepPhaseMetrics &other) {
+		for (std::uint16_t i = 0; i < NUM_PHASES; i++) {
+			ticks[i] += other.ticks[i];
+			realtime[i] += other.realtime[i];
+			points[i] += other.points[i];
+			fronts[i] += other.fronts[i];
+			clips[i] += other.clips[i];
+		}
+		return *this;
+	}
+};
+
+
 template<class _type>
 class ScenarioTimeStep : public MinNode {
 	using XYPointType = XY_PointTempl<_type>;
@@ -157,6 +200,7 @@ public:
 	DECLARE_OBJECT_CACHE_MT(ScenarioTimeStep<_type>, ScenarioTimeStep)
 
 	ScenarioTimeStep(Scenario<_type> *scenario, const WTime &event_end, bool simulation_end);
+	ScenarioTimeStep(Scenario<_type> *scenario, const WTime &time);		// for restoring a checkpoint, the time is already known and the caller fills in the rest
 	virtual ~ScenarioTimeStep();
 
 	ScenarioTimeStep<_type> *LN_Succ() const	{ return (ScenarioTimeStep<_type>*)MinNode::LN_Succ(); };
@@ -172,6 +216,8 @@ public:
 
 	std::uint64_t																	m_memoryBegin, m_memoryEnd;
 
+	StepArena																		m_arena;				// backs this step's fronts and vertices
+
 protected:
 	XYPointType																		m_curr_ll, m_curr_ur;	// in UTM
 
@@ -201,10 +247,13 @@ public:
 	RefList<XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>, XY_PolyLLPolyRef<_type>>	m_staticVectorBreaksLL;
 	std::uint32_t																	m_displayable : 1,		// if this is a displayable time step
 																					m_evented : 1,			// if this time step ended on an event (if false, then it ended due to logic around ROS, etc.)
-																				    m_ignitioned : 1;
+																				    m_ignitioned : 1,
+																					m_spilled : 1,			// the perimeters are in the scenario's spill file, only the fires themselves are in memory
+																					m_final : 1;			// the perimeters won't change any more (PostCalculation() is done), so queries can be indexed
 	std::uint32_t																	m_assetCount;
 	UnwindMetrics																	m_advanceMetrics,
 																					m_setMetrics;
+	ScenarioStepPhaseMetrics														m_phaseMetrics;		// like m_tickCountStart/End, only filled in on the last time step from each call to Scenario::Step()
 	StopConditionState																m_stopConditions;
 
 	double MinimumROSRatio() const;
@@ -216,14 +265,17 @@ public:
 
 	bool BoundingBox(XYRectangleType &bbox) const;
 	std::int32_t PointInArea(const XYPointType &point) const;
+	void PointsInArea(const XYPointType *pts, std::uint32_t cnt, std::uint8_t *inside) const;	// (PointInArea() != 0) for each point, for large batches
 	FirePoint<_type> *GetNearestPoint(const XYPointType &pt, bool all_points, FireFront<_type> **firefront, bool must_be_inside) const;
+	void ClearNearest();							// drops the nearest point index, for when the perimeters are removed or rebuilt
 
 	void PreCalculation();
 	void PostCalculation();
 
 	bool AdvanceFires();							// copies fires from the previous step, "grows" them based on the length of
 													// the time step from prev to this, and smooths automatically
-	void SimplifyFires();								// here, we get rid of points that are too close to each other
+	void SimplifyFires(bool simplify);				// here, we get rid of points that are too close to each other, and fronts small enough
+													// not to want the whole pool carry straight on through grid tracking
 	void SimplifyFiresNull();
 	void UnWindFires(bool advance);					// removes knots from existing fires
 	void TrackFires();								// ray traces looking for barriers
@@ -237,6 +289,7 @@ public:
 	bool CheckStops(HRESULT &condition);			// checks if any conditions for early abort/stop of the simulation is present, returns whether the simulation is done
 
 	std::uint32_t NumActivePoints() const;
+	void PhaseCounts(std::uint64_t &points, std::uint64_t &fronts, std::uint64_t &clips) const;
 	HRESULT RetrieveStat(const std::uint16_t stat, double *stats) const;
 	HRESULT RetrieveStat(const std::uint16_t stat, PolymorphicAttribute* stats) const;
 	HRESULT RetrieveStat(const std::uint16_t stat, const double greater_equal, const double less_than, double*stats) const;
@@ -249,11 +302,16 @@ private:
 	void addIgnition(IgnitionNode<_type> *ignition);
 	void buildVectorBreaks();
 	void reviewStaticBreaks();
-	void advanceFire(ActiveFire<_type> *af);
+	void advanceFire(ActiveFire<_type> *af, std::vector<ScenarioFire<_type>*> &copies);	// the new fire's fronts are left for copyFires()
+	void copyFires(std::vector<ScenarioFire<_type>*> &copies);
 	void retrieveDStat(std::uint16_t stat, ICWFGM_Fuel* fuel, std::uint16_t discretize, ScenarioTimeStep<_type>* sts_prev, double* stats, double step,
 		const std::uint64_t cx, const std::uint64_t cy, boost::multi_array<typename Scenario<_type>::closest_calc, 2>& pt_array, CThreadSemaphore* add_lock) const;
 
 	bool findFirstIgnitionCentroid(XY_PointTempl<_type>& centroid) const;
+	nearestPointTree<_type> *nearestTree() const;
+
+	mutable std::atomic<nearestPointTree<_type>*>									m_nearest;		// built on the first GetNearestPoint() once m_final is set
+	mutable CThreadSemaphore														m_nearestLock;
 
 public:
 	void RecordActiveFires();
@@ -0,0 +1,172 @@
+/**
+ * WISE_Scenario_Growth_Module: ShardedValueCache.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SHARDEDVALUECACHE_H
+#define __SHARDEDVALUECACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+// Drop-in for ValueCacheTempl_MT when many threads query at once.  Entries are spread over cache line aligned shards, each a 4-way set
+// associative table, and every entry is guarded by its own sequence counter: a lookup never blocks, and a store only skips an entry that
+// another thread is part way through writing.  Keys are compared and hashed bytewise, so they must be plain data without padding.
+// Clear() is O(1), it starts a new generation and entries from older ones read as empty.
+
+template<class _key, class _value>
+class ShardedValueCache {
+public:
+	ShardedValueCache(std::uint32_t capacity, std::uint32_t threads) {
+		m_shardBits = 0;
+		while ((1u << m_shardBits) < threads)
+			m_shardBits++;
+		std::uint32_t shards = 1u << m_shardBits;
+
+		std::uint32_t sets = (capacity + shards * WAYS - 1) / (shards * WAYS);
+		m_setBits = 0;
+		while ((1u << m_setBits) < sets)
+			m_setBits++;
+
+		m_shards.reset(new shard[shards]);
+		for (std::uint32_t i = 0; i < shards; i++)
+			m_shards[i].sets.reset(new set[1ull << m_setBits]);
+		m_generation = 1;
+	}
+
+	_value *Retrieve(const _key *key, _value *value) {
+		std::uint64_t h = hash(key);
+		shard &s = m_shards[h & ((1ull << m_shardBits) - 1)];
+		set &st = s.sets[(h >> m_shardBits) & ((1ull << m_setBits) - 1)];
+		std::uint64_t generation = m_generation.load(std::memory_order_acquire);
+
+		for (std::uint32_t i = 0; i < WAYS; i++) {
+			entry &e = st.way[i];
+			std::uint64_t seq = e.seq.load(std::memory_order_acquire);
+			if (seq & 1)
+				continue;
+			std::uint64_t g = e.generation;
+			_key k;
+			_value v;
+			std::memcpy((void *)&k, &e.key, sizeof(_key));
+			std::memcpy((void *)&v, &e.value, sizeof(_value));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (e.seq.load(std::memory_order_relaxed) != seq)
+				continue;							// torn by a store, treat it as a miss
+			if ((g == generation) && (!std::memcmp(&k, key, sizeof(_key)))) {
+				*value = v;
+				s.hits.fetch_add(1, std::memory_order_relaxed);
+				return value;
+			}
+		}
+		s.misses.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	void Store(const _key *key, const _value *value) {
+		std::uint64_t h = hash(key);
+		shard &s = m_shards[h & ((1ull << m_shardBits) - 1)];
+		set &st = s.sets[(h >> m_shardBits) & ((1ull << m_setBits) - 1)];
+		std::uint64_t generation = m_generation.load(std::memory_order_acquire);
+
+		std::uint32_t victim = WAYS;
+		for (std::uint32_t i = 0; i < WAYS; i++) {
+			entry &e = st.way[i];
+			if (e.generation != generation) {
+				if (victim == WAYS)
+					victim = i;
+			} else if (!std::memcmp(&e.key, key, sizeof(_key))) {
+				victim = i;							// refresh it in place
+				break;
+			}
+		}
+		bool evicting = false;
+		if (victim == WAYS) {
+			victim = st.next.fetch_add(1, std::memory_order_relaxed) & (WAYS - 1);
+			evicting = true;
+		}
+
+		entry &e = st.way[victim];
+		std::uint64_t seq = e.seq.load(std::memory_order_relaxed);
+		if ((seq & 1) || (!e.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)))
+			return;									// someone else is writing it, theirs is as good as ours
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy((void *)&e.key, key, sizeof(_key));
+		std::memcpy((void *)&e.value, value, sizeof(_value));
+		e.generation = generation;
+		e.seq.store(seq + 2, std::memory_order_release);
+		if (evicting)
+			s.evictions.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void Clear() {
+		m_generation.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	std::uint64_t Capacity() const			{ return (WAYS << m_setBits) << m_shardBits; };
+	void Counters(std::uint64_t &hits, std::uint64_t &misses, std::uint64_t &evictions) const {
+		hits = misses = evictions = 0;
+		for (std::uint32_t i = 0; i < (1u << m_shardBits); i++) {
+			hits += m_shards[i].hits.load(std::memory_order_relaxed);
+			misses += m_shards[i].misses.load(std::memory_order_relaxed);
+			evictions += m_shards[i].evictions.load(std::memory_order_relaxed);
+		}
+	}
+
+private:
+	static constexpr std::uint32_t WAYS = 4;
+
+	struct entry {
+		std::atomic<std::uint64_t>	seq{ 0 };		// odd while being written
+		std::uint64_t				generation{ 0 };
+		_key						key;
+		_value						value;
+	};
+
+	struct set {
+		entry						way[WAYS];
+		std::atomic<std::uint32_t>	next{ 0 };		// round robin victim once every way is in use
+	};
+
+	struct alignas(64) shard {
+		std::unique_ptr<set[]>		sets;
+		std::atomic<std::uint64_t>	hits{ 0 },
+									misses{ 0 },
+									evictions{ 0 };
+	};
+
+	static std::uint64_t hash(const _key *key) {	// FNV-1a, then mixed so the low bits pick the shard
+		const unsigned char *b = (const unsigned char *)key;
+		std::uint64_t h = 0xcbf29ce484222325ull;
+		for (size_t i = 0; i < sizeof(_key); i++) {
+			h ^= b[i];
+			h *= 0x100000001b3ull;
+		}
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	std::unique_ptr<shard[]>		m_shards;
+	std::uint32_t					m_shardBits,
+									m_setBits;
+	std::atomic<std::uint64_t>		m_generation;
+};
+
+#endif
@@ -0,0 +1,101 @@
+/**
+ * WISE_Scenario_Growth_Module: StepArena.h
+ * Copyright (C) 2023  WISE
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __STEPARENA_H
+#define __STEPARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Backs the geometry (fire fronts and their vertices) of one time step.  While a StepArena::Scope is open on a thread, New() hands out
+// memory from that arena with a pointer bump, from blocks shared by every thread building the step; a vertex that's deleted part way through
+// the step goes on a free list for the next one of its size, kept per worker so the workers don't contend for it.  Nothing is returned to
+// the heap until the arena itself goes (with its step, when it's purged or stepped back over) or Release() is called once everything in it
+// is gone (when its perimeters are spilled).  Outside a scope, New() falls back to the heap, so anything created by a query, an export, or
+// the polygon library's own threads still works.  Every allocation starts with a small header naming its arena, so Free() can tell the two
+// apart.
+
+class StepArena {
+public:
+	StepArena();
+	StepArena(const StepArena &) = delete;
+	StepArena &operator=(const StepArena &) = delete;
+	~StepArena();
+
+	void *Allocate(size_t bytes);						// thread safe, zeroed
+	void Release();										// hands every block back, only once Live() is 0 and nothing is allocating
+	std::int64_t Live() const							{ return m_live.load(std::memory_order_relaxed); };
+	std::uint64_t Reserved() const						{ return m_reserved.load(std::memory_order_relaxed); };	// bytes of blocks held
+
+	static void *New(size_t bytes);						// for a class's operator new, from Current() or the heap
+	static void Free(void *memory);						// for the matching operator delete
+	static StepArena *Current();
+
+	class Scope {										// routes New() on this thread to arena until it closes, arena may be nullptr
+	public:
+		Scope(StepArena *arena);
+		~Scope();
+	private:
+		StepArena	*m_prev;
+	};
+
+private:
+	static constexpr size_t BLOCK_SIZE = 1024 * 1024;
+	static constexpr size_t HEADER = 16;				// keeps what follows 16 byte aligned
+	static constexpr std::uint32_t SIZE_CLASSES = 4;	// only a couple of object sizes come through here
+	static constexpr std::uint32_t FREE_SLOTS = 64;		// workers with their own free lists, any other thread uses m_shared
+
+	struct block {
+		block						*next;
+		size_t						size;
+		std::atomic<size_t>			used;
+	};
+	struct freeNode {
+		freeNode					*next;
+	};
+	struct sizeClass {
+		size_t						bytes;			// 0 for unused
+		freeNode					*head;
+		std::atomic<std::uint32_t>	count;			// checked before taking m_freeLock, for m_shared
+	};
+	struct freeList {
+		sizeClass					classes[SIZE_CLASSES];
+		freeList();
+		void clear();
+	};
+
+	void *bump(size_t bytes);
+	void recycle(void *memory, size_t bytes);
+	static sizeClass *findClass(freeList *list, size_t bytes, bool add);
+	static void *pop(freeList *list, size_t bytes);
+	static void push(freeList *list, void *memory, size_t bytes);
+
+	std::atomic<block*>		m_current;
+	block					*m_blocks;				// every block, for Release()
+	std::mutex				m_blockLock;
+	std::mutex				m_freeLock;				// for m_shared, a worker's own list is only touched by that worker
+	freeList				m_shared;
+	std::atomic<freeList*>	m_slots[FREE_SLOTS];	// by NumaTopology::WorkerSlot(), made on the worker's first Free()
+	std::atomic<std::int64_t>	m_live;
+	std::atomic<std::uint64_t>	m_reserved;
+};
+
+#endif
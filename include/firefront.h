@@ -19,6 +19,7 @@
 #ifndef __FIREFRONT_H
 #define __FIREFRONT_H
 
+#include <atomic>
 #include <type_traits>
 
 #include "firestatestats.h"
@@ -52,7 +53,6 @@ public:
 
 	friend ScenarioFire<_type>;
 	friend std::uint32_t AFX_CDECL stepVoxelInit(APTR parameter);
-	friend std::uint32_t AFX_CDECL advancePointInit(APTR parameter);
 	friend std::uint32_t AFX_CDECL stepVectorInit(APTR parameter);
 	template<class T>
 	friend int stepVoxelCallback(APTR parameter, const  XYZ_PointTempl<T> *entry, const  XYZ_PointTempl<T> *exit);
@@ -70,7 +70,8 @@ public:
 	using FireFrontStats<_type>::SetPoint;
 
 public:
-	DECLARE_OBJECT_CACHE_MT(FireFront<_type>, FireFront)
+	static void *operator new(size_t size)			{ return StepArena::New(size); };	// from the arena of the step being built
+	static void operator delete(void *p)			{ StepArena::Free(p); };
 
 	FireFront();							// this constructor is actually never called - it's just here to allow the template class to compile
 	FireFront(const XYPolyConstType &ff);
@@ -93,9 +94,9 @@ public:
 
 	FirePoint<_type> *GetNearestPoint(const XYPointType &pt, bool all_points);
 
-	bool AdvanceFire(const _type scale);
+	bool AdvanceFire(const _type scale, bool alone);				// alone when no other fire is being advanced, so its vertices can go over the pool
 	std::uint32_t Simplify();
-	void TrackFireGrid();
+	void TrackFireGrid(bool multithread = true);		// multithread false when the caller's already on a worker
 	void TrackFireVector();
 	void AddPoints();
 	void GrowPoints();
@@ -105,8 +106,7 @@ protected:
 
 private:
 	void CopyPoints(const XYPolyLLType &toCopy, std::uint32_t status);
-	bool advancePoint(const _type scale, const FirePoint<_type> *prev, FirePoint<_type> *curr, const FirePoint<_type> *next,
-	    const XYPointType &prev_e_ros, const XYPointType &curr_e_ros, const XYPointType &next_e_ros);
+	bool advancePoint(const _type scale, FirePoint<_type> *curr);
 	void equiDistantPoints(const FirePoint<_type> *start, const FirePoint<_type> *end, _type dist_factor);
 
 	int stepVoxel(APTR parameter, const XYZPointType *entry, const XYZPointType *exit);
@@ -151,6 +151,13 @@ public:
 #include "firestatecache.h"
 
 
+template<class _type>
+struct growTerrain {												// a vertex's elevation data, fetched once per step and shared with its neighbours
+	double z, aspect, azimuth;
+	grid::TerrainValue elev_valid, terrain_valid;
+};
+
+
 template<class _type>
 struct growVoxelParms {
 	FireFront<_type> *self;
@@ -166,22 +173,59 @@ struct growVoxelParms {
 	ICWFGM_Target* target;
 	std::uint32_t target_idx, target_sub_idx;
 	std::uint32_t queue_up;
+	growTerrain<_type> *terrain;								// one per vertex of self, in list order, only prefetched where a neighbour is active
+	std::uint32_t num_terrain;
+};
+
+
+template<class _type>
+struct growPointStruct {
+	FirePoint<_type> *fp;
+	struct growVoxelParms<_type> *gvs;
+	std::uint32_t index;										// fp's position in its front, for finding its terrain and its neighbours'
 };
 
+template<class _type>
+struct growTerrainPoint {
+	const FirePoint<_type> *fp;
+	growTerrain<_type> *terrain;
+};
+
+template<class _type>
+struct growTerrainIterator {
+	growTerrainPoint<_type> *points;							// every vertex whose terrain is needed this step
+	std::uint32_t num_points, chunk;
+	std::atomic<std::uint32_t> next;							// next chunk to claim
+	const ScenarioTimeStep<_type> *sts;
+	ICWFGM_GridEngine *grid;
+};
+
+struct growVoxelQueue {											// one worker's run of chunks, it takes from the front and idle workers steal from the back
+	std::atomic<std::uint64_t> range;							// first chunk in the low 32 bits, one past the last chunk in the high 32 bits
+	char pad[64 - sizeof(std::atomic<std::uint64_t>)];			// keep each queue on its own cache line
+};
 
 template<class _type>
 struct growVoxelIterator {
-	ScenarioFire<_type>* VOLATILE sf;
-	FireFront<_type>* VOLATILE ff;
-	FirePoint<_type>* VOLATILE fp;
-	CThreadSemaphore lock_ll;
+	growPointStruct<_type> *points;								// every point to grow this step, in list order
+	std::uint32_t num_points, chunk;							// chunk is the number of points claimed at a time
+	growVoxelQueue *queues;
+	std::uint32_t num_queues;
+	std::atomic<std::uint32_t> next_queue;						// hands each worker its own queue as it starts
 	growVoxelParms<_type> gvp;
 };
 
 template<class _type>
-struct growPointStruct {
-	FirePoint<_type> *fp;
-	struct growVoxelParms<_type> *gvs;
+struct growPointState {											// carries a point's FBP results from FirePoint::GrowPrepare() through the batched
+	FirePoint<_type> *fp;										// ellipse calculation to FirePoint::GrowFinish()
+	const ScenarioTimeStep<_type> *sts;
+	ICWFGM_Fuel *fuel;
+	CCWFGM_FuelOverrides overrides;
+	XYZ_PointTempl<_type> c_pt, p_pt, s_pt;
+	double aspect, azimuth;
+	double ffmc, bui, fmc, roseq;
+	std::uint64_t flags;
+	bool ellipse, can_burn;
 };
 
 #ifdef HSS_SHOULD_PRAGMA_PACK
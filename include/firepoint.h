@@ -22,11 +22,17 @@
 #include "poly.h"
 #include "vectors.h"
 #include "FireEngine.h"
+#include "StepArena.h"
+#include <vector>
 
 
 template<class _type>
 struct growVoxelParms;
 template<class _type>
+struct growPointState;
+template<class _type>
+struct growTerrain;
+template<class _type>
 class ScenarioTimeStep;
 
 
@@ -42,7 +48,8 @@ public:
 	using XY_PolyLLNode<_type>::y;
 
 public:
-	DECLARE_OBJECT_CACHE_MT(FirePoint<_type>, FirePoint)
+	static void *operator new(size_t size)					{ return StepArena::New(size); };	// from the arena of the step being built
+	static void operator delete(void *p)					{ StepArena::Free(p); };
 
 	FirePoint();
 	FirePoint(const XYPointType &pt);
@@ -86,6 +93,13 @@ public:
 	HRESULT RetrieveAttribute(const std::uint16_t stat, const uint32_t units, GDALVariant& a) const;
 
 	void Grow(const growVoxelParms<_type> *gvs, ICWFGM_Fuel *fuel);
+	bool GrowPrepare(const growVoxelParms<_type> *gvs, ICWFGM_Fuel *fuel, growPointState<_type> &state,	// FBP values, true if the point's ellipse is still to be calculated
+		const growTerrain<_type> *c_t = nullptr, const growTerrain<_type> *p_t = nullptr, const growTerrain<_type> *s_t = nullptr);	// prefetched terrain for this point and its neighbours, else it's looked up here
+	void GrowFinish(growPointState<_type> &state);														// stats that depend on the ellipse
+	static void GrowEllipses(growPointState<_type> *states, std::uint32_t cnt);						// batched grow2D() / grow3D() for the prepared points
+	static HRESULT ValidateEllipses(const ScenarioTimeStep<_type> *sts, std::uint32_t count, std::uint32_t seed, double *max_error);	// runs edge cases and count random points
+																									// through GrowEllipses() and grow2D() / grow3D(), S_FALSE if the largest
+																									// (relative) difference is over 1e-6, sts only supplies the TOPOGRAPHY option
 
 private:
 
@@ -96,6 +110,7 @@ private:
     #endif
 
 	void grow3D(const ScenarioTimeStep<_type> *timeStep, const XYZPointType &c_pt, const XYZPointType &p_pt, const XYZPointType &s_pt, _type aspect, const _type azimuth);
+	void growEllipse(const growPointState<_type> &state);
 
 public:
 	void copyValuesFrom(const FirePoint& toCopy);		// like a copy operator but don't want to override that operator over possible other issues
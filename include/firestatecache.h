@@ -24,8 +24,14 @@
 #include "poly.h"
 #include "CWFGM_Scenario.h"
 #include "valuecache_mt.h"
+#include "ShardedValueCache.h"
+#include "NumaTopology.h"
+#include "StepArena.h"
 #include "CoordinateConverter.h"
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <type_traits>
 
 #ifdef HSS_SHOULD_PRAGMA_PACK
 #pragma pack(push, 8)
@@ -41,6 +47,9 @@ class ScenarioTimeStep;
 
 using namespace HSS_Time;
 
+#define ARRIVAL_TILE	32
+
+
 template<class _type>
 class ScenarioGridCache {
 protected:
@@ -63,6 +72,25 @@ protected:
 	std::uint32_t arrayIndex(std::uint16_t x, std::uint16_t y) const;
 	std::uint32_t arrayIndex(const XYPointType &pt) const;
 
+	struct arrivalCell {
+		const ScenarioTimeStep<_type>	*arrival;		// first recorded step whose perimeters contain the center of the cell
+		const ScenarioTimeStep<_type>	*closest;		// step that the closest vertex came from (as picked by getStatsClosestVertex()), or nullptr
+		_type							ros, fi, raz;	// from that closest vertex
+	};
+
+	struct arrivalTile {
+		arrivalCell						cell[ARRIVAL_TILE * ARRIVAL_TILE];
+	};
+
+	std::vector<std::unique_ptr<arrivalTile>>	m_arrival;		// tiles of ARRIVAL_TILE x ARRIVAL_TILE cells, allocated as fires reach them
+	std::uint16_t								m_arrivalX;		// tiles per row
+	const ScenarioTimeStep<_type>				*m_arrivalTail;	// last step recorded in the raster
+	bool										m_arrivalLost;	// the grid moved after steps were recorded, the raster can't be trusted until the steps are cleared
+
+	bool arrivalCellXY(const XYPointType &pt, std::uint16_t &x, std::uint16_t &y, bool centered) const;
+	const arrivalCell *arrivalLookup(std::uint16_t x, std::uint16_t y) const;
+	arrivalCell *arrivalAlloc(std::uint16_t x, std::uint16_t y);
+
 public:
 	CCWFGM_Scenario		*m_scenario;				// pointer back to the managing parent / COM object
 	_type				resolution() const;
@@ -121,7 +149,13 @@ public:
 	~ScenarioGridCache();
 
 	void Size(const XYPointType &ll, const XYPointType &ur);
-	void RecordTimeStep(ScenarioTimeStep<_type> *sts);
+	void RecordTimeStep(ScenarioTimeStep<_type> *sts);				// steps have to be recorded in order, once they won't be purged
+	const ScenarioTimeStep<_type> *ArrivalTail() const				{ return m_arrivalTail; };
+	void ForgetTimeStep(const ScenarioTimeStep<_type> *sts, const ScenarioTimeStep<_type> *replacement);	// sts is about to be deleted
+	void ClearArrivals();
+
+	bool ArrivalBurned(const XYPointType &pt, const ScenarioTimeStep<_type> *sts, bool &burned) const;	// false if the raster can't answer for pt at sts
+	bool ArrivalClosest(const XYPointType &pt, const WTime &mintime, const WTime &time, const ScenarioTimeStep<_type> *&closest, _type &ros, _type &fi, _type &raz) const;
 
 private:
 	void grid_create(const XYPointType &ll, const XYPointType &ur);
@@ -129,18 +163,25 @@ private:
 };
 
 
+struct XY_PolyLLTimedParticipation {				// Clip_Participates() parameter for static vector breaks
+	const WTime		*time;							// time of the clip
+	const WTime		*usedTimes;						// the scenario's used time table, indexed by XY_PolyLLTimed::m_index
+};
+
+
 template<class _type>
 class XY_PolyLLTimed : public XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type> {
 public:
-	WTime m_usedTime;
+	std::uint32_t m_index;							// position of this polygon in the landscape, the time it was first used is kept per scenario since
+													// the polygon may be shared by several scenarios
 
-	XY_PolyLLTimed() : XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::XY_PolyLL_Templ(), m_usedTime(0, nullptr) {};
-	XY_PolyLLTimed(const _type* xy_pairs, std::uint32_t array_size) : XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::XY_PolyLL_Templ(xy_pairs, array_size), m_usedTime(0, nullptr) {};
-	XY_PolyLLTimed(const XY_PolyConstTempl<_type>& toCopy) : XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::XY_PolyLL_Templ(toCopy), m_usedTime(0, nullptr) {};
-	XY_PolyLLTimed(const XY_PolyLL_BaseTempl<_type>& toCopy) : XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::XY_PolyLL_Templ(toCopy), m_usedTime(0, nullptr) {};
-	XY_PolyLLTimed(const XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>& toCopy) : XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::XY_PolyLL_Templ(toCopy), m_usedTime(0, nullptr) {};
-	XY_PolyLLTimed(XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>&& toMove) : XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::XY_PolyLL_Templ(toMove), m_usedTime(0, nullptr) {};
-	XY_PolyLLTimed(const XY_PointTempl<_type>* pt_array, std::uint32_t array_size) : XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::XY_PolyLL_Templ(pt_array, array_size), m_usedTime(0, nullptr) {};
+	XY_PolyLLTimed() : XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::XY_PolyLL_Templ(), m_index(0) {};
+	XY_PolyLLTimed(const _type* xy_pairs, std::uint32_t array_size) : XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::XY_PolyLL_Templ(xy_pairs, array_size), m_index(0) {};
+	XY_PolyLLTimed(const XY_PolyConstTempl<_type>& toCopy) : XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::XY_PolyLL_Templ(toCopy), m_index(0) {};
+	XY_PolyLLTimed(const XY_PolyLL_BaseTempl<_type>& toCopy) : XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::XY_PolyLL_Templ(toCopy), m_index(0) {};
+	XY_PolyLLTimed(const XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>& toCopy) : XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::XY_PolyLL_Templ(toCopy), m_index(0) {};
+	XY_PolyLLTimed(XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>&& toMove) : XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::XY_PolyLL_Templ(toMove), m_index(0) {};
+	XY_PolyLLTimed(const XY_PointTempl<_type>* pt_array, std::uint32_t array_size) : XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::XY_PolyLL_Templ(pt_array, array_size), m_index(0) {};
 
 	XY_PolyLLTimed* LN_Succ() const { return (XY_PolyLLTimed*)XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::LN_Succ(); }
 	XY_PolyLLTimed* LN_Pred() const { return (XY_PolyLLTimed*)XY_PolyLL_Templ<XY_PolyLLNode<_type>, _type>::LN_Pred(); }
@@ -148,14 +189,14 @@ public:
 	virtual bool Clip_Participates(APTR parm) const override {
 		if (!parm)
 			return true;
-		WTime* time = (WTime*)parm;
-		return Participates(*time);
+		const XY_PolyLLTimedParticipation* p = (const XY_PolyLLTimedParticipation*)parm;
+		return Participates(p->usedTimes[m_index], *p->time);
 	}
 
-	bool Participates(const WTime& time) const {
-		if (!m_usedTime.GetTotalMicroSeconds())
+	static bool Participates(const WTime& usedTime, const WTime& time) {
+		if (!usedTime.GetTotalMicroSeconds())
 			return false;
-		return (m_usedTime <= time);
+		return (usedTime <= time);
 	}
 };
 
@@ -167,6 +208,35 @@ public:
 };
 
 
+template<class _type>
+class ScenarioLandscape {							// geometry derived from the vector engines and assets - read-only once built, so that many
+public:												// scenarios (an ensemble) sharing the same landscape only build it once
+	using XYPolyNodeType = XY_PolyLLNode<_type>;
+	using XYPolyLLType = XY_PolyLL_Templ<XYPolyNodeType, _type>;
+
+	struct AssetGeometry {
+		const ICWFGM_Asset					*asset;
+		std::vector<XYPolyLLType*>			geometry;	// cleaned and oriented, copied into each scenario's AssetGeometryNode's
+	};
+
+	ScenarioLandscape() : m_staticVectorBreakPolys(0), m_assetsBuilt(false), m_resolution(0.0), m_scaling(0) { }
+	~ScenarioLandscape();
+
+	std::vector<XY_PolyLLSetBB<_type>*>		m_staticVectorBreaks;
+	std::uint32_t							m_staticVectorBreakPolys;	// count of all polygons in m_staticVectorBreaks
+	std::vector<AssetGeometry>				m_assets;
+	bool									m_assetsBuilt;
+
+													// what the geometry depends on, a scenario has to match these to share it
+	XY_PointTempl<_type>					m_ll;
+	_type									m_resolution;
+	std::uint64_t							m_scaling;
+	std::vector<const ICWFGM_VectorEngine*>	m_vectorEngines;
+
+	const AssetGeometry *Asset(const ICWFGM_Asset *asset) const;
+};
+
+
 template<class _type>
 class ScenarioCache : public ScenarioGridCache<_type> {
 
@@ -202,18 +272,49 @@ public:
 	bool			m_multithread, m_assets;
 	std::uint32_t	m_numthreads;
 
-	CWorkerThreadPool	*m_pool;		// for multi-CPU operations
+	CWorkerThreadPool	*m_pool;		// for multi-CPU operations, every parallel phase runs on these threads
+	NumaTopology::placement	m_placement;	// where m_pool's workers are pinned, empty unless CWFGM_SCENARIO_OPTION_FORCE_AFFINITY is set
+
+	void FirstTouch(void *memory, size_t bytes) const;				// has each worker zero its share of memory (worker i the i'th of m_numthreads runs), so
+																	// freshly mapped pages land on the node that works on them - the caller holds AcquirePool()
+
+	std::unique_lock<std::mutex> AcquirePool() const				{ return std::unique_lock<std::mutex>(m_poolLock, std::try_to_lock); };	// owns the lock if m_pool is
+																	// free - it's busy during a nested call, or when a query runs during a step
+	template<class _fn>
+	bool ParallelFor(std::uint32_t count, std::uint32_t chunk, _fn &&fn) const {	// calls fn(begin, end) over [0, count) from m_pool, claiming chunk at a time, or
+		parallelJob job;												// just fn(0, count) on this thread if there's no pool, it's busy, or there's only one
+		job.count = count;												// chunk, returns true if it ran on the pool
+		job.chunk = chunk ? chunk : 1;
+		job.next = 0;
+		job.fn = (void *)&fn;
+		job.call = [](void *f, std::uint32_t begin, std::uint32_t end) { (*(std::remove_reference_t<_fn> *)f)(begin, end); };
+		job.arena = StepArena::Current();
+		if (runParallel(job))
+			return true;
+		if (count)
+			fn(0, count);
+		return false;
+	}
 
-	std::uint32_t						StaticVectorBreakCount() const					{ return (std::uint32_t)m_staticVectorBreaksLL->size(); }
+	std::uint32_t						StaticVectorBreakCount() const					{ return (std::uint32_t)m_landscape->m_staticVectorBreaks.size(); }
 	std::uint32_t								AssetCount() const;
-	bool								StaticVectorBreak() const						{ return (m_staticVectorBreaksLL) ? true : false; };
-	const XY_PolyLLSetBB<_type>		*StaticVectorBreak(std::uint32_t index) const	{ return (*m_staticVectorBreaksLL)[index]; };
+	bool								StaticVectorBreak() const						{ return (m_landscape) ? true : false; };
+	const XY_PolyLLSetBB<_type>		*StaticVectorBreak(std::uint32_t index) const	{ return m_landscape->m_staticVectorBreaks[index]; };
+
+	const WTime							&StaticVectorBreakUsed(const XY_PolyLLTimed<_type> *p) const	{ return m_staticVectorBreakUsed[p->m_index]; };
+	void								StaticVectorBreakUsed(const XY_PolyLLTimed<_type> *p, const WTime &time)	{ m_staticVectorBreakUsed[p->m_index] = time; };
+	bool								StaticVectorBreakParticipates(const XY_PolyLLTimed<_type> *p, const WTime &time) const	{ return XY_PolyLLTimed<_type>::Participates(m_staticVectorBreakUsed[p->m_index], time); };
+	const WTime							*StaticVectorBreakUsedTimes() const				{ return m_staticVectorBreakUsed.data(); };
+
+	std::shared_ptr<ScenarioLandscape<_type>> BuildLandscape();
+	bool ShareLandscape(const std::shared_ptr<ScenarioLandscape<_type>> &landscape);
 
 	bool IsNonFuel(const WTime &time, const XYPointType &pt, bool &valid) const;
 	bool IsNonFuelUTM(const WTime& time, const XYPointType& pt, bool& valid) const;
 	bool IsNonFuel_NotCached(const WTime &time, const XYPointType &pt, bool &valid, XYRectangleType *cache_bbox) const;
 
 	ICWFGM_Fuel *GetFuel(const WTime &time, const XYPointType &pt, bool &valid) const;
+	ICWFGM_Fuel *GetFuel(const WTime &time, const XYPointType &pt, bool &valid, bool &nonfuel) const;	// nonfuel also covers no fuel or an invalid lookup
 
 #if defined(SUPPORT_BIGFLOATS) && defined(USE_BIGFLOATS)
 	ICWFGM_Fuel* GetFuel(const WTime& time, const XY_Point& pt, bool& valid) const;
@@ -222,6 +323,10 @@ public:
 	ICWFGM_Fuel* GetFuel_NotCached(const WTime& time, const XYPointType& pt, bool& valid) const;
 	ICWFGM_Fuel* GetFuelUTM_NotCached(const WTime& time, const XYPointType& pt, bool& valid) const;
 
+	HRESULT GetWeatherUTM(const WTime &time, const XY_Point &pt, std::uint64_t interpolate, IWXData *wx, IFWIData *ifwi, DFWIData *dfwi, bool *wx_valid) const;	// cached per cell
+																			// and time unless the weather is spatially interpolated
+	void ClearWeather()													{ m_weatherCache.Clear(); };
+
 	void GetCorrectedFuel(const XYZPointType &c_pt, const WTime &time, ICWFGM_Fuel *fuel, CCWFGM_FuelOverrides &overrides);
 	void GetCorrectedFuel(const XYPointType &pt, const WTime& time, ICWFGM_Fuel* fuel, CCWFGM_FuelOverrides& overrides);
 	void GetCorrectedFuelUTM(const XYPointType &_pt, const WTime& time, ICWFGM_Fuel* fuel, CCWFGM_FuelOverrides& overrides);
@@ -233,7 +338,9 @@ public:
 protected:
 	void buildStaticVectorBreaks();
 	void buildAssets();
-	std::vector<XY_PolyLLSetBB<_type>*>		*m_staticVectorBreaksLL;
+	std::shared_ptr<ScenarioLandscape<_type>>	m_landscape;				// static vector breaks and asset geometry, may be shared with other scenarios
+	std::vector<WTime>							m_staticVectorBreakUsed;	// first time each static vector break polygon may have been touched by this
+																			// scenario's fires, indexed by XY_PolyLLTimed::m_index
 
 	void PreCalculation();
 	void PostCalculation();
@@ -246,7 +353,39 @@ public:
 	bool CanBurnTime(const WTime &dateTime, const XYPointType &centroid, WTimeSpan &start, WTimeSpan &end);
 
 private:
+	bool landscapeMatches(const ScenarioLandscape<_type> &landscape) const;
+	void landscapeKey(ScenarioLandscape<_type> &landscape) const;
 	bool isNonFuelUTM_NotCached(const WTime& time, const XYPointType& _pt, bool& valid, XYRectangleType* cache_bbox) const;
+	ICWFGM_Fuel *getFuelUTM(const WTime &time, const XY_Point &pt, bool &valid, bool &nonfuel) const;	// through this thread's fuel tile cache
+
+	std::uint64_t	m_fuelTileOwner;		// tags this scenario's entries in the per-thread fuel tile caches
+
+	struct parallelJob {
+		std::atomic<std::uint32_t>	next;	// next chunk to claim
+		std::uint32_t				count, chunk;
+		void						(*call)(void *fn, std::uint32_t begin, std::uint32_t end);
+		void						*fn;
+		StepArena					*arena;	// the caller's, so the workers allocate where it would
+	};
+	bool runParallel(parallelJob &job) const;
+	static std::uint32_t AFX_CDECL parallelInit(APTR parameter);
+	static std::uint32_t AFX_CDECL placeInit(APTR parameter);
+	static std::uint32_t AFX_CDECL firstTouchInit(APTR parameter);
+	void releasePool();
+	mutable std::mutex	m_poolLock;			// one job at a time on m_pool
+
+	struct weather_key {
+		std::int64_t	cx, cy;				// cell containing the point
+		std::uint64_t	time;				// microseconds, so entries from earlier steps simply stop matching
+		std::uint64_t	interpolate;
+	};
+	struct weather_value {
+		IWXData			wx;
+		IFWIData		ifwi;
+		DFWIData		dfwi;
+		XY_Rectangle	bbox;				// UTM area the grid engine says this weather holds over
+	};
+	mutable ShardedValueCache<weather_key, weather_value>	m_weatherCache;
 
 	template<class T>
 	friend bool cacheRetrieve(typename ScenarioCache<T>::fuel_cache_key *entry, APTR lookup);
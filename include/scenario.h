@@ -22,6 +22,11 @@
 #include "firestatecache.h"
 #include "ScenarioExportRules.h"
 #include "ScenarioAsset.h"
+#include "ShardedValueCache.h"
+#include "QueueTuner.h"
+#include <atomic>
+#include <map>
+#include <memory>
 #include <vector>
 
 
@@ -58,7 +63,17 @@ struct growVoxelParms;
 template<class _type>
 struct growPointStruct;
 template<class _type>
+struct growTerrain;
+template<class _type>
+struct growTerrainPoint;
+template<class _type>
 class DelaunayTree;
+template<class _type>
+struct delaunayWindow;
+template<class _type>
+class delaunayCache;
+struct ScenarioStepPhaseMetrics;
+class ScenarioSpillStore;
 
 
 template<class _type>
@@ -77,6 +92,11 @@ class Scenario : public ScenarioCache<_type> {
 public:
 	using ScenarioGridCache<_type>::m_scenario;
 	using ScenarioGridCache<_type>::RecordTimeStep;
+	using ScenarioGridCache<_type>::ArrivalTail;
+	using ScenarioGridCache<_type>::ForgetTimeStep;
+	using ScenarioGridCache<_type>::ClearArrivals;
+	using ScenarioGridCache<_type>::ArrivalBurned;
+	using ScenarioGridCache<_type>::ArrivalClosest;
 	using ScenarioCache<_type>::m_specifiedFMC_Landscape;
 	using ScenarioCache<_type>::m_specifiedElev_Landscape;
 	using ScenarioCache<_type>::m_coordinateConverter;
@@ -109,9 +129,12 @@ public:
 	HRESULT										m_stepState;
 
 	WTime CurrentTime() const;
+	void ClosestCacheCounters(std::uint64_t &hits, std::uint64_t &misses, std::uint64_t &evictions) const	{ m_closestcache.Counters(hits, misses, evictions); };
 
 	HRESULT Step();
 	HRESULT StepBack();
+	HRESULT Checkpoint(std::int32_t fileVersion, const WTime *until, WISE::FireEngineProto::CwfgmScenarioState *state) const;	// until is the time to fork at, or NULL for all of it
+	HRESULT Resume(const WISE::FireEngineProto::CwfgmScenarioState &state, std::shared_ptr<validation::validation_object> valid, const std::string &name);
 
 	HRESULT GetNumSteps(std::uint32_t *size) const;
 	HRESULT GetStepsArray(std::uint32_t *size, std::vector<WTime> *times) const;
@@ -122,30 +145,71 @@ public:
 	HRESULT GetStatsArray(const std::uint32_t fire, WTime *time, const std::uint16_t stat, std::uint32_t *size, std::vector<double> &stats) const;
 	HRESULT GetStats(const std::uint32_t fire, ICWFGM_Fuel *fuel, WTime *time, const std::uint16_t stat, const std::uint16_t discretization, PolymorphicAttribute *stats) const;
 	HRESULT GetStats(const std::uint32_t fire, WTime *time, const std::uint16_t stat, const bool only_displayable, const double greater_equal, const double less_than, double *stats) const;
+	HRESULT GetPhaseSummary(WTime *time, ScenarioStepPhaseMetrics *summary) const;	// sums the per-phase metrics of every displayable step up to (and including) time
 
 	HRESULT GetBurningBox(WTime *time, XYRectangleType &bbox) const;
 	HRESULT PointBurned(const XYPointType &pt, WTime *time, bool *status) const;
+	HRESULT PointsBurned(const std::vector<XYPointType> &pts, WTime *time, std::vector<bool> &status) const;
+
+	struct delaunayFront {
+		ScenarioTimeStep<_type>	*sts;
+		FireFront<_type>		*ff;
+	};
 
 	HRESULT GetStats(const XY_Point &min_utmpt, const XY_Point& max_utmpt, const XYPointType& pt1, const XYPointType& pt2, WTime* mintime, WTime* time, std::uint16_t stat_cnt, std::uint16_t* stats_array, NumericVariant* vstats, bool only_displayable, std::uint32_t technique, std::uint16_t discretize, bool test);
+	HRESULT GetStatsRaster(const XY_Point &ll, double resolution, std::uint16_t cols, std::uint16_t rows, WTime *mintime, WTime *time, std::uint16_t stat_cnt, std::uint16_t *stats_array, NumericVariant *vstats, std::uint32_t technique, std::uint16_t discretize);
 
 	HRESULT Export(const CCWFGM_Ignition *set, WTime *start_time, WTime *end_time, std::uint16_t flags, std::string_view driver_name, const std::string &projection, const std::filesystem::path &file_path, const ScenarioExportRules& rules, ScenarioTimeStep<_type>* _sts = nullptr) const;
 	HRESULT ExportCriticalPath(const AssetNode<_type>* node, const AssetGeometryNode<_type>* g, const std::uint16_t flags, std::string_view driver_name, const std::string& csProjection, const std::filesystem::path& file_path, const ScenarioExportRules& rules) const;
 	HRESULT BuildCriticalPath(const AssetNode<_type>* node, const AssetGeometryNode<_type>* g, const std::uint16_t flags, CriticalPath* polyset, const ScenarioExportRules* rules) const;
 
+	class spillHold {												// made by a query before it locks m_llLock shared, to page in the steps it will walk and keep them in memory until
+	public:															// it's done, the last query out spills some again only if that left too many in memory
+		spillHold(const Scenario<_type> *scenario, const WTime &time, std::uint32_t display = 1);
+		~spillHold();
+		HRESULT Result() const										{ return m_hr; };
+
+	private:
+		Scenario<_type>	*m_scenario;								// nullptr if nothing is, or can be, spilled
+		HRESULT			m_hr;
+	};
+
 	std::vector<class FirePoint<_type>*>	m_omp_fp_array;
 	std::vector<class FireFront<_type>*>	m_omp_ff_array;
+	std::vector<class FireFront<_type>*>	m_omp_tracked_array;	// fronts SimplifyFires() already grid tracked, sorted, for TrackFires() to skip
 	growVoxelParms<_type>					*m_omp_gvs_array;
 	growPointStruct<_type>					*m_omp_gps_array;
+	growTerrain<_type>						*m_omp_terrain_array;
+	growTerrainPoint<_type>					*m_omp_gts_array;
 	std::uint32_t							m_omp_gvs_array_size,
-											m_omp_gps_array_size;
+											m_omp_gps_array_size,
+											m_omp_terrain_array_size,
+											m_omp_gts_array_size;
+	QueueTuner								m_statsTuner,			// when StatsFires(), TrackFireGrid() and TrackFireVector() go parallel
+											m_gridTuner,
+											m_vectorTuner;
 
 private:
 	HRESULT GetStep(WTime *time, ScenarioTimeStep<_type> **sts, const bool only_displayable) const;
 	ScenarioTimeStep<_type>* GetPreviousStep(ScenarioTimeStep<_type>* sts, bool only_displayable, const FireFront<_type> *ff) const;
 	ScenarioTimeStep<_type>* GetPreviousDisplayStep(ScenarioTimeStep<_type>* sts, FireFront<_type>* closest_ff, ScenarioTimeStep<_type>* prev_sts) const;
 	ScenarioTimeStep<_type>* Purge();
-
-	void buildDelaunay2(const WTime &mintime, const WTime &t, const XYPointType &pt, bool only_displayable, DelaunayType *dt); // this is here for testing purposes, it will hopefully outperform buildDelaunay(), and eventually replace it.
+	void clearSteps();
+	void spillSteps();												// writes out perimeters older than the last m_spillSteps display steps once there are too many, with m_llLock held exclusively
+	ScenarioTimeStep<_type> *spillKeep(std::uint64_t &budget, std::uint64_t &resident) const;	// oldest step spillSteps() keeps, or nullptr for all of them, with the bytes
+																	// of the steps it keeps and of the older ones still in memory
+	ScenarioTimeStep<_type> *spillOldest(const WTime &time, std::uint32_t display) const;		// oldest step a query for the display'th display step at or before time may walk
+	HRESULT pageIn(const WTime &time, std::uint32_t display);		// with m_llLock held exclusively, reads back the perimeters of the display'th display step at or before time, and of every step after it
+	void recordSteps();												// adds every step after ArrivalTail() to the arrival raster
+	void accumulatePhaseMetrics(const ScenarioTimeStep<_type> *sts, ScenarioStepPhaseMetrics &summary) const;
+
+	void buildDelaunay2(const WTime &mintime, const WTime &t, const XYPointType &pt, bool only_displayable, DelaunayType *dt, const std::vector<delaunayFront> *fronts = nullptr); // this is here for testing purposes, it will hopefully outperform buildDelaunay(), and eventually replace it.
+	_type delaunayRadius() const;									// the largest radius buildDelaunay2() will search
+	void delaunayFronts(const WTime &mintime, const WTime &t, const XYRectangleType &area, bool only_displayable, std::vector<delaunayFront> &fronts) const;	// the fronts buildDelaunay2() may use for any point in area
+	std::shared_ptr<const delaunayWindow<_type>> delaunayNeighbourhood(const WTime &mintime, const WTime &t, bool only_displayable) const;	// cached vertices buildDelaunay2() may use, or nullptr to walk the steps
+	void delaunayAppend();											// adds steps completed since to the cached windows they fall in
+	void delaunayInvalidate(bool destroy = false) const;			// whenever steps are removed or their points are relinked
+	void delaunayInvalidate(std::uint64_t from, std::uint64_t to) const;	// when only the steps from 'from' to 'to' (in microseconds) are spilled, paged in, or relinked
 
 	HRESULT getCalculatedStats(XYPointType c_pt, const WTime& time, ICWFGM_Fuel*& fuel, const CCWFGM_FuelOverrides &overrides, bool valid, std::uint64_t& flags, const std::uint32_t technique,
 		double& fbp_rss, double& fbp_roseq, double& fbp_ros, double& fbp_fros, double& fbp_bros, double& fbp_raz, double* fbp_rosv = nullptr, double* fbp_v = nullptr,
@@ -165,13 +229,22 @@ public:
 	};
 
 private:
-	ValueCacheTempl_MT<stats_key, closest_calc> m_closestcache;
+	ShardedValueCache<stats_key, closest_calc> m_closestcache;
+
+	std::unique_ptr<ScenarioSpillStore>						m_spill;		// created on the first spill
+	std::atomic<ScenarioTimeStep<_type>*>					m_spillTail;	// newest spilled step, every step before it is spilled too
+	std::atomic<std::uint32_t>								m_spillHolds;	// queries using steps paged in for them, nothing is spilled while there are any
+	std::atomic<bool>										m_spillPressure;	// pageIn() left more in memory than spillSteps() allows
+	std::map<std::uint64_t, std::uint32_t>					m_spillTargets;	// links out of spilled steps, by the time of the step they point into, Purge() keeps those steps
+
+	mutable std::atomic<delaunayCache<_type>*>				m_delaunayCache;	// created on the first interpolated query
 
 protected:
+	HRESULT getStats(const XY_Point &min_utmpt, const XY_Point& max_utmpt, const XYPointType& pt1, const XYPointType& pt2, WTime* mintime, WTime* time, std::uint16_t stat_cnt, std::uint16_t* stats_array, NumericVariant* vstats, bool only_displayable, std::uint32_t technique, std::uint16_t discretize, bool test, const std::vector<delaunayFront> *fronts);	// GetStats() once its steps are paged in
 	HRESULT getStatsCalculate(const XYPointType& pt, WTime* time, std::uint16_t stat_cnt, USHORT* stats_array, NumericVariant* vstats, const std::uint32_t technique, const bool only_displayable);
 	HRESULT getStatsClosestVertex(const XYPointType& pt, WTime* mintime, WTime* time, std::uint16_t stat_cnt, USHORT* stats_array, NumericVariant* vstats, const bool only_displayable, bool test);
 	HRESULT getStatsDiscretize(const XYPointType& min_pt, const XYPointType& max_pt, WTime* mintime, WTime* time, std::uint16_t stat_cnt, USHORT* stats_array, NumericVariant* vstats, const bool only_displayable, USHORT discretize);
-	HRESULT getStatsInterpolate(const XY_Point& utmpt, const XYPointType& pt, WTime* mintime, WTime* time, std::uint16_t stat_cnt, USHORT* stats_array, NumericVariant* vstats, const bool only_displayable, const std::uint32_t technique);
+	HRESULT getStatsInterpolate(const XY_Point& utmpt, const XYPointType& pt, WTime* mintime, WTime* time, std::uint16_t stat_cnt, USHORT* stats_array, NumericVariant* vstats, const bool only_displayable, const std::uint32_t technique, const std::vector<delaunayFront> *fronts = nullptr);
 
 public:
 	double m_tinv;